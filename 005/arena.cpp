@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include "arena.h"
+#include "identifier.h"
+
+namespace {
+  // one arena per compiler (i.e., per compilation unit)
+  std::map<const cdk::compiler*, std::unique_ptr<udf::arena>> arenas;
+
+  // used for anything allocated outside a compilation
+  udf::arena fallback;
+  udf::arena *active = &fallback;
+}
+
+void udf::arena::grow(std::size_t at_least) {
+  std::size_t size = std::max(_block_size, at_least);
+  _next = new char[size];
+  _end = _next + size;
+  _blocks.push_back(_next);
+}
+
+cdk::variable_node *udf::arena::variable(int lineno, const std::string *name) {
+  return make<udf::interned_variable_node>(lineno, name);
+}
+
+void udf::arena::release() {
+  // destroy in reverse order of construction
+  for (auto it = _cleanups.rbegin(); it != _cleanups.rend(); ++it)
+    it->destroy(it->object);
+  _cleanups.clear();
+
+  for (auto block : _blocks)
+    delete[] block;
+  _blocks.clear();
+
+  _next = _end = nullptr;
+  _allocated = 0;
+
+  // nothing refers to the canonical strings any more
+  _strings.clear();
+}
+
+udf::arena &udf::arena::current() {
+  return *active;
+}
+
+udf::arena &udf::arena::open(const cdk::compiler *owner) {
+  auto &slot = arenas[owner];
+  slot = std::make_unique<udf::arena>();
+  active = slot.get();
+  return *active;
+}
+
+void udf::arena::close(const cdk::compiler *owner) {
+  auto it = arenas.find(owner);
+  if (it == arenas.end()) return;
+  if (active == it->second.get()) active = &fallback;
+  arenas.erase(it);
+}
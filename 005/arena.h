@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <cdk/ast/sequence_node.h>
+
+namespace cdk {
+  class compiler;
+  class variable_node;
+}
+
+namespace udf {
+
+  /**
+   * Sequences delete their children when destroyed. Inside an arena the
+   * children are released by the arena itself, so they are dropped first.
+   */
+  inline void arena_destroy(cdk::sequence_node *node) {
+    node->nodes().clear();
+    node->~sequence_node();
+  }
+
+  template<typename T>
+  inline void arena_destroy(T *object) {
+    object->~T();
+  }
+
+  /**
+   * Bump allocator for the syntax tree and the parser's temporaries.
+   * Each compilation unit has its own arena: everything allocated from it
+   * lives until the arena is released, and is then freed in one go.
+   */
+  class arena {
+    struct cleanup {
+      void *object;
+      void (*destroy)(void *);
+    };
+
+    std::vector<char*> _blocks;
+    std::vector<cleanup> _cleanups;
+    char *_next = nullptr;
+    char *_end = nullptr;
+    std::size_t _block_size;
+    std::size_t _allocated = 0;
+
+    // transparent hashing, so that lookups do not build a std::string
+    struct text_hash {
+      using is_transparent = void;
+      std::size_t operator()(std::string_view text) const {
+        return std::hash<std::string_view>()(text);
+      }
+    };
+
+    // canonical copies of identifiers and string literals (see intern)
+    std::unordered_set<std::string, text_hash, std::equal_to<>> _strings;
+
+  public:
+    explicit arena(std::size_t block_size = 64 * 1024) :
+        _block_size(block_size) {
+    }
+
+    arena(const arena&) = delete;
+    arena &operator=(const arena&) = delete;
+
+    ~arena() {
+      release();
+    }
+
+  public:
+    void *allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+      auto aligned = align(_next, alignment);
+      if (_next == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(_end)) {
+        grow(size + alignment);
+        aligned = align(_next, alignment);
+      }
+      _next = reinterpret_cast<char*>(aligned + size);
+      _allocated += size;
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    /** Construct an object in the arena: it is destroyed when the arena is released. */
+    template<typename T, typename ... Args>
+    T *make(Args &&... args) {
+      T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      if constexpr (!std::is_trivially_destructible_v<T>)
+        _cleanups.push_back({ object, [](void *o) { arena_destroy(static_cast<T*>(o)); } });
+      return object;
+    }
+
+    /** Canonical copy of a string, which lives as long as the arena. */
+    const std::string *intern(std::string_view text) {
+      auto it = _strings.find(text);
+      if (it == _strings.end()) it = _strings.emplace(text).first;
+      return &*it;
+    }
+
+    /** Construct a variable node that keeps its interned name (see name_of). */
+    cdk::variable_node *variable(int lineno, const std::string *name);
+
+    /** Destroy every object and free all blocks at once. */
+    void release();
+
+    std::size_t allocated() const {
+      return _allocated;
+    }
+
+  private:
+    static std::uintptr_t align(char *p, std::size_t alignment) {
+      auto address = reinterpret_cast<std::uintptr_t>(p);
+      return (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+    }
+
+    void grow(std::size_t at_least);
+
+  public:
+    /** The arena of the compilation unit being parsed. */
+    static arena &current();
+
+    /** Start a new arena for a compilation unit and make it current. */
+    static arena &open(const cdk::compiler *owner);
+
+    /** Release the compilation unit's arena (and, with it, its syntax tree). */
+    static void close(const cdk::compiler *owner);
+  };
+
+} // udf
@@ -5,16 +5,18 @@
 #include <cdk/ast/sequence_node.h>
 #include <cdk/ast/nil_node.h>
 #include <cdk/ast/expression_node.h>
+#include "arena.h"
+#include "identifier.h"
 
 namespace udf {
 
   class function_call_node: public cdk::expression_node {
-    std::string _identifier;
+    udf::identifier _identifier;
     cdk::sequence_node *_arguments;
 
   public:
     function_call_node(int lineno, const std::string &identifier) :
-        cdk::expression_node(lineno), _identifier(identifier), _arguments(new cdk::sequence_node(lineno)) {
+        cdk::expression_node(lineno), _identifier(identifier), _arguments(udf::arena::current().make<cdk::sequence_node>(lineno)) {
     }
 
     function_call_node(int lineno, const std::string &identifier, cdk::sequence_node *arguments) :
@@ -23,6 +25,9 @@ namespace udf {
 
   public:
     const std::string& identifier() {
+      return _identifier.str();
+    }
+    const udf::identifier& id() const {
       return _identifier;
     }
     cdk::sequence_node* arguments() {
@@ -4,6 +4,8 @@
 #include <cdk/ast/typed_node.h>
 #include <cdk/ast/sequence_node.h>
 #include <string>
+#include "identifier.h"
+#include "type_cache.h"
 
 namespace udf { 
 
@@ -12,14 +14,14 @@ namespace udf {
      */
     class function_declaration_node : public cdk::typed_node {
         int _qualifier;   
-        std::string _identifier;
+        udf::identifier _identifier;
         cdk::sequence_node *_arguments;
         
     public:
         // return type is void
         function_declaration_node(int lineno, int qualifier, const std::string &identifier, cdk::sequence_node *arguments) :
                 cdk::typed_node(lineno), _qualifier(qualifier), _identifier(identifier), _arguments(arguments) {
-            type(cdk::primitive_type::create(0, cdk::TYPE_VOID));
+            type(udf::types::primitive(0, cdk::TYPE_VOID));
         }
  
         function_declaration_node(int lineno, int qualifier, std::shared_ptr<cdk::basic_type> return_type, const std::string &identifier,
@@ -30,7 +32,8 @@ namespace udf {
 
         int qualifier() { return _qualifier;}
 
-        const std::string &identifier() const { return _identifier; }
+        const std::string &identifier() const { return _identifier.str(); }
+        const udf::identifier &id() const { return _identifier; }
         
         cdk::sequence_node *arguments() { return _arguments; }
 
@@ -4,12 +4,14 @@
 #include <cdk/ast/typed_node.h>
 #include <cdk/ast/sequence_node.h>
 #include "ast/block_node.h"
+#include "identifier.h"
+#include "type_cache.h"
 
 namespace udf {
 
   class function_definition_node: public cdk::typed_node {
     int _qualifier;
-    std::string _identifier;
+    udf::identifier _identifier;
     cdk::sequence_node *_arguments;
     udf::block_node *_block;
 
@@ -17,7 +19,7 @@ namespace udf {
     function_definition_node(int lineno, int qualifier, const std::string &identifier, cdk::sequence_node *arguments,
                              udf::block_node *block) :
         cdk::typed_node(lineno), _qualifier(qualifier), _identifier(identifier), _arguments(arguments), _block(block) {
-      type(cdk::primitive_type::create(0, cdk::TYPE_VOID));
+      type(udf::types::primitive(0, cdk::TYPE_VOID));
     }
 
     function_definition_node(int lineno, int qualifier, std::shared_ptr<cdk::basic_type> funType, const std::string &identifier,
@@ -31,6 +33,9 @@ namespace udf {
       return _qualifier;
     }
     const std::string& identifier() const {
+      return _identifier.str();
+    }
+    const udf::identifier& id() const {
       return _identifier;
     }
     cdk::sequence_node* arguments() {
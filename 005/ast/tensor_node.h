@@ -3,6 +3,7 @@
 #include <cdk/ast/expression_node.h>
 #include <vector>
 #include <functional>
+#include "arena.h"
 
 namespace udf {
 
@@ -63,11 +64,9 @@ namespace udf {
         };
         flat_cells(node);
 
-        cdk::sequence_node *result = nullptr;
-        for (auto *n : flat)
-          result = new cdk::sequence_node(n->lineno(), n, result);
-
-        return result ? result : new cdk::sequence_node(node->lineno());
+        auto result = udf::arena::current().make<cdk::sequence_node>(node->lineno());
+        result->nodes() = std::move(flat);
+        return result;
       }
 
     };
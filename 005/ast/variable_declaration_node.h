@@ -4,6 +4,7 @@
 #include <cdk/ast/expression_node.h>
 #include <cdk/types/basic_type.h>
 #include <string>
+#include "identifier.h"
 
 namespace udf {
     
@@ -12,7 +13,7 @@ namespace udf {
    */
   class variable_declaration_node : public cdk::typed_node {
     int _qualifier; 
-    std::string _identifier;
+    udf::identifier _identifier;
     cdk::expression_node *_initializer;
 
     public:
@@ -26,7 +27,8 @@ namespace udf {
 
         int qualifier() const { return _qualifier; }
 
-        const std::string &identifier() const { return _identifier; }
+        const std::string &identifier() const { return _identifier.str(); }
+        const udf::identifier &id() const { return _identifier; }
 
         cdk::expression_node *initializer() { return _initializer; }
 
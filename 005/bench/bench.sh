@@ -0,0 +1,128 @@
+#!/bin/bash
+#
+# Compiler throughput benchmark: compiles the tests corpus and/or synthetic
+# programs with the asm and xml targets and reports source lines and AST
+# nodes per second. Nodes are counted as the elements of the XML output.
+#
+# usage: bench/bench.sh [corpus] [synthetic]       (default: both)
+#
+# Parameters (environment):
+#   UDF        compiler to run                        (./udf)
+#   TESTS      corpus directory                       (../tests)
+#   RUNS       times each input is compiled           (5)
+#   FUNCTIONS  synthetic: number of functions         (200)
+#   DEPTH      synthetic: expression depth            (20)
+#   TENSOR     synthetic: tensor literal size         (1000)
+#   NESTING    synthetic: block nesting depth         (10)
+#   TARGETS    targets to measure                     (asm xml)
+#
+
+UDF=${UDF:-./udf}
+TESTS=${TESTS:-../tests}
+RUNS=${RUNS:-5}
+FUNCTIONS=${FUNCTIONS:-200}
+DEPTH=${DEPTH:-20}
+TENSOR=${TENSOR:-1000}
+NESTING=${NESTING:-10}
+TARGETS=${TARGETS:-asm xml}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+now() {
+  date +%s.%N
+}
+
+# number of AST nodes of a program (one XML element per node)
+count_nodes() {
+  "$UDF" --target xml -o "$work/count.xml" "$1" >/dev/null 2>&1 || { echo 0; return; }
+  grep -c '^ *<[^/]' "$work/count.xml"
+}
+
+# write a synthetic program to standard output
+synthesize() {
+  awk -v functions="$FUNCTIONS" -v depth="$DEPTH" -v tensor="$TENSOR" -v nesting="$NESTING" '
+    function expression(d,    e, i, ops) {
+      split("+ - *", ops, " ")
+      e = "a"
+      for (i = 1; i <= d; i++) e = "(" e " " ops[i % 3 + 1] " " i ")"
+      return e
+    }
+    BEGIN {
+      for (f = 0; f < functions; f++) {
+        printf "int f%d(int a) {\n  int x = a;\n", f
+        indent = "  "
+        for (n = 0; n < nesting; n++) {
+          printf "%sif (x > %d) {\n", indent, n
+          indent = indent "  "
+        }
+        printf "%sx = %s;\n", indent, expression(depth)
+        for (n = nesting; n > 0; n--) {
+          indent = substr(indent, 3)
+          printf "%s}\n", indent
+        }
+        printf "  return x;\n}\n\n"
+      }
+      printf "public int udf() {\n  int s = 0;\n"
+      if (tensor > 0) {
+        printf "  tensor<%d> t = [", tensor
+        for (i = 0; i < tensor; i++) printf "%s%d", (i ? ", " : ""), i
+        printf "];\n  writeln t;\n"
+      }
+      for (f = 0; f < functions; f++) printf "  s = s + f%d(%d);\n", f, f
+      printf "  writeln s;\n  return 0;\n}\n"
+    }'
+}
+
+# measure: label files...
+measure() {
+  local label=$1; shift
+  local lines=0 nodes=0 file
+  for file in "$@"; do
+    lines=$((lines + $(wc -l < "$file")))
+    nodes=$((nodes + $(count_nodes "$file")))
+  done
+
+  local target
+  for target in $TARGETS; do
+    local failed=0 run start end
+    start=$(now)
+    for ((run = 0; run < RUNS; run++)); do
+      for file in "$@"; do
+        "$UDF" --target "$target" -o "$work/out.$target" "$file" >/dev/null 2>&1 || failed=$((failed + 1))
+      done
+    done
+    end=$(now)
+    awk -v label="$label" -v target="$target" -v files=$# -v runs="$RUNS" -v lines="$lines" -v nodes="$nodes" \
+        -v start="$start" -v end="$end" -v failed="$failed" 'BEGIN {
+      seconds = end - start
+      if (seconds <= 0) seconds = 1e-9
+      printf "%-10s %-4s %5d files x %d runs  %9.3f s  %12.0f lines/s  %12.0f nodes/s", \
+             label, target, files, runs, seconds, lines * runs / seconds, nodes * runs / seconds
+      if (failed > 0) printf "  (%d failed)", failed
+      printf "\n"
+    }'
+  done
+}
+
+if [ ! -x "$UDF" ]; then
+  echo "$0: compiler '$UDF' not found (build it first)" >&2
+  exit 1
+fi
+
+suites=${*:-corpus synthetic}
+for suite in $suites; do
+  case $suite in
+    corpus)
+      measure corpus "$TESTS"/*.udf
+      ;;
+    synthetic)
+      synthesize > "$work/synthetic.udf"
+      measure synthetic "$work/synthetic.udf"
+      ;;
+    *)
+      echo "$0: unknown suite '$suite' (corpus, synthetic)" >&2
+      exit 1
+      ;;
+  esac
+done
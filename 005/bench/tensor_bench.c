@@ -0,0 +1,170 @@
+/*
+ * Tensor kernel throughput: runs every kernel of every table this machine
+ * supports over arrays of a few sizes and reports nanoseconds per cell and
+ * bytes moved per second. Each result is compared, bit for bit, with the
+ * scalar table's: a differing kernel is reported as such. Then the matrix
+ * product, with each table's register tile, over square matrices: its
+ * results are compared with a naive product (up to rounding).
+ *
+ * usage: bench/tensor_bench                          (make bench-runtime)
+ *
+ * Parameters (environment):
+ *   SIZES    cells per array, blank separated         (1000 100000 4000000)
+ *   MATRICES rows (and columns) of the products       (67 256 1000)
+ *   SECONDS  minimum time per measurement             (0.2)
+ *   UDF_THREADS threads of the products, as in the programs (processors)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gemm.h"
+#include "kernels.h"
+
+/* the runtime prints through the base runtime */
+void printi(int i) { printf("%d", i); }
+void prints(const char *s) { fputs(s, stdout); }
+void printd(double d) { printf("%g", d); }
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+enum shape { BINARY, SCALAR, FILL, COPY, EQUALS };
+
+struct kernel {
+  const char *name;
+  enum shape shape;
+  size_t offset;   /* in struct tensor_kernels */
+  int arrays;      /* read and written, for the bandwidth */
+};
+
+#define KERNEL(name, shape, arrays) { #name, shape, offsetof(struct tensor_kernels, name), arrays }
+
+static const struct kernel kernels[] = {
+  KERNEL(add, BINARY, 3), KERNEL(sub, BINARY, 3), KERNEL(mul, BINARY, 3), KERNEL(div, BINARY, 3),
+  KERNEL(add_scalar, SCALAR, 2), KERNEL(sub_scalar, SCALAR, 2), KERNEL(mul_scalar, SCALAR, 2),
+  KERNEL(div_scalar, SCALAR, 2), KERNEL(fill, FILL, 1), KERNEL(copy, COPY, 2),
+  KERNEL(equals, EQUALS, 2),
+};
+
+typedef void (*binary_kernel)(double *r, const double *a, const double *b, size_t n);
+typedef void (*scalar_kernel)(double *r, const double *a, double s, size_t n);
+typedef void (*fill_kernel)(double *r, double s, size_t n);
+typedef void (*copy_kernel)(double *r, const double *a, size_t n);
+typedef int (*equals_kernel)(const double *a, const double *b, size_t n);
+
+/* One call of the kernel; the result of equals goes to *equal. */
+static void run(const struct tensor_kernels *table, const struct kernel *k, double *r, const double *a,
+                const double *b, size_t n, int *equal) {
+  void (*function)(void) = *(void (*const *)(void))((const char *)table + k->offset);
+  switch (k->shape) {
+    case BINARY: ((binary_kernel)function)(r, a, b, n); break;
+    case SCALAR: ((scalar_kernel)function)(r, a, 1.5, n); break;
+    case FILL: ((fill_kernel)function)(r, 1.5, n); break;
+    case COPY: ((copy_kernel)function)(r, a, n); break;
+    case EQUALS: *equal = ((equals_kernel)function)(a, a, n); break;
+  }
+}
+
+static double *array(size_t n) {
+  double *p = aligned_alloc(64, (n * sizeof(double) + 63) & ~(size_t)63);
+  if (p == NULL) {
+    perror("tensor_bench");
+    exit(1);
+  }
+  return p;
+}
+
+static void measure(const struct tensor_kernels *table, const struct kernel *k, size_t n, double seconds) {
+  double *a = array(n), *b = array(n), *r = array(n), *expected = array(n);
+  for (size_t i = 0; i < n; i++) {
+    a[i] = (double)(i % 1000) / 7 - 50;
+    b[i] = (double)(i % 997) / 3 + 1; /* never zero */
+  }
+
+  int equal = 0, expected_equal = 0;
+  run(&tensor_kernels_scalar, k, expected, a, b, n, &expected_equal);
+  run(table, k, r, a, b, n, &equal);
+  const int ok = k->shape == EQUALS ? equal == expected_equal : memcmp(r, expected, n * sizeof(double)) == 0;
+
+  long calls = 0;
+  double start = now(), elapsed;
+  do {
+    for (int i = 0; i < 10; i++)
+      run(table, k, r, a, b, n, &equal);
+    calls += 10;
+    elapsed = now() - start;
+  } while (elapsed < seconds);
+
+  const double cells = (double)calls * n;
+  printf("%-10s %-6s %9zu cells  %8.3f ns/cell  %8.2f GB/s%s\n", k->name, table->name, n, elapsed * 1e9 / cells,
+         cells * k->arrays * sizeof(double) / elapsed / 1e9, ok ? "" : "  (differs from scalar)");
+  free(a), free(b), free(r), free(expected);
+}
+
+static void measure_gemm(const struct tensor_kernels *table, size_t n, double seconds) {
+  double *a = array(n * n), *b = array(n * n), *c = array(n * n), *expected = array(n * n);
+  for (size_t i = 0; i < n * n; i++) {
+    a[i] = (double)(i % 1000) / 7 - 50;
+    b[i] = (double)(i % 997) / 3 - 100;
+    expected[i] = 0;
+  }
+  for (size_t i = 0; i < n; i++)
+    for (size_t p = 0; p < n; p++)
+      for (size_t j = 0; j < n; j++)
+        expected[i * n + j] += a[i * n + p] * b[p * n + j];
+
+  tensor_kernels = table;
+  long calls = 0;
+  double start = now(), elapsed;
+  int ok = 1;
+  do {
+    memset(c, 0, n * n * sizeof(double));
+    tensor_gemm(n, n, n, a, b, c);
+    if (calls++ == 0)
+      for (size_t i = 0; i < n * n; i++)
+        if (fabs(c[i] - expected[i]) > 1e-9 * n * (fabs(expected[i]) + 1)) ok = 0;
+    elapsed = now() - start;
+  } while (elapsed < seconds);
+
+  printf("%-10s %-6s %9zu rows   %8.3f ms      %8.2f GFLOP/s%s\n", "gemm", table->name, n, elapsed * 1e3 / calls,
+         2.0 * n * n * n * calls / elapsed / 1e9, ok ? "" : "  (differs from naive)");
+  free(a), free(b), free(c), free(expected);
+}
+
+int main(void) {
+  const char *sizes = getenv("SIZES") ? getenv("SIZES") : "1000 100000 4000000";
+  const char *matrices = getenv("MATRICES") ? getenv("MATRICES") : "67 256 1000";
+  const double seconds = getenv("SECONDS") ? atof(getenv("SECONDS")) : 0.2;
+
+  /* the tables this machine runs, narrowest first */
+  const struct tensor_kernels *tables[3];
+  int n_tables = 0;
+  const struct tensor_kernels *widest = tensor_select_kernels();
+  tables[n_tables++] = &tensor_kernels_scalar;
+  if (widest != &tensor_kernels_scalar) tables[n_tables++] = &tensor_kernels_sse2;
+  if (widest == &tensor_kernels_avx2) tables[n_tables++] = &tensor_kernels_avx2;
+  printf("selected: %s\n", widest->name);
+
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    char *list = strdup(sizes), *state = NULL;
+    for (char *size = strtok_r(list, " ", &state); size != NULL; size = strtok_r(NULL, " ", &state))
+      for (int t = 0; t < n_tables; t++)
+        measure(tables[t], &kernels[k], strtoul(size, NULL, 10), seconds);
+    free(list);
+  }
+
+  char *list = strdup(matrices), *state = NULL;
+  for (char *size = strtok_r(list, " ", &state); size != NULL; size = strtok_r(NULL, " ", &state))
+    for (int t = 0; t < n_tables; t++)
+      measure_gemm(tables[t], strtoul(size, NULL, 10), seconds);
+  free(list);
+  return 0;
+}
@@ -0,0 +1,120 @@
+#!/bin/bash
+#
+# Runs the tests corpus: every program with an expected output is compiled
+# with each target, assembled, linked with the base runtime and the tensor
+# runtime of this tree, and run; what it writes must be the expected
+# output. Line breaks are not compared: not every expected output has them.
+#
+# usage: check/corpus.sh [test...]                 (default: the whole corpus)
+#
+# Parameters (environment):
+#   UDF        compiler to run                        (./udf)
+#   TESTS      corpus directory                       (../tests)
+#   TARGETS    targets to run                         (asm asm-plain asm64 asm64-plain)
+#   RTS        ix86 base runtime                      (~/compiladores/root/usr/lib/librts.a)
+#   RTS64      x86-64 base runtime                    (librts64.a, next to RTS)
+#   TIMEOUT    seconds each program may run           (10)
+#
+# A target whose base runtime is missing is skipped. The plain targets
+# generate code the way it was before the stack cache and the register
+# allocator; they are run too, so that those paths keep working. Each
+# target also compiles the first test once with UDF_TIME_REPORT=json, and
+# the report must cover every phase from scanning to code generation.
+#
+
+UDF=${UDF:-./udf}
+TESTS=${TESTS:-../tests}
+TARGETS=${TARGETS:-asm asm-plain asm64 asm64-plain}
+RTS=${RTS:-$HOME/compiladores/root/usr/lib/librts.a}
+RTS64=${RTS64:-$(dirname "$RTS")/librts64.a}
+TIMEOUT=${TIMEOUT:-10}
+RUNTIME=$(dirname "$0")/../runtime
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# build: target source program (fails with the step that did)
+build() {
+  local target=$1 source=$2 program=$3
+  "$UDF" --target "$target" -o "$work/p.s" "$source" > "$work/log" 2>&1 || { echo compile; return 1; }
+  case $target in
+    asm|asm-plain)
+      yasm -felf32 -o "$work/p.o" "$work/p.s" >> "$work/log" 2>&1 || { echo assemble; return 1; }
+      ld -m elf_i386 -o "$program" "$work/p.o" "$RUNTIME/libudftensor32.a" "$RTS" >> "$work/log" 2>&1 \
+        || { echo link; return 1; }
+      ;;
+    asm64|asm64-plain)
+      nasm -felf64 -o "$work/p.o" "$work/p.s" >> "$work/log" 2>&1 || { echo assemble; return 1; }
+      ld -o "$program" "$work/p.o" "$RUNTIME/libudftensor.a" "$RTS64" >> "$work/log" 2>&1 || { echo link; return 1; }
+      ;;
+  esac
+}
+
+# run: target test (prints the reason if it fails)
+run() {
+  local target=$1 test=$2 step
+  step=$(build "$target" "$TESTS/$test.udf" "$work/p") || { echo "$step failed"; return 1; }
+  timeout "$TIMEOUT" "$work/p" > "$work/out" 2>> "$work/log"
+  local status=$?
+  [ $status -eq 124 ] && { echo "timed out"; return 1; }
+  cmp -s <(tr -d '\n' < "$work/out") <(tr -d '\n' < "$TESTS/expected/$test.out") \
+    || { echo "wrong output (exit status $status)"; return 1; }
+}
+
+# report: target test (prints the reason if the time report is missing)
+report() {
+  local target=$1 test=$2
+  UDF_TIME_REPORT=json "$UDF" --target "$target" -o "$work/p.s" "$TESTS/$test.udf" > "$work/log" 2>&1 \
+    || { echo "compile failed"; return 1; }
+  grep -q '^{"phases":\[{"name":"scanning",.*"name":"parsing",.*"name":"code generation",' "$work/log" \
+    || { echo "no time report"; return 1; }
+}
+
+if [ ! -x "$UDF" ]; then
+  echo "$0: compiler '$UDF' not found (build it first)" >&2
+  exit 1
+fi
+
+if [ $# -gt 0 ]; then
+  tests=("$@")
+else
+  tests=()
+  for expected in "$TESTS"/expected/*.out; do
+    tests+=("$(basename "$expected" .out)")
+  done
+fi
+
+failed=0
+for target in $TARGETS; do
+  case $target in
+    asm|asm-plain) rts=$RTS ;;
+    asm64|asm64-plain) rts=$RTS64 ;;
+    *)
+      echo "$0: unknown target '$target' (asm, asm-plain, asm64, asm64-plain)" >&2
+      exit 1
+      ;;
+  esac
+  if [ ! -f "$rts" ]; then
+    echo "$target: skipped (no base runtime at $rts)"
+    continue
+  fi
+
+  passed=0 failures=0
+  for test in "${tests[@]}"; do
+    if reason=$(run "$target" "$test"); then
+      passed=$((passed + 1))
+    else
+      failures=$((failures + 1))
+      echo "$target $test: $reason"
+      sed 's/^/  /' "$work/log"
+    fi
+  done
+  if ! reason=$(report "$target" "${tests[0]}"); then
+    failures=$((failures + 1))
+    echo "$target time report: $reason"
+    sed 's/^/  /' "$work/log"
+  fi
+  echo "$target: $passed passed, $failures failed"
+  failed=$((failed + failures))
+done
+[ $failed -eq 0 ]
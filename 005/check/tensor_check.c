@@ -0,0 +1,309 @@
+/*
+ * Behaviour of the tensor runtime, through the functions the generated
+ * code calls: creation, cells and indices, reshaping, dimensions,
+ * equality, products and printing, the errors of each, elementwise
+ * operations large enough to be split among threads, and many small jobs
+ * of the thread pool, one after the other. Every failed check
+ * is reported with its line; the exit status is the number of failures.
+ *
+ * usage: check/tensor_check                          (make check-runtime)
+ *
+ * Parameters (environment):
+ *   UDF_THREADS threads of the large operations and jobs (4)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "tensor.h"
+#include "threads.h"
+
+/* the runtime prints through the base runtime: here, to a descriptor */
+static int output = STDOUT_FILENO;
+void printi(int i) { dprintf(output, "%d", i); }
+void prints(const char *s) { dprintf(output, "%s", s); }
+void printd(double d) { dprintf(output, "%g", d); }
+
+static int checks, failures;
+
+#define CHECK(condition) check((condition), __LINE__, #condition)
+
+static void check(int ok, int line, const char *text) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("tensor_check.c:%d: %s\n", line, text);
+  }
+}
+
+/* What a call printed, or (if it ends the program) the error it reported; status gets the exit status. */
+static const char *run(void (*call)(void *), void *argument, int *status) {
+  static char text[4096];
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("tensor_check");
+    exit(1);
+  }
+  fflush(stdout);
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    output = fds[1];
+    call(argument);
+    _exit(0);
+  }
+  close(fds[1]);
+  size_t length = 0;
+  ssize_t n;
+  while ((n = read(fds[0], text + length, sizeof(text) - 1 - length)) > 0)
+    length += (size_t)n;
+  close(fds[0]);
+  text[length] = '\0';
+  int wstatus = 0;
+  waitpid(child, &wstatus, 0);
+  *status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1;
+  return text;
+}
+
+#define PRINTS(call, argument, text) prints_as(call, argument, text, __LINE__)
+#define FAILS(call, argument, message) fails_with(call, argument, message, __LINE__)
+
+static void prints_as(void (*call)(void *), void *argument, const char *expected, int line) {
+  int status;
+  const char *text = run(call, argument, &status);
+  check(status == 0 && strcmp(text, expected) == 0, line, expected);
+  if (status != 0 || strcmp(text, expected) != 0) printf("  printed: %s (status %d)\n", text, status);
+}
+
+static void fails_with(void (*call)(void *), void *argument, const char *message, int line) {
+  char expected[256];
+  snprintf(expected, sizeof(expected), "tensor runtime: %s\n", message);
+  int status;
+  const char *text = run(call, argument, &status);
+  check(status == 1 && strcmp(text, expected) == 0, line, message);
+  if (status != 1 || strcmp(text, expected) != 0) printf("  printed: %s (status %d)\n", text, status);
+}
+
+/* A tensor with the cells 1, 2, 3... */
+static tensor *counting(tensor *t) {
+  for (int i = 0; i < t->size; i++)
+    tensor_put(i + 1, i, t);
+  return t;
+}
+
+//---------------------------------------------------------------------------
+
+static void print(void *t) { tensor_print(t); }
+static void create_none(void *unused) { (void)unused; tensor_create(0); }
+static void create_empty(void *unused) { (void)unused; tensor_create(2, 3, 0); }
+static void put_outside(void *t) { tensor_put(1, tensor_size(t), t); }
+static void put_before(void *t) { tensor_put(1, -1, t); }
+static void get_outside(void *t) { tensor_getptr(t, 0, 2); } /* row 2 of 2 */
+static void get_negative(void *t) { tensor_getptr(t, -1, 0); }
+static void reshape_bigger(void *t) { tensor_reshape(t, 2, 4, 2); }
+static void dim_past(void *t) { tensor_get_dim_size(t, tensor_get_n_dims(t)); }
+static void dim_negative(void *t) { tensor_get_dim_size(t, -1); }
+static void add_unlike(void *t) { tensor_add(t, tensor_reshape(t, 1, 4)); }
+static void matmul_unlike(void *t) { tensor_matmul(t, t); }
+
+static void creation(void) {
+  tensor *t = tensor_create(3, 2, 3, 4);
+  CHECK(tensor_get_n_dims(t) == 3);
+  CHECK(tensor_get_dims(t)[0] == 2 && tensor_get_dims(t)[1] == 3 && tensor_get_dims(t)[2] == 4);
+  CHECK(tensor_size(t) == 24);
+  int zero = 1;
+  for (int i = 0; i < t->size; i++)
+    zero = zero && t->data[i] == 0;
+  CHECK(zero);
+  CHECK(((size_t)t->data & 63) == 0);
+
+  tensor *ones = tensor_ones(2, 5, 7);
+  int one = 1;
+  for (int i = 0; i < ones->size; i++)
+    one = one && ones->data[i] == 1;
+  CHECK(one && tensor_size(ones) == 35);
+
+  FAILS(create_none, NULL, "bad number of dimensions");
+  FAILS(create_empty, NULL, "dimensions must be positive");
+}
+
+static void cells(void) {
+  tensor *t = tensor_create(2, 2, 3);
+  tensor_put(7, 5, t);
+  tensor_put(4, 1, t);
+  CHECK(*tensor_getptr(t, 2, 1) == 7); /* column first: the indices come last first */
+  CHECK(*tensor_getptr(t, 1, 0) == 4);
+  *tensor_getptr(t, 0, 1) = 9;
+  CHECK(t->data[3] == 9);
+
+  /* read-only cells of a literal are only 8-byte aligned; 15 leaves a tail past the vectors */
+  static const double known[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  tensor *l = tensor_create(2, 3, 5);
+  CHECK(tensor_load(l, known + 1) == l);
+  int loaded = 1;
+  for (int i = 0; i < l->size; i++)
+    loaded = loaded && l->data[i] == i + 1;
+  CHECK(loaded);
+
+  FAILS(put_outside, t, "cell out of bounds");
+  FAILS(put_before, t, "cell out of bounds");
+  FAILS(get_outside, t, "index out of bounds");
+  FAILS(get_negative, t, "index out of bounds");
+}
+
+static void shapes(void) {
+  tensor *t = counting(tensor_create(2, 2, 3));
+  tensor *r = tensor_reshape(t, 3, 3, 1, 2);
+  CHECK(r != t && tensor_get_n_dims(r) == 3 && tensor_size(r) == 6);
+  CHECK(tensor_get_dim_size(r, 0) == 3 && tensor_get_dim_size(r, 1) == 1 && tensor_get_dim_size(r, 2) == 2);
+  CHECK(*tensor_getptr(r, 1, 0, 2) == 6);
+  tensor_put(0, 0, r);
+  CHECK(t->data[0] == 1); /* a copy */
+
+  FAILS(reshape_bigger, t, "reshape changes the number of cells");
+  FAILS(dim_past, t, "dimension out of bounds");
+  FAILS(dim_negative, t, "dimension out of bounds");
+}
+
+static void equality(void) {
+  tensor *a = counting(tensor_create(2, 2, 3)), *b = counting(tensor_create(2, 2, 3));
+  CHECK(tensor_equals(a, b));
+  tensor_put(0.5, 4, b);
+  CHECK(!tensor_equals(a, b));
+  CHECK(!tensor_equals(a, counting(tensor_create(2, 3, 2)))); /* same cells, other shape */
+  CHECK(!tensor_equals(a, counting(tensor_create(1, 6))));
+}
+
+static void arithmetic(void) {
+  tensor *a = counting(tensor_create(2, 2, 2)), *b = tensor_mul_scalar(a, 10);
+  CHECK(b->data[0] == 10 && b->data[3] == 40);
+  tensor *d = tensor_sub(a, b); /* b - a */
+  CHECK(d->data[0] == 9 && d->data[3] == 36);
+  tensor *q = tensor_div(a, b); /* b / a */
+  CHECK(q->data[0] == 10 && q->data[3] == 10);
+  CHECK(tensor_add_scalar(a, 1)->data[3] == 5 && tensor_sub_scalar(a, 1)->data[3] == 3);
+  CHECK(tensor_div_scalar(a, 2)->data[0] == 0.5);
+  CHECK(tensor_add(a, b)->data[1] == 22 && tensor_mul(a, b)->data[1] == 40);
+
+  FAILS(add_unlike, a, "tensor dimensions do not match");
+}
+
+static void products(void) {
+  tensor *a = counting(tensor_create(2, 2, 3)), *b = tensor_create(2, 3, 2);
+  const double cells[] = { 9, 8, 7, 6, 5, 4 };
+  for (int i = 0; i < 6; i++)
+    tensor_put(cells[i], i, b);
+
+  tensor *ab = tensor_matmul(a, b);
+  CHECK(tensor_get_n_dims(ab) == 2 && tensor_get_dim_size(ab, 0) == 2 && tensor_get_dim_size(ab, 1) == 2);
+  CHECK(ab->data[0] == 38 && ab->data[1] == 32 && ab->data[2] == 101 && ab->data[3] == 86);
+  tensor *ba = tensor_matmul(b, a);
+  CHECK(tensor_size(ba) == 9 && ba->data[0] == 41 && ba->data[8] == 39);
+
+  tensor *v = counting(tensor_create(1, 3));
+  tensor *dot = tensor_matmul(v, v);
+  CHECK(tensor_get_n_dims(dot) == 1 && tensor_size(dot) == 1 && dot->data[0] == 14);
+  tensor *row = tensor_matmul(v, b);
+  CHECK(tensor_get_n_dims(row) == 1 && tensor_size(row) == 2 && row->data[0] == 38 && row->data[1] == 32);
+
+  FAILS(matmul_unlike, a, "contracted dimensions do not match");
+}
+
+static void printing(void) {
+  PRINTS(print, counting(tensor_create(2, 2, 2)), "Tensor<2,2>[[1, 2], [3, 4]]");
+  PRINTS(print, counting(tensor_create(3, 2, 1, 2)), "Tensor<2,1,2>[[[1, 2]], [[3, 4]]]");
+  PRINTS(print, tensor_div_scalar(counting(tensor_create(1, 3)), 2), "Tensor<3>[0.5, 1, 1.5]");
+  PRINTS(print, tensor_create(1, 1), "Tensor<1>[0]");
+}
+
+//---------------------------------------------------------------------------
+
+/* Operations over enough cells to be chunked among the threads, against plain loops. */
+static void threaded(void) {
+  const int n = (1 << 17) + 5; /* not a whole number of chunks */
+  tensor *a = tensor_create(2, 3, n), *b = tensor_create(2, 3, n);
+  const int size = tensor_size(a);
+  for (int i = 0; i < size; i++) {
+    tensor_put((double)(i % 1000) / 7 - 50, i, a);
+    tensor_put((double)(i % 997) / 3 + 1, i, b); /* never zero */
+  }
+
+  tensor *sum = tensor_add(a, b), *difference = tensor_sub(b, a), *product = tensor_mul(a, b);
+  tensor *quotient = tensor_div(b, a), *plus = tensor_add_scalar(a, 1.5), *minus = tensor_sub_scalar(a, 1.5);
+  tensor *times = tensor_mul_scalar(a, 1.5), *over = tensor_div_scalar(a, 1.5);
+  int ok[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+  for (int i = 0; i < size; i++) {
+    const double x = a->data[i], y = b->data[i];
+    ok[0] = ok[0] && sum->data[i] == x + y;
+    ok[1] = ok[1] && difference->data[i] == x - y;
+    ok[2] = ok[2] && product->data[i] == x * y;
+    ok[3] = ok[3] && quotient->data[i] == x / y;
+    ok[4] = ok[4] && plus->data[i] == x + 1.5;
+    ok[5] = ok[5] && minus->data[i] == x - 1.5;
+    ok[6] = ok[6] && times->data[i] == x * 1.5;
+    ok[7] = ok[7] && over->data[i] == x / 1.5;
+  }
+  CHECK(ok[0]);
+  CHECK(ok[1]);
+  CHECK(ok[2]);
+  CHECK(ok[3]);
+  CHECK(ok[4]);
+  CHECK(ok[5]);
+  CHECK(ok[6]);
+  CHECK(ok[7]);
+  CHECK(tensor_equals(a, tensor_reshape(a, 2, 3, n)));
+  CHECK(!tensor_equals(a, b));
+}
+
+/* Each task of a job marks its cell; a task lost or run twice leaves the count wrong. */
+static void mark(void *context, size_t i, size_t thread) {
+  (void)thread;
+  __atomic_add_fetch((int *)context + i, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Many small jobs of the same size, back to back: a thief that read a range
+ * of one job must not take it for the same range of the next. A lost task
+ * would leave the caller waiting for ever, hence the alarm.
+ */
+static void jobs(void) {
+  enum { JOBS = 200000, TASKS = 8 };
+  int counts[TASKS], wrong = 0;
+  alarm(60);
+  for (int j = 0; j < JOBS && !wrong; j++) {
+    for (int i = 0; i < TASKS; i++)
+      counts[i] = 0;
+    tensor_parallel_for(TASKS, mark, counts);
+    for (int i = 0; i < TASKS; i++)
+      wrong = wrong || counts[i] != 1;
+  }
+  alarm(0);
+  CHECK(!wrong);
+}
+
+int main(int argc, char *argv[]) {
+  (void)argc;
+  /* the runtime reads its environment back from /proc: set the default and start again */
+  if (getenv("UDF_THREADS") == NULL) {
+    setenv("UDF_THREADS", "4", 1);
+    execv("/proc/self/exe", argv);
+  }
+
+  /* the checks that end a program run in a child: do them before any thread starts */
+  creation();
+  cells();
+  shapes();
+  equality();
+  arithmetic();
+  products();
+  printing();
+  threaded();
+  jobs();
+
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures;
+}
@@ -0,0 +1,6 @@
+#include "identifier.h"
+#include "arena.h"
+
+const std::string *udf::intern(std::string_view text) {
+  return udf::arena::current().intern(text);
+}
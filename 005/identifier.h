@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <cdk/ast/variable_node.h>
+
+namespace udf {
+
+  /**
+   * Return the canonical copy of a string. Identifiers and string literals
+   * are kept once per compilation unit, in its arena (see arena::intern),
+   * so equal texts share the same address until the arena is released.
+   */
+  const std::string *intern(std::string_view text);
+
+  /**
+   * Interned identifier: a handle to the canonical copy of a name.
+   * Comparing and hashing identifiers never looks at the characters.
+   */
+  class identifier {
+    const std::string *_name;
+
+    struct canonical {};
+    identifier(const std::string *name, canonical) :
+        _name(name) {
+    }
+
+  public:
+    identifier() :
+        _name(intern("")) {
+    }
+    identifier(const std::string &name) :
+        _name(intern(name)) {
+    }
+    identifier(const char *name) :
+        _name(intern(name)) {
+    }
+
+    /** Identifier of text that is already interned: the pool is not searched. */
+    static identifier interned(const std::string *name) {
+      return identifier(name, canonical());
+    }
+
+  public:
+    const std::string &str() const {
+      return *_name;
+    }
+    operator const std::string&() const {
+      return *_name;
+    }
+
+    bool operator==(const identifier &other) const {
+      return _name == other._name;
+    }
+    bool operator!=(const identifier &other) const {
+      return _name != other._name;
+    }
+
+    std::size_t hash() const {
+      return std::hash<const void*>()(_name);
+    }
+  };
+
+  /**
+   * Variable node that keeps the interned copy of its name. The parser
+   * builds every variable node this way (see arena::variable).
+   */
+  class interned_variable_node: public cdk::variable_node {
+    identifier _identifier;
+
+  public:
+    interned_variable_node(int lineno, const std::string *name) :
+        cdk::variable_node(lineno, *name), _identifier(identifier::interned(name)) {
+    }
+
+    const identifier &id() const {
+      return _identifier;
+    }
+  };
+
+  /** Name of a variable node: uses are resolved without hashing their text again. */
+  inline identifier name_of(const cdk::variable_node *node) {
+    return static_cast<const interned_variable_node*>(node)->id();
+  }
+
+} // udf
+
+template<>
+struct std::hash<udf::identifier> {
+  std::size_t operator()(const udf::identifier &id) const {
+    return id.hash();
+  }
+};
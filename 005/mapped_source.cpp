@@ -0,0 +1,54 @@
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cdk/compiler.h>
+#include "mapped_source.h"
+#include "arena.h"
+
+//---------------------------------------------------------------------------
+
+udf::mapped_source::mapped_source(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  // flex keeps buffer sizes in ints
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size < INT_MAX - 2) {
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t size = st.st_size;
+    std::size_t span = (size + 2 + page - 1) / page * page;
+
+    // zero-filled reservation, with the file mapped over its beginning:
+    // whatever follows the file's last byte reads as NUL
+    void *base = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED) {
+      if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        madvise(base, size, MADV_SEQUENTIAL);
+        _text = static_cast<char*>(base);
+        _size = size;
+        _span = span;
+      } else {
+        munmap(base, span);
+      }
+    }
+  }
+  close(fd);
+}
+
+udf::mapped_source::~mapped_source() {
+  if (_text != nullptr) munmap(_text, _span);
+}
+
+//---------------------------------------------------------------------------
+
+bool udf::mapped_source::scan(std::shared_ptr<cdk::compiler> compiler) {
+  if (compiler->ifile().empty() || compiler->scanner() == nullptr) return false;
+
+  auto source = udf::arena::current().make<udf::mapped_source>(compiler->ifile());
+  if (!source->mapped()) return false;
+
+  udf::scan_in_place(compiler->scanner(), source->text(), source->size());
+  return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class FlexLexer;
+
+namespace cdk {
+  class compiler;
+}
+
+namespace udf {
+
+  /**
+   * Scan the text in place: it must be followed by two NUL characters
+   * (not counted in size), and it is modified while being scanned.
+   * Defined with the scanner.
+   */
+  void scan_in_place(FlexLexer *scanner, char *text, std::size_t size);
+
+  /**
+   * Source file mapped in memory, followed by the two NUL characters
+   * the scanner expects. The mapping is private: the scanner's changes
+   * never reach the file.
+   */
+  class mapped_source {
+    char *_text = nullptr;
+    std::size_t _size = 0;
+    std::size_t _span = 0;
+
+  public:
+    explicit mapped_source(const std::string &filename);
+    ~mapped_source();
+
+    mapped_source(const mapped_source&) = delete;
+    mapped_source &operator=(const mapped_source&) = delete;
+
+  public:
+    bool mapped() const {
+      return _text != nullptr;
+    }
+    char *text() {
+      return _text;
+    }
+    std::size_t size() const {
+      return _size;
+    }
+
+  public:
+    /**
+     * Make the compiler's scanner read the input file directly from memory.
+     * The mapping lives in the compilation unit's arena. Returns false (and
+     * the scanner keeps reading its stream) if the input cannot be mapped.
+     */
+    static bool scan(std::shared_ptr<cdk::compiler> compiler);
+  };
+
+} // udf
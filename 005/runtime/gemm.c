@@ -0,0 +1,118 @@
+/*
+ * Matrix product blocked for the caches (Goto's algorithm, as in BLIS).
+ * A panel of b, KC rows by NC columns, is packed for the last-level
+ * cache; a block of a, MC rows by KC columns, for the second-level one;
+ * the register tile of the kernel table (mr by nr cells of c) then runs
+ * over a strip of each, which stays in the first-level cache. Packing
+ * lays out each strip in the order the tile reads it, padded with zeros
+ * to whole tiles; tiles at the edges of c are computed apart and only
+ * their valid cells added. Large products are split into blocks of c,
+ * MC rows each, that the threads compute with packing buffers of their
+ * own.
+ */
+
+#include "gemm.h"
+#include "kernels.h"
+#include "memory.h"
+#include "threads.h"
+
+#define KC 256
+#define MC 96     /* a multiple of every mr */
+#define NC 2048   /* a multiple of every nr */
+#define MAX_TILE 64
+#define PARALLEL (1 << 21) /* multiply-adds below which the product stays in one thread */
+
+struct product {
+  const struct tensor_kernels *kernels;
+  size_t m, n, k;
+  const double *a, *b;
+  double *c;
+  size_t columns; /* of each task's block */
+};
+
+/* packing buffers of each thread, allocated when first needed and reused */
+static struct buffers {
+  double *a, *b;
+} buffers[TENSOR_MAX_THREADS];
+static size_t n_buffers;
+
+/* Rows pc.. of columns jc.. of b (kc by nc), in strips of nr columns. */
+static void pack_b(const double *b, size_t n, size_t pc, size_t kc, size_t jc, size_t nc, size_t nr, double *to) {
+  for (size_t j0 = 0; j0 < nc; j0 += nr)
+    for (size_t p = 0; p < kc; p++) {
+      const double *row = b + (pc + p) * n + jc + j0;
+      for (size_t j = 0; j < nr; j++)
+        *to++ = j0 + j < nc ? row[j] : 0;
+    }
+}
+
+/* Columns pc.. of rows ic.. of a (mc by kc), in strips of mr rows. */
+static void pack_a(const double *a, size_t k, size_t ic, size_t mc, size_t pc, size_t kc, size_t mr, double *to) {
+  for (size_t i0 = 0; i0 < mc; i0 += mr)
+    for (size_t p = 0; p < kc; p++) {
+      const double *column = a + (ic + i0) * k + pc + p;
+      for (size_t i = 0; i < mr; i++)
+        *to++ = i0 + i < mc ? column[i * k] : 0;
+    }
+}
+
+/* c[i0, i1) x [j0, j1) of the product, with a thread's packing buffers. */
+static void rectangle(const struct product *p, size_t i0, size_t i1, size_t j0, size_t j1, const struct buffers *packed) {
+  const struct tensor_kernels *kernels = p->kernels;
+  const size_t mr = kernels->mr, nr = kernels->nr, n = p->n, k = p->k;
+  for (size_t jc = j0; jc < j1; jc += NC) {
+    const size_t nc = j1 - jc < NC ? j1 - jc : NC;
+    for (size_t pc = 0; pc < k; pc += KC) {
+      const size_t kc = k - pc < KC ? k - pc : KC;
+      pack_b(p->b, n, pc, kc, jc, nc, nr, packed->b);
+      for (size_t ic = i0; ic < i1; ic += MC) {
+        const size_t mc = i1 - ic < MC ? i1 - ic : MC;
+        pack_a(p->a, k, ic, mc, pc, kc, mr, packed->a);
+        for (size_t jr = 0; jr < nc; jr += nr)
+          for (size_t ir = 0; ir < mc; ir += mr) {
+            const double *strip_a = packed->a + ir * kc, *strip_b = packed->b + jr * kc;
+            double *tile = p->c + (ic + ir) * n + jc + jr;
+            if (ir + mr <= mc && jr + nr <= nc) {
+              kernels->gemm_tile(kc, strip_a, strip_b, tile, n);
+              continue;
+            }
+            double edge[MAX_TILE];
+            for (size_t i = 0; i < mr * nr; i++)
+              edge[i] = 0;
+            kernels->gemm_tile(kc, strip_a, strip_b, edge, nr);
+            for (size_t i = 0; i < mr && ir + i < mc; i++)
+              for (size_t j = 0; j < nr && jr + j < nc; j++)
+                tile[i * n + j] += edge[i * nr + j];
+          }
+      }
+    }
+  }
+}
+
+/* Task i: a block of MC rows by p->columns columns. */
+static void block(void *context, size_t i, size_t thread) {
+  const struct product *p = context;
+  const size_t blocks = (p->n + p->columns - 1) / p->columns;
+  const size_t i0 = i / blocks * MC, j0 = i % blocks * p->columns;
+  const size_t i1 = p->m - i0 < MC ? p->m : i0 + MC, j1 = p->n - j0 < p->columns ? p->n : j0 + p->columns;
+  rectangle(p, i0, i1, j0, j1, &buffers[thread]);
+}
+
+void tensor_gemm(size_t m, size_t n, size_t k, const double *a, const double *b, double *c) {
+  struct product p = { tensor_kernels_in_use(), m, n, k, a, b, c, NC };
+  const size_t threads = (double)m * n * k < PARALLEL ? 1 : tensor_threads();
+  for (; n_buffers < threads; n_buffers++) { /* once: the number of threads does not change */
+    buffers[n_buffers].a = tensor_alloc(MC * KC * sizeof(double));
+    buffers[n_buffers].b = tensor_alloc(KC * NC * sizeof(double));
+  }
+
+  if (threads == 1) {
+    rectangle(&p, 0, m, 0, n, &buffers[0]);
+    return;
+  }
+  /* narrower blocks until there are a few per thread */
+  const size_t rows = (m + MC - 1) / MC;
+  while (p.columns > 64 && rows * ((n + p.columns - 1) / p.columns) < 4 * threads)
+    p.columns /= 2;
+  tensor_parallel_for(rows * ((n + p.columns - 1) / p.columns), block, &p);
+}
@@ -0,0 +1,13 @@
+#ifndef UDF_RUNTIME_GEMM_H
+#define UDF_RUNTIME_GEMM_H
+
+#include <stddef.h>
+
+/*
+ * c += a b, for row-major matrices: a is m by k, b k by n, c m by n. Any
+ * tensor is such a matrix without copying: its rows are its last
+ * dimension (or its first, for the rest).
+ */
+void tensor_gemm(size_t m, size_t n, size_t k, const double *a, const double *b, double *c);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Choice of the kernel table. The processor is asked with cpuid; AVX also
+ * needs the operating system to save the upper halves of the registers,
+ * which xgetbv tells.
+ */
+
+#include <cpuid.h>
+#include "kernels.h"
+
+const struct tensor_kernels *tensor_kernels;
+
+/* Whether the kernel saves the SSE and AVX state (XCR0 bits 1 and 2). */
+static int avx_state(void) {
+  unsigned low, high;
+  __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+  return (low & 0x6) == 0x6;
+}
+
+const struct tensor_kernels *tensor_select_kernels(void) {
+  unsigned a, b, c, d;
+  if (!__get_cpuid(1, &a, &b, &c, &d)) return &tensor_kernels_scalar;
+  const int sse2 = (d & bit_SSE2) != 0;
+  const int avx_fma = (c & bit_OSXSAVE) && (c & bit_AVX) && (c & bit_FMA) && avx_state();
+  if (avx_fma && __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2)) return &tensor_kernels_avx2;
+  return sse2 ? &tensor_kernels_sse2 : &tensor_kernels_scalar;
+}
@@ -0,0 +1,50 @@
+#ifndef UDF_RUNTIME_KERNELS_H
+#define UDF_RUNTIME_KERNELS_H
+
+#include <stddef.h>
+
+/*
+ * Cell loops of the elementwise operations, one table per instruction
+ * set. The result may be one of the operands; all arrays hold n doubles.
+ * The first operation selects the widest table the processor (and the
+ * kernel, for the AVX state) supports.
+ */
+struct tensor_kernels {
+  const char *name;
+  void (*add)(double *r, const double *a, const double *b, size_t n);
+  void (*sub)(double *r, const double *a, const double *b, size_t n);
+  void (*mul)(double *r, const double *a, const double *b, size_t n);
+  void (*div)(double *r, const double *a, const double *b, size_t n);
+  void (*add_scalar)(double *r, const double *a, double s, size_t n);
+  void (*sub_scalar)(double *r, const double *a, double s, size_t n);
+  void (*mul_scalar)(double *r, const double *a, double s, size_t n);
+  void (*div_scalar)(double *r, const double *a, double s, size_t n);
+  void (*fill)(double *r, double s, size_t n);
+  void (*copy)(double *r, const double *a, size_t n);
+  int (*equals)(const double *a, const double *b, size_t n);
+
+  /*
+   * Register tile of the matrix product (see gemm.c): c, mr rows of nr
+   * cells, ldc cells apart, gets a times b added, where a holds k columns
+   * of mr cells and b k rows of nr cells, one after the other.
+   */
+  size_t mr, nr;
+  void (*gemm_tile)(size_t k, const double *a, const double *b, double *c, size_t ldc);
+};
+
+extern const struct tensor_kernels tensor_kernels_scalar;
+extern const struct tensor_kernels tensor_kernels_sse2;
+extern const struct tensor_kernels tensor_kernels_avx2;
+
+/* The table in use, or NULL if none was selected yet. */
+extern const struct tensor_kernels *tensor_kernels;
+
+/* The widest table this machine runs. */
+const struct tensor_kernels *tensor_select_kernels(void);
+
+static inline const struct tensor_kernels *tensor_kernels_in_use(void) {
+  if (tensor_kernels == NULL) tensor_kernels = tensor_select_kernels();
+  return tensor_kernels;
+}
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * AVX2 kernels: four cells per instruction; 6x8 product tiles, whose
+ * twelve accumulators leave registers for a row of b and a broadcast.
+ * Doubles only need AVX instructions, but the table is selected for
+ * processors with AVX2 and FMA, and products are fused with the sums
+ * they feed.
+ */
+
+#pragma GCC target("avx2,fma")
+#pragma GCC optimize("fp-contract=fast")
+
+#define LANES 4
+#define MR 6
+#define NAME "avx2"
+#define TABLE tensor_kernels_avx2
+#include "kernels_vector.h"
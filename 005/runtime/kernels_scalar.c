@@ -0,0 +1,64 @@
+/*
+ * Portable kernels: one cell at a time. They are also the reference the
+ * vector kernels are measured against (see bench/tensor_bench.c), so the
+ * compiler is not allowed to vectorize them.
+ */
+
+#pragma GCC optimize("no-tree-vectorize")
+
+#include "kernels.h"
+
+#define BINARY(name, op) \
+  static void name(double *r, const double *a, const double *b, size_t n) { \
+    for (size_t i = 0; i < n; i++) r[i] = a[i] op b[i]; \
+  }
+
+#define SCALAR(name, op) \
+  static void name(double *r, const double *a, double s, size_t n) { \
+    for (size_t i = 0; i < n; i++) r[i] = a[i] op s; \
+  }
+
+BINARY(add, +)
+BINARY(sub, -)
+BINARY(mul, *)
+BINARY(divide, /)
+SCALAR(add_scalar, +)
+SCALAR(sub_scalar, -)
+SCALAR(mul_scalar, *)
+SCALAR(div_scalar, /)
+
+static void fill(double *r, double s, size_t n) {
+  for (size_t i = 0; i < n; i++) r[i] = s;
+}
+
+static void copy(double *r, const double *a, size_t n) {
+  for (size_t i = 0; i < n; i++) r[i] = a[i];
+}
+
+static int equals(const double *a, const double *b, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    if (a[i] != b[i]) return 0;
+  return 1;
+}
+
+#define MR 4
+#define NR 4
+
+static void gemm_tile(size_t k, const double *a, const double *b, double *c, size_t ldc) {
+  double t[MR][NR];
+  for (int i = 0; i < MR; i++)
+    for (int j = 0; j < NR; j++)
+      t[i][j] = 0;
+  for (size_t p = 0; p < k; p++, a += MR, b += NR)
+    for (int i = 0; i < MR; i++)
+      for (int j = 0; j < NR; j++)
+        t[i][j] += a[i] * b[j];
+  for (int i = 0; i < MR; i++)
+    for (int j = 0; j < NR; j++)
+      c[i * ldc + j] += t[i][j];
+}
+
+const struct tensor_kernels tensor_kernels_scalar = {
+  "scalar", add, sub, mul, divide, add_scalar, sub_scalar, mul_scalar, div_scalar, fill, copy, equals,
+  MR, NR, gemm_tile
+};
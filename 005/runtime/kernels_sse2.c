@@ -0,0 +1,9 @@
+/* SSE2 kernels: two cells per instruction; 4x4 product tiles. */
+
+#pragma GCC target("sse2")
+
+#define LANES 2
+#define MR 4
+#define NAME "sse2"
+#define TABLE tensor_kernels_sse2
+#include "kernels_vector.h"
@@ -0,0 +1,112 @@
+/*
+ * Body of the vector kernel tables, included once per instruction set
+ * with LANES (doubles per register), MR (rows of the matrix product's
+ * register tile, two registers wide), NAME and TABLE defined and the
+ * target selected. GCC vector types keep it free of the intrinsics
+ * headers, which need the C library: two registers per iteration, then
+ * the last few cells one at a time.
+ */
+
+#include "kernels.h"
+
+typedef double vector __attribute__((vector_size(LANES * sizeof(double)), aligned(sizeof(double)), may_alias));
+typedef long long mask __attribute__((vector_size(LANES * sizeof(double))));
+
+/* every lane s (a scalar conversion is refused when doubles are x87 long doubles) */
+#define SPLAT(v, s) \
+  vector v; \
+  for (int lane = 0; lane < LANES; lane++) v[lane] = (s)
+
+#define AT(p) (*(vector *)(p))
+#define AT_CONST(p) (*(const vector *)(p))
+
+#define BINARY(name, op) \
+  static void name(double *r, const double *a, const double *b, size_t n) { \
+    size_t i = 0; \
+    for (; i + 2 * LANES <= n; i += 2 * LANES) { \
+      vector x0 = AT_CONST(a + i) op AT_CONST(b + i); \
+      vector x1 = AT_CONST(a + i + LANES) op AT_CONST(b + i + LANES); \
+      AT(r + i) = x0; \
+      AT(r + i + LANES) = x1; \
+    } \
+    for (; i < n; i++) r[i] = a[i] op b[i]; \
+  }
+
+#define SCALAR(name, op) \
+  static void name(double *r, const double *a, double s, size_t n) { \
+    SPLAT(v, s); \
+    size_t i = 0; \
+    for (; i + 2 * LANES <= n; i += 2 * LANES) { \
+      vector x0 = AT_CONST(a + i) op v; \
+      vector x1 = AT_CONST(a + i + LANES) op v; \
+      AT(r + i) = x0; \
+      AT(r + i + LANES) = x1; \
+    } \
+    for (; i < n; i++) r[i] = a[i] op s; \
+  }
+
+BINARY(add, +)
+BINARY(sub, -)
+BINARY(mul, *)
+BINARY(divide, /)
+SCALAR(add_scalar, +)
+SCALAR(sub_scalar, -)
+SCALAR(mul_scalar, *)
+SCALAR(div_scalar, /)
+
+static void fill(double *r, double s, size_t n) {
+  SPLAT(v, s);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES)
+    AT(r + i) = v;
+  for (; i < n; i++) r[i] = s;
+}
+
+static void copy(double *r, const double *a, size_t n) {
+  size_t i = 0;
+  for (; i + 2 * LANES <= n; i += 2 * LANES) {
+    vector x0 = AT_CONST(a + i), x1 = AT_CONST(a + i + LANES);
+    AT(r + i) = x0;
+    AT(r + i + LANES) = x1;
+  }
+  for (; i < n; i++) r[i] = a[i];
+}
+
+/* NaN is not equal to itself, as with the scalar comparison. */
+static int equals(const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 2 * LANES <= n; i += 2 * LANES) {
+    mask e = (AT_CONST(a + i) == AT_CONST(b + i)) & (AT_CONST(a + i + LANES) == AT_CONST(b + i + LANES));
+    for (int lane = 0; lane < LANES; lane++)
+      if (e[lane] == 0) return 0;
+  }
+  for (; i < n; i++)
+    if (a[i] != b[i]) return 0;
+  return 1;
+}
+
+/* 2 * MR accumulators; each cell of a is broadcast and multiplies a row of b. */
+static void gemm_tile(size_t k, const double *a, const double *b, double *c, size_t ldc) {
+  vector c0[MR], c1[MR];
+  for (int i = 0; i < MR; i++) {
+    SPLAT(zero, 0);
+    c0[i] = c1[i] = zero;
+  }
+  for (size_t p = 0; p < k; p++, a += MR, b += 2 * LANES) {
+    const vector b0 = AT_CONST(b), b1 = AT_CONST(b + LANES);
+    for (int i = 0; i < MR; i++) {
+      SPLAT(x, a[i]);
+      c0[i] += x * b0;
+      c1[i] += x * b1;
+    }
+  }
+  for (int i = 0; i < MR; i++) {
+    AT(c + i * ldc) += c0[i];
+    AT(c + i * ldc + LANES) += c1[i];
+  }
+}
+
+const struct tensor_kernels TABLE = {
+  NAME, add, sub, mul, divide, add_scalar, sub_scalar, mul_scalar, div_scalar, fill, copy, equals,
+  MR, 2 * LANES, gemm_tile
+};
@@ -0,0 +1,33 @@
+#include "memory.h"
+#include "system.h"
+
+#define ALIGNMENT 64
+#define CHUNK (4u << 20) /* bytes mapped at a time; larger blocks are mapped alone */
+
+void prints(const char *s); /* base runtime */
+
+static char *next, *end; /* free part of the current chunk */
+
+void *tensor_alloc(size_t bytes) {
+  bytes = (bytes + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+  if (bytes > CHUNK / 4) {
+    void *block = sys_map(bytes);
+    if (block == NULL) tensor_fail("out of memory");
+    return block;
+  }
+  if (next == NULL || (size_t)(end - next) < bytes) {
+    next = sys_map(CHUNK);
+    if (next == NULL) tensor_fail("out of memory");
+    end = next + CHUNK;
+  }
+  void *block = next;
+  next += bytes;
+  return block;
+}
+
+void tensor_fail(const char *message) {
+  prints("tensor runtime: ");
+  prints(message);
+  prints("\n");
+  sys_exit(1);
+}
@@ -0,0 +1,15 @@
+#ifndef UDF_RUNTIME_MEMORY_H
+#define UDF_RUNTIME_MEMORY_H
+
+#include <stddef.h>
+
+/*
+ * Bump allocation from large mappings: tensors live until the program
+ * ends. Blocks are 64-byte aligned (a cache line, two AVX registers).
+ */
+void *tensor_alloc(size_t bytes);
+
+/* Report a runtime error and end the program. */
+__attribute__((noreturn)) void tensor_fail(const char *message);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Linux system calls for both targets: syscall on x86-64, int 0x80 on
+ * ix86 (whose mmap takes its six arguments in memory). New threads start
+ * in assembly: they must not return through the frame of the caller of
+ * clone, which is on another stack.
+ */
+
+#include "system.h"
+
+#define PROT_READ_WRITE 0x3
+#define MAP_PRIVATE_ANONYMOUS 0x22
+#define FUTEX_WAIT_PRIVATE 128
+#define FUTEX_WAKE_PRIVATE 129
+
+/* the thread shares everything but its stack; its id is set in the parent and cleared when it ends */
+#define CLONE_THREAD_FLAGS 0x350f00
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+#if defined(__x86_64__)
+
+#define SYS_READ 0
+#define SYS_OPEN 2
+#define SYS_CLOSE 3
+#define SYS_FUTEX 202
+#define SYS_SCHED_GETAFFINITY 204
+
+static long call6(long number, long a, long b, long c, long d, long e, long f) {
+  long result;
+  register long r10 __asm__("r10") = d;
+  register long r8 __asm__("r8") = e;
+  register long r9 __asm__("r9") = f;
+  __asm__ volatile("syscall"
+                   : "=a"(result)
+                   : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+                   : "rcx", "r11", "memory");
+  return result;
+}
+
+static long call(long number, long a, long b, long c, long d) {
+  return call6(number, a, b, c, d, 0, 0);
+}
+
+void *sys_map(size_t bytes) {
+  long result = call6(9, 0, (long)bytes, PROT_READ_WRITE, MAP_PRIVATE_ANONYMOUS, -1, 0);
+  return (unsigned long)result > -4096UL ? NULL : (void *)result;
+}
+
+void sys_exit(int status) {
+  for (;;) call(231, status, 0, 0, 0);
+}
+
+/* rdi: stack top, rsi: function, rdx: argument, rcx: thread id */
+__asm__(".pushsection .text\n"
+        ".globl sys_thread\n"
+        ".type sys_thread, @function\n"
+        "sys_thread:\n"
+        "  and $-16, %rdi\n"
+        "  sub $16, %rdi\n"
+        "  mov %rsi, (%rdi)\n"
+        "  mov %rdx, 8(%rdi)\n"
+        "  mov %rcx, %rdx\n"
+        "  mov %rcx, %r10\n"
+        "  mov %rdi, %rsi\n"
+        "  mov $" XSTR(CLONE_THREAD_FLAGS) ", %edi\n"
+        "  xor %r8d, %r8d\n"
+        "  mov $56, %eax\n"
+        "  syscall\n"
+        "  test %rax, %rax\n"
+        "  jnz 1f\n"
+        "  pop %rax\n"
+        "  pop %rdi\n"
+        "  call *%rax\n"
+        "  mov $60, %eax\n"
+        "  xor %edi, %edi\n"
+        "  syscall\n"
+        "  hlt\n"
+        "1:\n"
+        "  ret\n"
+        ".size sys_thread, .-sys_thread\n"
+        ".popsection\n");
+
+#elif defined(__i386__)
+
+#define SYS_READ 3
+#define SYS_OPEN 5
+#define SYS_CLOSE 6
+#define SYS_FUTEX 240
+#define SYS_SCHED_GETAFFINITY 242
+
+static long call(long number, long a, long b, long c, long d) {
+  long result;
+  __asm__ volatile("int $0x80" : "=a"(result) : "a"(number), "b"(a), "c"(b), "d"(c), "S"(d) : "memory");
+  return result;
+}
+
+void *sys_map(size_t bytes) {
+  long arguments[6] = { 0, (long)bytes, PROT_READ_WRITE, MAP_PRIVATE_ANONYMOUS, -1, 0 };
+  long result = call(90, (long)arguments, 0, 0, 0);
+  return (unsigned long)result > -4096UL ? NULL : (void *)result;
+}
+
+void sys_exit(int status) {
+  for (;;) call(252, status, 0, 0, 0);
+}
+
+/* stack top, function, argument and thread id on the stack; the function gets its argument on a 16-byte boundary */
+__asm__(".pushsection .text\n"
+        ".globl sys_thread\n"
+        ".type sys_thread, @function\n"
+        "sys_thread:\n"
+        "  push %ebx\n"
+        "  push %esi\n"
+        "  push %edi\n"
+        "  mov 16(%esp), %ecx\n"
+        "  and $-16, %ecx\n"
+        "  sub $20, %ecx\n"
+        "  mov 20(%esp), %eax\n"
+        "  mov %eax, (%ecx)\n"
+        "  mov 24(%esp), %eax\n"
+        "  mov %eax, 4(%ecx)\n"
+        "  mov 28(%esp), %edx\n"
+        "  mov %edx, %edi\n"
+        "  xor %esi, %esi\n"
+        "  mov $" XSTR(CLONE_THREAD_FLAGS) ", %ebx\n"
+        "  mov $120, %eax\n"
+        "  int $0x80\n"
+        "  test %eax, %eax\n"
+        "  jnz 1f\n"
+        "  pop %eax\n"
+        "  call *%eax\n"
+        "  mov $1, %eax\n"
+        "  xor %ebx, %ebx\n"
+        "  int $0x80\n"
+        "  hlt\n"
+        "1:\n"
+        "  pop %edi\n"
+        "  pop %esi\n"
+        "  pop %ebx\n"
+        "  ret\n"
+        ".size sys_thread, .-sys_thread\n"
+        ".popsection\n");
+
+#else
+#error "the tensor runtime supports x86-64 and ix86 Linux only"
+#endif
+
+int sys_wait(volatile int *word, int value, int milliseconds) {
+  struct { long seconds, nanoseconds; } timeout = { milliseconds / 1000, milliseconds % 1000 * 1000000L };
+  return (int)call(SYS_FUTEX, (long)word, FUTEX_WAIT_PRIVATE, value, milliseconds > 0 ? (long)&timeout : 0);
+}
+
+void sys_wake(volatile int *word, int count) {
+  call(SYS_FUTEX, (long)word, FUTEX_WAKE_PRIVATE, count, 0);
+}
+
+int sys_cpus(void) {
+  unsigned long mask[16];
+  long bytes = call(SYS_SCHED_GETAFFINITY, 0, sizeof(mask), (long)mask, 0);
+  if (bytes <= 0) return 1;
+  int cpus = 0;
+  for (size_t i = 0; i < (size_t)bytes / sizeof(mask[0]); i++)
+    for (unsigned long bits = mask[i]; bits != 0; bits &= bits - 1)
+      cpus++;
+  return cpus > 0 ? cpus : 1;
+}
+
+/* The environment is read back from /proc: the base runtime does not keep it. */
+const char *sys_getenv(const char *name, char *buffer, size_t size) {
+  long fd = call(SYS_OPEN, (long)"/proc/self/environ", 0, 0, 0);
+  if (fd < 0) return NULL;
+
+  enum { MATCHING, SKIPPING, COPYING, FOUND } state = MATCHING;
+  size_t matched = 0, length = 0; /* of "name=" at the start of the entry; of the value */
+  char chunk[512];
+  long bytes;
+  while (state != FOUND && (bytes = call(SYS_READ, fd, (long)chunk, sizeof(chunk), 0)) > 0)
+    for (long i = 0; i < bytes && state != FOUND; i++) {
+      const char c = chunk[i];
+      if (state == MATCHING) {
+        if (name[matched] == '\0' && c == '=')
+          state = COPYING;
+        else if (name[matched] != '\0' && c == name[matched])
+          matched++;
+        else if (c != '\0')
+          state = SKIPPING;
+        else
+          matched = 0;
+      } else if (state == SKIPPING) {
+        if (c == '\0') state = MATCHING, matched = 0;
+      } else if (c == '\0')
+        state = FOUND;
+      else if (length + 1 < size)
+        buffer[length++] = c;
+    }
+  call(SYS_CLOSE, fd, 0, 0, 0);
+  if (state != FOUND && state != COPYING) return NULL; /* the last entry may lack its terminator */
+  buffer[length] = '\0';
+  return buffer;
+}
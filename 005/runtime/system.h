@@ -0,0 +1,38 @@
+#ifndef UDF_RUNTIME_SYSTEM_H
+#define UDF_RUNTIME_SYSTEM_H
+
+#include <stddef.h>
+
+/*
+ * The few system calls the runtime makes, without the C library: the
+ * generated programs are linked with the base runtime alone.
+ */
+
+/* New zeroed pages, or NULL. */
+void *sys_map(size_t bytes);
+
+__attribute__((noreturn)) void sys_exit(int status);
+
+/*
+ * A thread running function(argument) on a stack (given by its top) and
+ * sharing everything else. *tid holds its id as soon as this returns and
+ * becomes zero (waking sys_wait) once it has ended and left the stack.
+ * Negative on failure.
+ */
+long sys_thread(void *stack, void (*function)(void *), void *argument, volatile int *tid);
+
+/*
+ * Sleep while *word is value, for at most the given time (none if not
+ * positive). Zero when woken (or spuriously), negative otherwise: -110
+ * on timeout, -11 if *word was no longer value.
+ */
+int sys_wait(volatile int *word, int value, int milliseconds);
+void sys_wake(volatile int *word, int count);
+
+/* Processors the program may run on. */
+int sys_cpus(void);
+
+/* Value of an environment variable, copied to buffer (and cut to fit), or NULL. */
+const char *sys_getenv(const char *name, char *buffer, size_t size);
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdarg.h>
+#include "tensor.h"
+#include "gemm.h"
+#include "kernels.h"
+#include "memory.h"
+#include "threads.h"
+
+#define MAX_DIMS 64
+
+void printi(int i); /* base runtime */
+void prints(const char *s);
+void printd(double d);
+
+/* Header, dimensions and cells in one block; the cells start on a cache line. */
+static tensor *make(int n_dims, const int *dims) {
+  if (n_dims <= 0 || n_dims > MAX_DIMS) tensor_fail("bad number of dimensions");
+  size_t size = 1;
+  for (int i = 0; i < n_dims; i++) {
+    if (dims[i] <= 0) tensor_fail("dimensions must be positive");
+    size *= (size_t)dims[i];
+  }
+  const size_t header = (sizeof(tensor) + n_dims * sizeof(int) + 63) & ~(size_t)63;
+  char *block = tensor_alloc(header + size * sizeof(double));
+  tensor *t = (tensor *)block;
+  t->n_dims = n_dims;
+  t->dims = (int *)(block + sizeof(tensor));
+  for (int i = 0; i < n_dims; i++)
+    t->dims[i] = dims[i];
+  t->size = (int)size;
+  t->data = (double *)(block + header);
+  return t;
+}
+
+static tensor *like(const tensor *t) {
+  return make(t->n_dims, t->dims);
+}
+
+static int same_shape(const tensor *a, const tensor *b) {
+  if (a->n_dims != b->n_dims) return 0;
+  for (int i = 0; i < a->n_dims; i++)
+    if (a->dims[i] != b->dims[i]) return 0;
+  return 1;
+}
+
+static void read_dims(int n_dims, va_list arguments, int *dims) {
+  if (n_dims <= 0 || n_dims > MAX_DIMS) tensor_fail("bad number of dimensions");
+  for (int i = 0; i < n_dims; i++)
+    dims[i] = va_arg(arguments, int);
+}
+
+//---------------------------------------------------------------------------
+
+tensor *tensor_create(int n_dims, ...) {
+  int dims[MAX_DIMS];
+  va_list arguments;
+  va_start(arguments, n_dims);
+  read_dims(n_dims, arguments, dims);
+  va_end(arguments);
+  return make(n_dims, dims); /* zeroed: memory is never reused */
+}
+
+tensor *tensor_ones(int n_dims, ...) {
+  int dims[MAX_DIMS];
+  va_list arguments;
+  va_start(arguments, n_dims);
+  read_dims(n_dims, arguments, dims);
+  va_end(arguments);
+  tensor *t = make(n_dims, dims);
+  tensor_kernels_in_use()->fill(t->data, 1, t->size);
+  return t;
+}
+
+tensor *tensor_reshape(tensor *t, int n_dims, ...) {
+  int dims[MAX_DIMS];
+  va_list arguments;
+  va_start(arguments, n_dims);
+  read_dims(n_dims, arguments, dims);
+  va_end(arguments);
+  tensor *r = make(n_dims, dims);
+  if (r->size != t->size) tensor_fail("reshape changes the number of cells");
+  tensor_kernels_in_use()->copy(r->data, t->data, t->size);
+  return r;
+}
+
+/* Cells known when the program was compiled, in read-only data: 8-byte aligned. */
+tensor *tensor_load(tensor *t, const double *cells) {
+  tensor_kernels_in_use()->copy(t->data, cells, t->size);
+  return t;
+}
+
+void tensor_put(double value, int cell, tensor *t) {
+  if (cell < 0 || cell >= t->size) tensor_fail("cell out of bounds");
+  t->data[cell] = value;
+}
+
+/* The indices come last first: the generated code pushes them in order. */
+double *tensor_getptr(tensor *t, ...) {
+  va_list arguments;
+  va_start(arguments, t);
+  size_t cell = 0, stride = 1;
+  for (int i = t->n_dims - 1; i >= 0; i--) {
+    int index = va_arg(arguments, int);
+    if (index < 0 || index >= t->dims[i]) tensor_fail("index out of bounds");
+    cell += (size_t)index * stride;
+    stride *= (size_t)t->dims[i];
+  }
+  va_end(arguments);
+  return t->data + cell;
+}
+
+//---------------------------------------------------------------------------
+
+int tensor_size(tensor *t) {
+  return t->size;
+}
+
+int tensor_get_n_dims(tensor *t) {
+  return t->n_dims;
+}
+
+int *tensor_get_dims(tensor *t) {
+  return t->dims;
+}
+
+int tensor_get_dim_size(tensor *t, int dim) {
+  if (dim < 0 || dim >= t->n_dims) tensor_fail("dimension out of bounds");
+  return t->dims[dim];
+}
+
+/* Nested brackets, one level per dimension. */
+static void print(const tensor *t, int dim, const double *cells) {
+  size_t block = 1;
+  for (int i = dim + 1; i < t->n_dims; i++)
+    block *= (size_t)t->dims[i];
+  prints("[");
+  for (int i = 0; i < t->dims[dim]; i++) {
+    if (i > 0) prints(", ");
+    if (dim == t->n_dims - 1)
+      printd(cells[i]);
+    else
+      print(t, dim + 1, cells + i * block);
+  }
+  prints("]");
+}
+
+/* The shape first, as in Tensor<2,3>, then the cells. */
+void tensor_print(tensor *t) {
+  prints("Tensor<");
+  for (int i = 0; i < t->n_dims; i++) {
+    if (i > 0) prints(",");
+    printi(t->dims[i]);
+  }
+  prints(">");
+  print(t, 0, t->data);
+}
+
+//---------------------------------------------------------------------------
+
+#define PARALLEL (1 << 17) /* cells below which an operation stays in one thread */
+#define CHUNK (1 << 14)     /* cells of each of its tasks, at least */
+
+typedef void (*binary_kernel)(double *r, const double *a, const double *b, size_t n);
+typedef void (*scalar_kernel)(double *r, const double *a, double s, size_t n);
+
+/* A kernel over all cells, in contiguous chunks (whole cache lines) if there are many. */
+struct elementwise {
+  binary_kernel binary; /* or */
+  scalar_kernel scalar;
+  double *r;
+  const double *a, *b;
+  double s;
+  size_t cells, chunk;
+};
+
+static void chunk(void *context, size_t i, size_t thread) {
+  const struct elementwise *e = context;
+  (void)thread;
+  const size_t first = i * e->chunk, cells = e->cells - first < e->chunk ? e->cells - first : e->chunk;
+  if (e->binary != NULL)
+    e->binary(e->r + first, e->a + first, e->b + first, cells);
+  else
+    e->scalar(e->r + first, e->a + first, e->s, cells);
+}
+
+static void run(struct elementwise *e) {
+  if (e->cells < PARALLEL || tensor_threads() == 1) {
+    e->chunk = e->cells;
+    chunk(e, 0, 0);
+    return;
+  }
+  e->chunk = (e->cells / (16 * tensor_threads()) + 7) & ~(size_t)7; /* a few per thread */
+  if (e->chunk < CHUNK) e->chunk = CHUNK;
+  tensor_parallel_for((e->cells + e->chunk - 1) / e->chunk, chunk, e);
+}
+
+static tensor *binary(binary_kernel kernel, const tensor *a, const tensor *b) {
+  if (!same_shape(a, b)) tensor_fail("tensor dimensions do not match");
+  tensor *r = like(a);
+  struct elementwise e = { kernel, NULL, r->data, a->data, b->data, 0, r->size, 0 };
+  run(&e);
+  return r;
+}
+
+static tensor *scalar(scalar_kernel kernel, const tensor *t, double s) {
+  tensor *r = like(t);
+  struct elementwise e = { NULL, kernel, r->data, t->data, NULL, s, r->size, 0 };
+  run(&e);
+  return r;
+}
+
+tensor *tensor_add(tensor *a, tensor *b) {
+  return binary(tensor_kernels_in_use()->add, a, b);
+}
+
+tensor *tensor_sub(tensor *b, tensor *a) {
+  return binary(tensor_kernels_in_use()->sub, a, b);
+}
+
+tensor *tensor_mul(tensor *a, tensor *b) {
+  return binary(tensor_kernels_in_use()->mul, a, b);
+}
+
+tensor *tensor_div(tensor *b, tensor *a) {
+  return binary(tensor_kernels_in_use()->div, a, b);
+}
+
+tensor *tensor_add_scalar(tensor *t, double s) {
+  return scalar(tensor_kernels_in_use()->add_scalar, t, s);
+}
+
+tensor *tensor_sub_scalar(tensor *t, double s) {
+  return scalar(tensor_kernels_in_use()->sub_scalar, t, s);
+}
+
+tensor *tensor_mul_scalar(tensor *t, double s) {
+  return scalar(tensor_kernels_in_use()->mul_scalar, t, s);
+}
+
+tensor *tensor_div_scalar(tensor *t, double s) {
+  return scalar(tensor_kernels_in_use()->div_scalar, t, s);
+}
+
+int tensor_equals(tensor *a, tensor *b) {
+  return same_shape(a, b) && tensor_kernels_in_use()->equals(a->data, b->data, a->size);
+}
+
+/*
+ * Contraction of the last dimension of a with the first of b: the result
+ * has the other dimensions of a, then those of b (one cell if none). In
+ * row-major order, that is the product of a as a matrix of k columns and
+ * b as a matrix of k rows.
+ */
+tensor *tensor_matmul(tensor *a, tensor *b) {
+  const int k = a->dims[a->n_dims - 1];
+  if (k != b->dims[0]) tensor_fail("contracted dimensions do not match");
+  int dims[2 * MAX_DIMS], n_dims = 0;
+  for (int i = 0; i < a->n_dims - 1; i++)
+    dims[n_dims++] = a->dims[i];
+  for (int i = 1; i < b->n_dims; i++)
+    dims[n_dims++] = b->dims[i];
+  if (n_dims == 0) dims[n_dims++] = 1;
+  if (n_dims > MAX_DIMS) tensor_fail("bad number of dimensions");
+
+  tensor *r = make(n_dims, dims); /* zeroed */
+  tensor_gemm(a->size / k, b->size / k, k, a->data, b->data, r->data);
+  return r;
+}
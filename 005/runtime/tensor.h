@@ -0,0 +1,50 @@
+#ifndef UDF_RUNTIME_TENSOR_H
+#define UDF_RUNTIME_TENSOR_H
+
+/*
+ * Tensor runtime of the programs the compiler generates (both targets).
+ * It is freestanding: no C library, memory comes straight from the
+ * kernel and printing goes through the base runtime (printi, prints,
+ * printd), which also has the mem_init the generated code calls first.
+ *
+ * Tensors hold doubles in row-major order. Every operation returns a new
+ * tensor: nothing is ever freed. Arguments are declared in the order the
+ * generated code passes them, which is not always the order of the
+ * source operands: tensor_sub(b, a) computes a - b, and the indices of
+ * tensor_getptr come last first.
+ */
+
+#include <stddef.h>
+
+typedef struct tensor {
+  int n_dims;
+  int *dims;      /* n_dims sizes */
+  int size;       /* cells */
+  double *data;   /* size cells, 64-byte aligned */
+} tensor;
+
+tensor *tensor_create(int n_dims, ...);
+tensor *tensor_ones(int n_dims, ...);
+tensor *tensor_reshape(tensor *t, int n_dims, ...);
+tensor *tensor_load(tensor *t, const double *cells);
+void tensor_put(double value, int cell, tensor *t);
+double *tensor_getptr(tensor *t, ...);
+
+int tensor_size(tensor *t);
+int tensor_get_n_dims(tensor *t);
+int *tensor_get_dims(tensor *t);
+int tensor_get_dim_size(tensor *t, int dim);
+void tensor_print(tensor *t);
+
+tensor *tensor_add(tensor *a, tensor *b);
+tensor *tensor_sub(tensor *b, tensor *a);
+tensor *tensor_mul(tensor *a, tensor *b);
+tensor *tensor_div(tensor *b, tensor *a);
+tensor *tensor_add_scalar(tensor *t, double s);
+tensor *tensor_sub_scalar(tensor *t, double s);
+tensor *tensor_mul_scalar(tensor *t, double s);
+tensor *tensor_div_scalar(tensor *t, double s);
+int tensor_equals(tensor *a, tensor *b);
+tensor *tensor_matmul(tensor *a, tensor *b);
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Work-stealing pool. A job is a range of task numbers, split evenly
+ * among the threads; each takes tasks from the front of its own range
+ * and, when it runs out, steals the back half of another's. Ranges are
+ * packed in one word with the job's generation (generation, end, first
+ * task), so taking and stealing are both a compare-and-swap, and a thief
+ * that read a range of an earlier job cannot take it for the same range
+ * of the next one. The caller works too, and returns when the count of
+ * pending tasks, which the last one wakes it from, drops to zero.
+ *
+ * Workers are started by the first job and sleep between jobs; one that
+ * stays idle for a while ends, and the next job starts it again. The
+ * base runtime may end the program with the exit of its own thread only:
+ * sleeping workers would keep the process alive.
+ */
+
+#include <stdint.h>
+#include "threads.h"
+#include "memory.h"
+#include "system.h"
+
+#define MAX_TASKS 0xffff     /* per job: a range is two 16-bit halves */
+#define STACK (256u << 10)   /* bytes of each worker's stack */
+#define IDLE 50              /* milliseconds before an idle worker ends */
+#define TIMEOUT (-110)
+
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define CAS(x, expected, v) __atomic_compare_exchange_n(&(x), &(expected), (v), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/* each thread's range and worker on a cache line of its own */
+struct slot {
+  uint64_t range __attribute__((aligned(8))); /* first | end << 16 | generation << 32 */
+  volatile int tid;  /* nonzero while the worker runs */
+  char *stack;
+} __attribute__((aligned(64)));
+
+static struct {
+  size_t threads; /* zero until known */
+  void (*task)(void *context, size_t i, size_t thread);
+  void *context;
+  size_t base;    /* of the task numbers of the current job */
+  volatile int generation __attribute__((aligned(64))); /* of the job: workers sleep on it */
+  volatile int pending __attribute__((aligned(64)));    /* tasks of the job not done: the caller sleeps on it */
+  struct slot slots[TENSOR_MAX_THREADS];
+} pool;
+
+size_t tensor_threads(void) {
+  if (pool.threads == 0) {
+    char buffer[16];
+    const char *value = sys_getenv("UDF_THREADS", buffer, sizeof(buffer));
+    long threads = 0;
+    if (value != NULL)
+      for (; *value >= '0' && *value <= '9' && threads <= TENSOR_MAX_THREADS; value++)
+        threads = threads * 10 + (*value - '0');
+    if (threads <= 0) threads = sys_cpus();
+    pool.threads = threads < TENSOR_MAX_THREADS ? (size_t)threads : TENSOR_MAX_THREADS;
+  }
+  return pool.threads;
+}
+
+static uint64_t pack(uint32_t generation, unsigned first, unsigned end) {
+  return first | end << 16 | (uint64_t)generation << 32;
+}
+
+static void perform(size_t self, unsigned i) {
+  pool.task(pool.context, pool.base + i, self);
+  if (__atomic_sub_fetch(&pool.pending, 1, __ATOMIC_ACQ_REL) == 0) sys_wake(&pool.pending, 1);
+}
+
+/* The next task of the thread's own range, or -1; *mine gets the range last seen. */
+static long take(size_t self, uint64_t *mine) {
+  uint64_t range = LOAD(pool.slots[self].range);
+  for (;;) {
+    const unsigned first = range & 0xffff, end = range >> 16 & 0xffff;
+    if (first >= end) {
+      *mine = range;
+      return -1;
+    }
+    if (CAS(pool.slots[self].range, range, range + 1)) return first;
+  }
+}
+
+/*
+ * The first of the back half of another thread's range of the same job as
+ * the thread's own (empty) range, keeping the rest; or -1 if all are empty.
+ */
+static long steal(size_t self, uint64_t mine) {
+  const uint32_t generation = mine >> 32;
+  for (size_t k = 1; k < pool.threads; k++) {
+    const size_t victim = (self + k) % pool.threads;
+    uint64_t range = LOAD(pool.slots[victim].range);
+    for (;;) {
+      const unsigned first = range & 0xffff, end = range >> 16 & 0xffff;
+      if (first >= end || (uint32_t)(range >> 32) != generation) break;
+      const unsigned middle = end - (end - first + 1) / 2;
+      if (CAS(pool.slots[victim].range, range, pack(generation, first, middle))) {
+        /* the stolen task keeps the job open, so the own range is still of it; were it not, run the rest here */
+        if (!CAS(pool.slots[self].range, mine, pack(generation, middle + 1, end)))
+          for (unsigned i = middle + 1; i < end; i++)
+            perform(self, i);
+        return middle;
+      }
+    }
+  }
+  return -1;
+}
+
+static void work(size_t self) {
+  uint64_t mine;
+  long i;
+  while ((i = take(self, &mine)) >= 0 || (i = steal(self, mine)) >= 0)
+    perform(self, (unsigned)i);
+}
+
+static void worker(void *argument) {
+  const size_t self = (size_t)argument;
+  for (;;) {
+    const int generation = LOAD(pool.generation);
+    work(self);
+    while (LOAD(pool.generation) == generation)
+      if (sys_wait(&pool.generation, generation, IDLE) == TIMEOUT) return;
+  }
+}
+
+static void start(size_t self) {
+  struct slot *slot = &pool.slots[self];
+  if (slot->tid != 0) return;
+  if (slot->stack == NULL) slot->stack = tensor_alloc(STACK);
+  sys_thread(slot->stack + STACK, worker, (void *)self, &slot->tid); /* if it fails, the others do its part */
+}
+
+void tensor_parallel_for(size_t n, void (*task)(void *context, size_t i, size_t thread), void *context) {
+  const size_t threads = tensor_threads();
+  if (threads == 1 || n <= 1) {
+    for (size_t i = 0; i < n; i++)
+      task(context, i, 0);
+    return;
+  }
+
+  pool.task = task;
+  pool.context = context;
+  for (size_t base = 0; base < n; base += MAX_TASKS) {
+    const size_t tasks = n - base < MAX_TASKS ? n - base : MAX_TASKS;
+    pool.base = base;
+    STORE(pool.pending, (int)tasks);
+    const uint32_t generation = (uint32_t)LOAD(pool.generation) + 1; /* only the caller changes it */
+    for (size_t t = 0; t < threads; t++)
+      STORE(pool.slots[t].range, pack(generation, tasks * t / threads, tasks * (t + 1) / threads));
+    __atomic_add_fetch(&pool.generation, 1, __ATOMIC_ACQ_REL);
+    for (size_t t = 1; t < threads; t++)
+      start(t);
+    sys_wake(&pool.generation, TENSOR_MAX_THREADS);
+
+    work(0);
+    int pending;
+    while ((pending = LOAD(pool.pending)) != 0)
+      sys_wait(&pool.pending, pending, 0);
+  }
+}
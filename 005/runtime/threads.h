@@ -0,0 +1,24 @@
+#ifndef UDF_RUNTIME_THREADS_H
+#define UDF_RUNTIME_THREADS_H
+
+#include <stddef.h>
+
+#define TENSOR_MAX_THREADS 256
+
+/*
+ * Threads that share the runtime's parallel work, the caller included:
+ * UDF_THREADS in the environment or, if unset, the processors the program
+ * may run on (at most TENSOR_MAX_THREADS). One means everything runs in
+ * the caller.
+ */
+size_t tensor_threads(void);
+
+/*
+ * task(context, i, thread) for every i below n, spread over the threads
+ * (thread identifies the one running it, below tensor_threads()); returns
+ * when all are done. Tasks must not allocate memory or start parallel
+ * work of their own.
+ */
+void tensor_parallel_for(size_t n, void (*task)(void *context, size_t i, size_t thread), void *context);
+
+#endif
@@ -0,0 +1,62 @@
+#include "targets/analyses.h"
+#include "targets/symbol_table.h"
+#include "targets/type_checker.h"
+#include "targets/constant_folder.h"
+#include "targets/dead_code_eliminator.h"
+#include "targets/invariant_mover.h"
+#include "targets/induction_reducer.h"
+#include "targets/tensor_fuser.h"
+#include "time_report.h"
+
+bool udf::analyses::run(std::shared_ptr<cdk::compiler> compiler) {
+  {
+    udf::time_report::scope phase(udf::time_report::TYPE_CHECKING);
+    udf::symbol_table symtab;
+    type_checker checker(compiler, symtab);
+    checker.check(compiler->ast(), 0);
+    if (checker.errors() > 0) return false;
+  }
+
+  // what each variable is, and where it is read, written and exposed
+  {
+    udf::time_report::scope phase(udf::time_report::VARIABLE_USAGE);
+    usage.analyse(compiler->ast());
+  }
+
+  // values known at compile time replace the code that computes them
+  {
+    udf::time_report::scope phase(udf::time_report::CONSTANT_FOLDING);
+    constant_folder folder(compiler, usage, constants);
+    folder.fold(compiler->ast());
+  }
+
+  // unreachable statements, useless evaluations and unread locals are left out
+  {
+    udf::time_report::scope phase(udf::time_report::DEAD_CODE);
+    dead_code_eliminator eliminator(compiler, usage, constants, dead);
+    eliminator.eliminate(compiler->ast());
+  }
+
+  // what cycles compute with the same result every time is computed before them
+  {
+    udf::time_report::scope phase(udf::time_report::INVARIANTS);
+    invariant_mover mover(compiler, usage, constants, dead, invariants);
+    mover.move(compiler->ast());
+  }
+
+  // indexing that follows the variables cycles step walks running pointers
+  {
+    udf::time_report::scope phase(udf::time_report::INDUCTIONS);
+    induction_reducer reducer(compiler, usage, constants, dead, inductions);
+    reducer.reduce(compiler->ast());
+  }
+
+  // elementwise tensor expressions are computed in one pass, without temporaries
+  {
+    udf::time_report::scope phase(udf::time_report::FUSION);
+    tensor_fuser fuser(compiler, constants, dead, fusions);
+    fuser.fuse(compiler->ast());
+  }
+
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <cdk/compiler.h>
+#include "targets/variable_usage.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/invariants.h"
+#include "targets/inductions.h"
+#include "targets/fusions.h"
+
+namespace udf {
+
+  /**
+   * What the code generators know of the program besides its tree. The
+   * tree is type-checked (and annotated) once, then each analysis runs
+   * once, in order, recording its findings beside the tree: none of them
+   * changes it, so every pass reads the same variable usage.
+   */
+  struct analyses {
+    udf::variable_usage usage;
+    udf::constants constants;
+    udf::dead_code dead;
+    udf::invariants invariants;
+    udf::inductions inductions;
+    udf::fusions fusions;
+
+    explicit analyses(std::shared_ptr<cdk::compiler> compiler) :
+        usage(compiler) {
+    }
+
+    /** Check and analyse the compiler's tree: false (with nothing analysed) if it has type errors. */
+    bool run(std::shared_ptr<cdk::compiler> compiler);
+  };
+
+} // udf
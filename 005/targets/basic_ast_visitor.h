@@ -4,7 +4,7 @@
 #include <memory>
 #include <iostream>
 #include <cdk/compiler.h>
-#include <cdk/symbol_table.h>
+#include "targets/symbol_table.h"
 #include "targets/symbol.h"
 
 /* do not edit -- include node forward declarations */
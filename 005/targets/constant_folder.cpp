@@ -0,0 +1,474 @@
+#include <climits>
+#include <cmath>
+#include <string>
+#include "targets/constant_folder.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+#include "udf_parser.tab.h"
+
+namespace {
+
+  bool is_real(const udf::constant &value) {
+    return std::holds_alternative<double>(value);
+  }
+
+  double real(const udf::constant &value) {
+    return std::visit([](auto v) { return static_cast<double>(v); }, value);
+  }
+
+  /** The value as the node's type, if it can be represented. */
+  std::optional<udf::constant> converted(const udf::constant &value, cdk::typed_node *const node) {
+    if (node->type() == nullptr) return std::nullopt;
+    if (node->is_typed(cdk::TYPE_DOUBLE) && std::isfinite(real(value))) return real(value);
+    if (node->is_typed(cdk::TYPE_INT) && !is_real(value)) return value;
+    return std::nullopt;
+  }
+
+  // integer arithmetic wraps around, as it does at run time
+  int wrapped(long long value) {
+    return static_cast<int>(static_cast<unsigned>(value));
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::fold(cdk::basic_node *const node) {
+  if (node == nullptr) return;
+  node->accept(this, 0);
+}
+
+/** Whether the variable's value may be tracked at all. */
+bool udf::constant_folder::propagates(udf::variable_declaration_node *const node) {
+  auto usage = _usage.of(node);
+  if (usage.escapes) return false;
+  if (node->type() == nullptr || (!node->is_typed(cdk::TYPE_INT) && !node->is_typed(cdk::TYPE_DOUBLE))) return false;
+  // other modules may see (and change) public globals
+  return !usage.global || (node->qualifier() == tPRIVATE && !usage.written);
+}
+
+void udf::constant_folder::record(cdk::typed_node *const node, const udf::constant &value) {
+  if (auto v = converted(value, node)) _constants.set(node, *v);
+}
+
+/** A local variable takes a new value (nullptr if unknown). */
+void udf::constant_folder::assign(udf::variable_declaration_node *const variable, const udf::constant *value) {
+  _locals.erase(variable);
+  if (value == nullptr || _unordered > 0 || !propagates(variable)) return;
+  if (auto v = converted(*value, variable)) _locals.emplace(variable, *v);
+}
+
+/** Where two paths join, only the values they agree on are kept. */
+void udf::constant_folder::merge(const values &other) {
+  std::erase_if(_locals, [&](const auto &entry) {
+    auto it = other.find(entry.first);
+    return it == other.end() || it->second != entry.second;
+  });
+}
+
+template<typename Integer, typename Real>
+void udf::constant_folder::arithmetic(cdk::binary_operation_node *const node, int lvl, Integer integer, Real real) {
+  // tensor operations evaluate their operands in varying orders
+  bool ordered = !node->is_typed(cdk::TYPE_TENSOR);
+  if (!ordered) _unordered++;
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  if (!ordered) {
+    _unordered--;
+    return;
+  }
+
+  auto left = value(node->left()), right = value(node->right());
+  if (left == nullptr || right == nullptr) return;
+
+  if (node->is_typed(cdk::TYPE_DOUBLE))
+    record(node, real(::real(*left), ::real(*right)));
+  else if (node->is_typed(cdk::TYPE_INT) && !is_real(*left) && !is_real(*right)) {
+    std::optional<int> result = integer(std::get<int>(*left), std::get<int>(*right));
+    if (result) record(node, *result);
+  }
+}
+
+template<typename Comparison>
+void udf::constant_folder::comparison(cdk::binary_operation_node *const node, Comparison compare) {
+  auto left = value(node->left()), right = value(node->right());
+  if (left == nullptr || right == nullptr) return;
+
+  if (is_real(*left) || is_real(*right)) {
+    double l = real(*left), r = real(*right);
+    if (!std::isnan(l) && !std::isnan(r)) record(node, compare(l, r) ? 1 : 0);
+  } else
+    record(node, compare(std::get<int>(*left), std::get<int>(*right)) ? 1 : 0);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_input_node(udf::input_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::constant_folder::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+
+void udf::constant_folder::do_integer_node(cdk::integer_node *const node, int lvl) {
+  record(node, node->value());
+}
+void udf::constant_folder::do_double_node(cdk::double_node *const node, int lvl) {
+  record(node, node->value());
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    visit(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+  auto argument = value(node->argument());
+  if (argument != nullptr && !is_real(*argument)) record(node, std::get<int>(*argument) == 0 ? 1 : 0);
+}
+
+void udf::constant_folder::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR)) {
+    _unordered++;
+    visit(node->argument(), lvl + 2);
+    _unordered--;
+    return;
+  }
+
+  visit(node->argument(), lvl + 2);
+  auto argument = value(node->argument());
+  if (argument == nullptr) return;
+  if (is_real(*argument))
+    record(node, -std::get<double>(*argument));
+  else
+    record(node, wrapped(-static_cast<long long>(std::get<int>(*argument))));
+}
+
+void udf::constant_folder::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+  if (auto argument = value(node->argument())) record(node, *argument);
+}
+
+void udf::constant_folder::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+// the code generator only evaluates the right operand if needed,
+// and the value is 1 if the condition holds and 0 otherwise
+
+void udf::constant_folder::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  auto left = value(node->left());
+  if (left != nullptr && !is_real(*left)) {
+    if (!udf::is_true(*left)) {
+      record(node, 0);
+      return;
+    }
+    visit(node->right(), lvl + 2);
+    auto right = value(node->right());
+    if (right != nullptr && !is_real(*right)) record(node, udf::is_true(*right) ? 1 : 0);
+    return;
+  }
+
+  values skipped = _locals;
+  visit(node->right(), lvl + 2);
+  merge(skipped);
+}
+
+void udf::constant_folder::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  auto left = value(node->left());
+  if (left != nullptr && !is_real(*left)) {
+    if (udf::is_true(*left)) {
+      record(node, 1);
+      return;
+    }
+    visit(node->right(), lvl + 2);
+    auto right = value(node->right());
+    if (right != nullptr && !is_real(*right)) record(node, udf::is_true(*right) ? 1 : 0);
+    return;
+  }
+
+  values skipped = _locals;
+  visit(node->right(), lvl + 2);
+  merge(skipped);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_add_node(cdk::add_node *const node, int lvl) {
+  arithmetic(node, lvl,
+             [](int a, int b) -> std::optional<int> { return wrapped(static_cast<long long>(a) + b); },
+             [](double a, double b) { return a + b; });
+}
+
+void udf::constant_folder::do_sub_node(cdk::sub_node *const node, int lvl) {
+  arithmetic(node, lvl,
+             [](int a, int b) -> std::optional<int> { return wrapped(static_cast<long long>(a) - b); },
+             [](double a, double b) { return a - b; });
+}
+
+void udf::constant_folder::do_mul_node(cdk::mul_node *const node, int lvl) {
+  arithmetic(node, lvl,
+             [](int a, int b) -> std::optional<int> { return wrapped(static_cast<long long>(a) * b); },
+             [](double a, double b) { return a * b; });
+}
+
+// divisions that trap at run time are left alone
+
+void udf::constant_folder::do_div_node(cdk::div_node *const node, int lvl) {
+  arithmetic(node, lvl,
+             [](int a, int b) -> std::optional<int> {
+               if (b == 0 || (a == INT_MIN && b == -1)) return std::nullopt;
+               return a / b;
+             },
+             [](double a, double b) { return a / b; });
+}
+
+void udf::constant_folder::do_mod_node(cdk::mod_node *const node, int lvl) {
+  arithmetic(node, lvl,
+             [](int a, int b) -> std::optional<int> {
+               if (b == 0 || (a == INT_MIN && b == -1)) return std::nullopt;
+               return a % b;
+             },
+             [](double, double) { return std::nan(""); });
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a < b; });
+}
+void udf::constant_folder::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a <= b; });
+}
+void udf::constant_folder::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a >= b; });
+}
+void udf::constant_folder::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a > b; });
+}
+void udf::constant_folder::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a != b; });
+}
+void udf::constant_folder::do_eq_node(cdk::eq_node *const node, int lvl) {
+  // same order as the code generator
+  visit(node->right(), lvl + 2);
+  visit(node->left(), lvl + 2);
+  comparison(node, [](auto a, auto b) { return a == b; });
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+
+  auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue());
+  auto declaration = variable ? _usage.declaration(variable) : nullptr;
+  if (declaration == nullptr) return;
+
+  if (auto it = _globals.find(declaration); it != _globals.end())
+    record(node, it->second);
+  else if (auto local = _locals.find(declaration); local != _locals.end() && _unordered == 0)
+    record(node, local->second);
+}
+
+void udf::constant_folder::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+
+  auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue());
+  auto declaration = variable ? _usage.declaration(variable) : nullptr;
+  if (declaration != nullptr && !_usage.of(declaration).global) assign(declaration, value(node->rvalue()));
+}
+
+void udf::constant_folder::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::constant_folder::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::constant_folder::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  // only the size of tensors depends on the evaluation of the expression
+  if (node->expression()->is_typed(cdk::TYPE_TENSOR))
+    visit(node->expression(), lvl + 2);
+  else
+    record(node, static_cast<int>(node->expression()->type()->size()));
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+void udf::constant_folder::do_write_node(udf::write_node *const node, int lvl) {
+  visit(node->args(), lvl + 2);
+}
+
+void udf::constant_folder::do_return_node(udf::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::constant_folder::do_if_node(udf::if_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  if (auto condition = value(node->condition())) {
+    if (udf::is_true(*condition)) visit(node->block(), lvl + 2);
+    return;
+  }
+
+  values skipped = _locals;
+  visit(node->block(), lvl + 2);
+  merge(skipped);
+}
+
+void udf::constant_folder::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  if (auto condition = value(node->condition())) {
+    visit(udf::is_true(*condition) ? node->thenblock() : node->elseblock(), lvl + 2);
+    return;
+  }
+
+  values before = _locals;
+  visit(node->thenblock(), lvl + 2);
+  std::swap(before, _locals);
+  visit(node->elseblock(), lvl + 2);
+  merge(before);
+}
+
+void udf::constant_folder::do_for_node(udf::for_node *const node, int lvl) {
+  visit(node->init(), lvl + 2);
+
+  // a single pass over the cycle: forget whatever it may change
+  for (auto variable : _usage.assigned(node))
+    _locals.erase(variable);
+  values head = _locals;
+
+  visit(node->condition(), lvl + 2);
+  visit(node->instruction(), lvl + 2);
+
+  // reached from the end of the body and from every 'continue'
+  _locals = head;
+  visit(node->increment(), lvl + 2);
+
+  // left from the condition and from every 'break'
+  _locals = std::move(head);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  visit(node->initializer(), lvl + 2);
+
+  if (!_usage.of(node).global) {
+    assign(node, value(node->initializer()));
+    return;
+  }
+
+  if (!propagates(node)) return;
+  if (node->initializer() == nullptr)
+    _globals.emplace(node, node->is_typed(cdk::TYPE_DOUBLE) ? udf::constant(0.0) : udf::constant(0));
+  else if (auto initializer = value(node->initializer()))
+    if (auto v = converted(*initializer, node)) _globals.emplace(node, *v);
+}
+
+void udf::constant_folder::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  _locals.clear();
+  visit(node->arguments(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::constant_folder::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  // arguments are pushed from the last to the first
+  auto &arguments = node->arguments()->nodes();
+  for (auto it = arguments.rbegin(); it != arguments.rend(); ++it)
+    visit(*it, lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::constant_folder::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  visit(node->cell_values(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor2(), lvl + 2);
+  visit(node->tensor1(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->index(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->indices(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::constant_folder::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  auto &dims = node->new_dims()->nodes();
+  for (auto it = dims.rbegin(); it != dims.rend(); ++it)
+    visit(*it, lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/variable_usage.h"
+
+#include <optional>
+#include <unordered_map>
+
+namespace udf {
+
+  /**
+   * Find the expressions whose value is known at compile time, after type
+   * checking. Integer and real arithmetic and comparisons over literals are
+   * folded; values are propagated through private globals that are never
+   * written and through locals whose address is never taken (following
+   * assignments in evaluation order). Conditions of 'if' that fold are
+   * recorded too, so that the dead branch is neither analysed nor generated.
+   */
+  class constant_folder: public basic_ast_visitor {
+    typedef std::unordered_map<const udf::variable_declaration_node*, udf::constant> values;
+
+    udf::constants &_constants;
+    const udf::variable_usage &_usage;
+    values _globals;         // never written: fixed for the whole program
+    values _locals;          // current values at this point of the function
+    int _unordered = 0;      // inside code whose evaluation order is not followed
+
+  public:
+    constant_folder(std::shared_ptr<cdk::compiler> compiler, const udf::variable_usage &usage,
+                    udf::constants &constants) :
+        basic_ast_visitor(compiler), _constants(constants), _usage(usage) {
+    }
+
+  public:
+    /** Fold the whole program. */
+    void fold(cdk::basic_node *const node);
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node != nullptr) node->accept(this, lvl);
+    }
+
+    const udf::constant *value(cdk::basic_node *const node) const {
+      return node == nullptr ? nullptr : _constants.find(node);
+    }
+
+    bool propagates(udf::variable_declaration_node *const node);
+    void record(cdk::typed_node *const node, const udf::constant &value);
+    void assign(udf::variable_declaration_node *const variable, const udf::constant *value);
+    void merge(const values &other);
+
+    template<typename Integer, typename Real>
+    void arithmetic(cdk::binary_operation_node *const node, int lvl, Integer integer, Real real);
+    template<typename Comparison>
+    void comparison(cdk::binary_operation_node *const node, Comparison compare);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <unordered_map>
+#include <variant>
+#include <cdk/ast/basic_node.h>
+
+namespace udf {
+
+  /** Value of an expression known at compile time (of the expression's type). */
+  using constant = std::variant<int, double>;
+
+  inline bool is_true(const constant &value) {
+    return std::visit([](auto v) { return v != 0; }, value);
+  }
+
+  /**
+   * Expressions whose value was found by the constant folder. A node is
+   * only recorded if evaluating it has no side effects, so the code
+   * generator may emit the value instead of the whole subtree.
+   */
+  class constants {
+    std::unordered_map<const cdk::basic_node*, constant> _values;
+
+  public:
+    void set(const cdk::basic_node *node, const constant &value) {
+      _values.insert_or_assign(node, value);
+    }
+
+    /** The node's value, or nullptr if unknown. */
+    const constant *find(const cdk::basic_node *node) const {
+      auto it = _values.find(node);
+      return it == _values.end() ? nullptr : &it->second;
+    }
+  };
+
+} // udf
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <unordered_set>
+#include <cdk/ast/basic_node.h>
+
+namespace udf {
+
+  /**
+   * Code found useless by the dead code eliminator. Skipped nodes are not
+   * generated at all: statements that cannot be reached, statements whose
+   * only effect is a discarded value, and the initializers of dropped
+   * variables when they have no side effects. Dropped nodes are local
+   * variables that are never read (they get no frame slot) and the
+   * assignments to them, of which only the value is computed.
+   */
+  class dead_code {
+    std::unordered_set<const cdk::basic_node*> _skipped, _dropped;
+
+  public:
+    void skip(const cdk::basic_node *node) {
+      _skipped.insert(node);
+    }
+    void drop(const cdk::basic_node *node) {
+      _dropped.insert(node);
+    }
+
+    bool skipped(const cdk::basic_node *node) const {
+      return _skipped.count(node) != 0;
+    }
+    bool dropped(const cdk::basic_node *node) const {
+      return _dropped.count(node) != 0;
+    }
+  };
+
+} // udf
@@ -0,0 +1,310 @@
+#include <string>
+#include "targets/dead_code_eliminator.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::eliminate(cdk::basic_node *const node) {
+  if (node == nullptr) return;
+  node->accept(this, 0);
+}
+
+/** Visit an expression and tell whether evaluating it has side effects. */
+bool udf::dead_code_eliminator::effects(cdk::basic_node *const node, int lvl) {
+  bool outer = _effects;
+  _effects = false;
+  visit(node, lvl);
+  bool result = _effects;
+  _effects = outer || result;
+  return result;
+}
+
+/** A local variable whose value is never used (and whose address is not taken). */
+bool udf::dead_code_eliminator::unused(udf::variable_declaration_node *const node) const {
+  auto usage = _usage.of(node);
+  return !usage.global && !usage.read && !usage.escapes;
+}
+
+/** Operations on tensors are done (and checked) by the runtime. */
+void udf::dead_code_eliminator::operation(cdk::binary_operation_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+  if (node->left()->is_typed(cdk::TYPE_TENSOR) || node->right()->is_typed(cdk::TYPE_TENSOR)) _effects = true;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::dead_code_eliminator::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+
+void udf::dead_code_eliminator::do_input_node(udf::input_node *const node, int lvl) {
+  _effects = true;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  // once a statement never completes, the ones after it cannot be reached
+  bool ends = false;
+  for (auto n : node->nodes()) {
+    if (ends) {
+      _dead.skip(n);
+      continue;
+    }
+    _ends = false;
+    visit(n, lvl);
+    ends = _ends;
+  }
+  _ends = ends;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::dead_code_eliminator::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+  if (node->is_typed(cdk::TYPE_TENSOR)) _effects = true;
+}
+void udf::dead_code_eliminator::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::dead_code_eliminator::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+  _effects = true;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_and_node(cdk::and_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_or_node(cdk::or_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_add_node(cdk::add_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_sub_node(cdk::sub_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_mul_node(cdk::mul_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_div_node(cdk::div_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_mod_node(cdk::mod_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_lt_node(cdk::lt_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_le_node(cdk::le_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_ge_node(cdk::ge_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_gt_node(cdk::gt_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_ne_node(cdk::ne_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::dead_code_eliminator::do_eq_node(cdk::eq_node *const node, int lvl) {
+  operation(node, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::dead_code_eliminator::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+
+  // a variable nobody reads need not be stored
+  auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue());
+  auto declaration = variable ? _usage.declaration(variable) : nullptr;
+  if (declaration != nullptr && unused(declaration))
+    _dead.drop(node);
+  else
+    _effects = true;
+}
+
+void udf::dead_code_eliminator::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::dead_code_eliminator::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::dead_code_eliminator::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  if (!effects(node->argument(), lvl + 2)) _dead.skip(node);
+}
+
+void udf::dead_code_eliminator::do_write_node(udf::write_node *const node, int lvl) {
+  visit(node->args(), lvl + 2);
+  _ends = false;
+}
+
+void udf::dead_code_eliminator::do_return_node(udf::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+  _ends = true;
+}
+
+void udf::dead_code_eliminator::do_break_node(udf::break_node *const node, int lvl) {
+  _ends = true;
+}
+
+void udf::dead_code_eliminator::do_continue_node(udf::continue_node *const node, int lvl) {
+  _ends = true;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  _ends = false;
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::dead_code_eliminator::do_if_node(udf::if_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  _ends = false;
+  visit(node->block(), lvl + 2);
+
+  // only an 'if' that is sure to be taken may end the sequence
+  auto condition = _constants.find(node->condition());
+  _ends = _ends && condition != nullptr && udf::is_true(*condition);
+}
+
+void udf::dead_code_eliminator::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  _ends = false;
+  visit(node->thenblock(), lvl + 2);
+  bool thenEnds = _ends;
+  _ends = false;
+  visit(node->elseblock(), lvl + 2);
+  bool elseEnds = _ends;
+
+  if (auto condition = _constants.find(node->condition()))
+    _ends = udf::is_true(*condition) ? thenEnds : elseEnds;
+  else
+    _ends = thenEnds && elseEnds;
+}
+
+void udf::dead_code_eliminator::do_for_node(udf::for_node *const node, int lvl) {
+  visit(node->init(), lvl + 2);
+  visit(node->condition(), lvl + 2);
+  visit(node->instruction(), lvl + 2);
+  visit(node->increment(), lvl + 2);
+  _ends = false; // a 'break' ends the cycle, not the sequence
+}
+
+//---------------------------------------------------------------------------
+
+void udf::dead_code_eliminator::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  if (!_inFunction || !unused(node)) {
+    visit(node->initializer(), lvl + 2);
+    return;
+  }
+
+  // no slot: the initializer is only evaluated for its side effects
+  _dead.drop(node);
+  if (node->initializer() != nullptr && !effects(node->initializer(), lvl + 2)) _dead.skip(node->initializer());
+}
+
+void udf::dead_code_eliminator::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  // arguments are placed by the caller: only the body is analysed
+  _inFunction = true;
+  visit(node->block(), lvl + 2);
+  _inFunction = false;
+  _ends = false;
+}
+
+void udf::dead_code_eliminator::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+  _effects = true;
+}
+
+//---------------------------------------------------------------------------
+// tensors are created, read and combined by the runtime
+
+void udf::dead_code_eliminator::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  visit(node->cell_values(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor1(), lvl + 2);
+  visit(node->tensor2(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->index(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->indices(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  _effects = true;
+}
+
+void udf::dead_code_eliminator::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->new_dims(), lvl + 2);
+  _effects = true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/variable_usage.h"
+
+namespace udf {
+
+  /**
+   * Find the code of each function body that need not be generated (see
+   * dead_code): statements following a 'return', 'break' or 'continue'
+   * (or an 'if' whose branches all end that way), evaluations whose value
+   * is discarded and that have no side effects, and locals that are never
+   * read, with their stores. Calls, input, tensor operations and the
+   * remaining assignments count as side effects.
+   */
+  class dead_code_eliminator: public basic_ast_visitor {
+    const udf::constants &_constants;
+    udf::dead_code &_dead;
+    const udf::variable_usage &_usage;
+    bool _effects = false; // of the expression being visited
+    bool _ends = false;    // the statement just visited never completes normally
+    bool _inFunction = false;
+
+  public:
+    dead_code_eliminator(std::shared_ptr<cdk::compiler> compiler, const udf::variable_usage &usage,
+                         const udf::constants &constants, udf::dead_code &dead) :
+        basic_ast_visitor(compiler), _constants(constants), _dead(dead), _usage(usage) {
+    }
+
+  public:
+    /** Analyse the whole program. */
+    void eliminate(cdk::basic_node *const node);
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node != nullptr) node->accept(this, lvl);
+    }
+    bool effects(cdk::basic_node *const node, int lvl);
+    bool unused(udf::variable_declaration_node *const node) const;
+    void operation(cdk::binary_operation_node *const node, int lvl);
+    void statement(cdk::basic_node *const node, int lvl);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
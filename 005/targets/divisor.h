@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace udf {
+
+  /**
+   * Signed 32-bit division by a known divisor as a multiplication (Hacker's
+   * Delight, 10-1): for d >= 2, not a power of two, the quotient of n by d
+   * is the high half of the 64-bit product n * multiplier, plus n if the
+   * multiplier is negative, shifted right (arithmetically) by shift, plus
+   * one if that is negative.
+   */
+  struct divisor {
+    int multiplier;
+    int shift;
+
+    explicit divisor(std::uint32_t d) {
+      const std::uint32_t two31 = 0x80000000u;
+      const std::uint32_t anc = two31 - 1 - two31 % d; // largest dividend with remainder d - 1
+      std::uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+      std::uint32_t q2 = two31 / d, r2 = two31 - q2 * d, delta;
+      int p = 31;
+      do {
+        p++;
+        q1 *= 2, r1 *= 2;
+        if (r1 >= anc) q1++, r1 -= anc;
+        q2 *= 2, r2 *= 2;
+        if (r2 >= d) q2++, r2 -= d;
+        delta = d - r2;
+      } while (q1 < delta || (q1 == delta && r1 == 0));
+      multiplier = static_cast<int>(q2 + 1);
+      shift = p - 32;
+    }
+  };
+
+} // udf
@@ -1,6 +1,5 @@
 #include <string>
 #include "targets/frame_size_calculator.h"
-#include "targets/type_checker.h"
 #include "targets/symbol.h"
 #include ".auto/all_nodes.h"
 
@@ -121,6 +120,7 @@ void udf::frame_size_calculator::do_sequence_node(cdk::sequence_node *const node
   for (size_t i = 0; i < node->size(); i++) {
     cdk::basic_node *n = node->node(i);
     if (n == nullptr) break;
+    if (_dead.skipped(n)) continue;
     n->accept(this, lvl + 2);
   }
 }
@@ -134,6 +134,9 @@ void udf::frame_size_calculator::do_for_node(udf::for_node *const node, int lvl)
   _symtab.push();
   node->init()->accept(this, lvl + 2);
   _symtab.pop();
+  for (auto expression : _invariants.hoisted(node))
+    _localsize += udf::invariants::address(expression) ? 4 : expression->type()->size();
+  _localsize += 4 * _inductions.pointers(node).size();
   node->instruction()->accept(this, lvl + 2);
 }
 
@@ -147,13 +150,12 @@ void udf::frame_size_calculator::do_if_else_node(udf::if_else_node *const node,
 }
 
 void udf::frame_size_calculator::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
-  //_symtab.push();
-  ASSERT_SAFE_EXPRESSIONS;  
-  //_symtab.pop();
+  if (_dead.dropped(node)) return;
   _localsize += node->type()->size();
 }
 
 void udf::frame_size_calculator::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  _localsize += _fusions.bytes(node);
   node->block()->accept(this, lvl + 2);
 }
 
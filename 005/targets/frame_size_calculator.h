@@ -2,6 +2,10 @@
 #define __UDF_TARGET_FRAME_SIZE_CALCULATOR_H__
 
 #include "targets/basic_ast_visitor.h"
+#include "targets/dead_code.h"
+#include "targets/invariants.h"
+#include "targets/inductions.h"
+#include "targets/fusions.h"
 
 #include <sstream>
 #include <stack>
@@ -9,14 +13,21 @@
 namespace udf {
 
   class frame_size_calculator: public basic_ast_visitor {
-    cdk::symbol_table<udf::symbol> &_symtab;
+    udf::symbol_table &_symtab;
     std::shared_ptr<udf::symbol> _function;
+    const udf::dead_code &_dead; // neither generated nor given a slot
+    const udf::invariants &_invariants; // each given a slot
+    const udf::inductions &_inductions; // each running pointer given a slot
+    const udf::fusions &_fusions; // room for the largest kernel of the function
 
     size_t _localsize;
 
   public:
-    frame_size_calculator(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<udf::symbol> &symtab, std::shared_ptr<udf::symbol> func) :
-        basic_ast_visitor(compiler), _symtab(symtab), _function(func), _localsize(0) {
+    frame_size_calculator(std::shared_ptr<cdk::compiler> compiler, udf::symbol_table &symtab, std::shared_ptr<udf::symbol> func,
+                          const udf::dead_code &dead, const udf::invariants &invariants, const udf::inductions &inductions,
+                          const udf::fusions &fusions) :
+        basic_ast_visitor(compiler), _symtab(symtab), _function(func), _dead(dead), _invariants(invariants),
+        _inductions(inductions), _fusions(fusions), _localsize(0) {
     }
 
   public:
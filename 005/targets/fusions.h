@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <cdk/ast/expression_node.h>
+
+namespace udf {
+
+  class function_definition_node;
+  class tensor_node;
+
+  /**
+   * Elementwise tensor expressions fused by the tensor fuser. Instead of
+   * one runtime call (and one new tensor) per operator, the code generator
+   * evaluates the operands of the whole tree once, in the order given,
+   * creates the result and computes every cell of it in a single loop,
+   * reading the same cell of each tensor operand. Tensor literals whose
+   * cells are all known are not evaluated: their cells are read-only data,
+   * read in place (a literal alone is a kernel that copies them). Operands,
+   * the result and the loop's cell offset are kept in frame slots that the
+   * kernel only needs while its loop runs: each function reserves room for
+   * its largest kernel.
+   */
+  class fusions {
+  public:
+    enum class operation { load, literal, add, sub, mul, div, neg };
+
+    struct step {
+      operation op;
+      size_t operand; // of a load (in operands) or of a literal (in literals)
+    };
+
+    struct kernel {
+      std::vector<cdk::expression_node*> operands; // tensors and scalars (int or double)
+      std::vector<udf::tensor_node*> literals;     // cells known at compile time
+      std::vector<step> steps;                     // the value of a cell, in postfix order
+      size_t cells;
+
+      /** Frame bytes (4-byte pointers): each operand, the result, its cells and the offset. */
+      size_t bytes() const {
+        size_t total = 12;
+        for (auto operand : operands)
+          total += operand->is_typed(cdk::TYPE_TENSOR) ? 4 : 8;
+        return total;
+      }
+    };
+
+  private:
+    std::unordered_map<const cdk::expression_node*, kernel> _kernels;
+    std::unordered_map<const udf::function_definition_node*, size_t> _bytes;
+
+  public:
+    void fuse(const udf::function_definition_node *function, const cdk::expression_node *root, const kernel &k) {
+      _kernels[root] = k;
+      auto &bytes = _bytes[function];
+      bytes = std::max(bytes, k.bytes());
+    }
+
+    /** The kernel computing the expression, or nullptr if it is not the root of one. */
+    const kernel *find(const cdk::expression_node *node) const {
+      auto it = _kernels.find(node);
+      return it == _kernels.end() ? nullptr : &it->second;
+    }
+
+    /** Frame bytes the kernels of a function need (they never run at the same time). */
+    size_t bytes(const udf::function_definition_node *function) const {
+      auto it = _bytes.find(function);
+      return it == _bytes.end() ? 0 : it->second;
+    }
+  };
+
+} // udf
@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <string>
+#include "targets/induction_reducer.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::reduce(cdk::basic_node *const node) {
+  if (node == nullptr) return;
+  node->accept(this, 0);
+}
+
+/** Declaration of the variable whose value the expression is (or nullptr). */
+udf::variable_declaration_node *udf::induction_reducer::variable(cdk::basic_node *const node) const {
+  auto rvalue = dynamic_cast<cdk::rvalue_node*>(node);
+  auto variable = rvalue ? dynamic_cast<cdk::variable_node*>(rvalue->lvalue()) : nullptr;
+  return variable ? _usage.declaration(variable) : nullptr;
+}
+
+/** Whether only the cycle's own assignments can change the variable in it (and all are seen). */
+bool udf::induction_reducer::stable(const udf::variable_declaration_node *variable, size_t k) const {
+  auto usage = _usage.of(variable);
+  if (usage.escapes) return false; // may be written through pointers
+  if (usage.global && _usage.calls(_cycles[k].node)) return false;
+  auto it = _declared.find(variable);
+  return it == _declared.end() || it->second <= k;
+}
+
+bool udf::induction_reducer::known(cdk::basic_node *const node, int &value) const {
+  auto constant = _constants.find(node);
+  if (constant == nullptr || !std::holds_alternative<int>(*constant)) return false;
+  value = std::get<int>(*constant);
+  return true;
+}
+
+/** Record the variable an increment expression of cycle k steps, if any. */
+void udf::induction_reducer::induct(size_t k, cdk::basic_node *const node) {
+  auto assignment = dynamic_cast<cdk::assignment_node*>(node);
+  if (assignment == nullptr || !assignment->is_typed(cdk::TYPE_INT)) return;
+  auto lvalue = dynamic_cast<cdk::variable_node*>(assignment->lvalue());
+  auto declaration = lvalue ? _usage.declaration(lvalue) : nullptr;
+  if (declaration == nullptr || !stable(declaration, k)) return;
+
+  auto &assigned = _usage.assigned(_cycles[k].node);
+  if (std::count(assigned.begin(), assigned.end(), declaration) != 1) return;
+
+  int cells;
+  if (auto add = dynamic_cast<cdk::add_node*>(assignment->rvalue())) {
+    if (!((variable(add->left()) == declaration && known(add->right(), cells)) ||
+          (variable(add->right()) == declaration && known(add->left(), cells))))
+      return;
+  } else if (auto sub = dynamic_cast<cdk::sub_node*>(assignment->rvalue())) {
+    if (variable(sub->left()) != declaration || !known(sub->right(), cells)) return;
+    cells = -cells;
+  } else
+    return;
+
+  _cycles[k].variables[declaration] = { node, cells };
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::induction_reducer::do_input_node(udf::input_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    if (!_dead.skipped(n)) visit(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::induction_reducer::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::induction_reducer::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::induction_reducer::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_add_node(cdk::add_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_sub_node(cdk::sub_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_mul_node(cdk::mul_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_div_node(cdk::div_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_mod_node(cdk::mod_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::induction_reducer::do_eq_node(cdk::eq_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::induction_reducer::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::induction_reducer::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::induction_reducer::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+
+  auto base = variable(node->base());
+  if (base == nullptr || !node->base()->is_typed(cdk::TYPE_POINTER)) return;
+
+  // the index is the variable, maybe displaced by a known number of cells
+  int offset = 0;
+  auto index = variable(node->index());
+  if (index == nullptr) {
+    if (auto add = dynamic_cast<cdk::add_node*>(node->index())) {
+      if (known(add->right(), offset))
+        index = variable(add->left());
+      else if (known(add->left(), offset))
+        index = variable(add->right());
+    } else if (auto sub = dynamic_cast<cdk::sub_node*>(node->index())) {
+      if (known(sub->right(), offset)) index = variable(sub->left());
+      offset = -offset;
+    }
+    if (index == nullptr) return;
+  }
+
+  // only the innermost cycle that assigns the variable may step it
+  for (size_t k = _cycles.size(); k-- > 0; ) {
+    auto &assigned = _usage.assigned(_cycles[k].node);
+    if (std::find(assigned.begin(), assigned.end(), index) == assigned.end()) continue;
+
+    auto &cycle = _cycles[k];
+    auto it = cycle.variables.find(index);
+    if (it == cycle.variables.end() || !stable(base, k)) return;
+    if (std::find(assigned.begin(), assigned.end(), base) != assigned.end()) return;
+
+    // indexings of the same pointer with the same displacement share it
+    auto key = std::make_tuple(base, index, offset);
+    auto same = std::find(cycle.keys.begin(), cycle.keys.end(), key);
+    if (same != cycle.keys.end()) {
+      cycle.pointers[same - cycle.keys.begin()].uses.push_back(node);
+      return;
+    }
+    cycle.keys.push_back(key);
+    cycle.pointers.push_back({ node, { node }, it->second.step, it->second.cells });
+    return;
+  }
+}
+
+void udf::induction_reducer::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  // only the size of tensors is computed (and their expression evaluated)
+  if (node->expression()->is_typed(cdk::TYPE_TENSOR)) visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+void udf::induction_reducer::do_write_node(udf::write_node *const node, int lvl) {
+  visit(node->args(), lvl + 2);
+}
+
+void udf::induction_reducer::do_return_node(udf::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::induction_reducer::do_if_node(udf::if_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    // only the live branch is generated
+    if (udf::is_true(*condition)) visit(node->block(), lvl + 2);
+    return;
+  }
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::induction_reducer::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    visit(udf::is_true(*condition) ? node->thenblock() : node->elseblock(), lvl + 2);
+    return;
+  }
+  visit(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void udf::induction_reducer::do_for_node(udf::for_node *const node, int lvl) {
+  visit(node->init(), lvl + 2);
+
+  size_t k = _cycles.size();
+  _cycles.emplace_back();
+  _cycles.back().node = node;
+  for (auto n : node->increment()->nodes())
+    if (!_dead.skipped(n)) induct(k, n);
+
+  visit(node->condition(), lvl + 2);
+  visit(node->instruction(), lvl + 2);
+  visit(node->increment(), lvl + 2);
+
+  for (auto &pointer : _cycles.back().pointers)
+    _inductions.reduce(node, pointer);
+  _cycles.pop_back();
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  _declared[node] = _cycles.size();
+  if (!_dead.dropped(node) || (node->initializer() != nullptr && !_dead.skipped(node->initializer())))
+    visit(node->initializer(), lvl + 2);
+}
+
+void udf::induction_reducer::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::induction_reducer::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::induction_reducer::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->index(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->indices(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  visit(node->cell_values(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor1(), lvl + 2);
+  visit(node->tensor2(), lvl + 2);
+}
+
+void udf::induction_reducer::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->new_dims(), lvl + 2);
+}
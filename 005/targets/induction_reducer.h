@@ -0,0 +1,76 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/inductions.h"
+#include "targets/variable_usage.h"
+
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace udf {
+
+  /**
+   * Find the induction variables of each 'for' and the indexings that
+   * follow them (see inductions). An induction variable is an integer the
+   * cycle assigns only in one expression of its increment, 'i = i + c',
+   * 'i = c + i' or 'i = i - c', with 'c' known; the indexings are 'p[i]',
+   * 'p[i + c]' and 'p[i - c]' anywhere in the cycle (inner cycles
+   * included) over a pointer variable declared outside it, that it does
+   * not assign. Neither variable may have its address taken, and globals
+   * only count in cycles that call no functions.
+   */
+  class induction_reducer: public basic_ast_visitor {
+    /** How a variable changes at every iteration. */
+    struct induction {
+      const cdk::basic_node *step;
+      int cells;
+    };
+    /** A cycle being analysed. */
+    struct cycle {
+      const udf::for_node *node = nullptr;
+      std::unordered_map<const udf::variable_declaration_node*, induction> variables;
+      std::vector<udf::inductions::pointer> pointers;
+      std::vector<std::tuple<const udf::variable_declaration_node*, const udf::variable_declaration_node*, int>> keys;
+    };
+
+    const udf::constants &_constants;
+    const udf::dead_code &_dead;
+    udf::inductions &_inductions;
+    const udf::variable_usage &_usage;
+
+    std::vector<cycle> _cycles; // enclosing cycles
+    std::unordered_map<const udf::variable_declaration_node*, size_t> _declared; // cycles around each local
+
+  public:
+    induction_reducer(std::shared_ptr<cdk::compiler> compiler, const udf::variable_usage &usage,
+                      const udf::constants &constants, const udf::dead_code &dead, udf::inductions &inductions) :
+        basic_ast_visitor(compiler), _constants(constants), _dead(dead), _inductions(inductions), _usage(usage) {
+    }
+
+  public:
+    /** Analyse the whole program. */
+    void reduce(cdk::basic_node *const node);
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      // a known value is not computed at all
+      if (node != nullptr && _constants.find(node) == nullptr) node->accept(this, lvl);
+    }
+    udf::variable_declaration_node *variable(cdk::basic_node *const node) const;
+    bool stable(const udf::variable_declaration_node *variable, size_t k) const;
+    bool known(cdk::basic_node *const node, int &value) const;
+    void induct(size_t k, cdk::basic_node *const node);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
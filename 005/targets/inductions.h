@@ -0,0 +1,46 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <cdk/ast/basic_node.h>
+
+namespace udf {
+
+  class for_node;
+  class index_node;
+
+  /**
+   * Indexing strength-reduced by the induction reducer. A variable the
+   * increment of a 'for' changes by a constant (and that the cycle changes
+   * nowhere else) moves 'p[i]' by the same number of cells at every
+   * iteration, when 'p' does not change: the address is computed once,
+   * after the initialization of the cycle and its invariants, and kept in a
+   * frame slot that is advanced right after the variable is. The code
+   * generator loads the slot wherever one of the indexings appears.
+   */
+  class inductions {
+  public:
+    struct pointer {
+      udf::index_node *start;            // evaluated before the first iteration
+      std::vector<udf::index_node*> uses; // indexings that load the slot (start included)
+      const cdk::basic_node *step;       // increment expression after which it moves
+      int cells;                         // by how many cells
+    };
+
+  private:
+    std::unordered_map<const udf::for_node*, std::vector<pointer>> _pointers;
+
+  public:
+    void reduce(const udf::for_node *cycle, const pointer &p) {
+      _pointers[cycle].push_back(p);
+    }
+
+    /** The running pointers of a cycle. */
+    const std::vector<pointer> &pointers(const udf::for_node *cycle) const {
+      static const std::vector<pointer> none;
+      auto it = _pointers.find(cycle);
+      return it == _pointers.end() ? none : it->second;
+    }
+  };
+
+} // udf
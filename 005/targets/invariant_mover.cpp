@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <string>
+#include "targets/invariant_mover.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::move(cdk::basic_node *const node) {
+  if (node == nullptr) return;
+  node->accept(this, 0);
+}
+
+/** Visit an expression and tell what is known of it. */
+udf::invariant_mover::expression udf::invariant_mover::analyse(cdk::basic_node *const node, int lvl) {
+  expression outer = _expression;
+  _expression = expression();
+  // a known value is not computed at all
+  if (node != nullptr && _constants.find(node) == nullptr) node->accept(this, lvl);
+  expression result = _expression;
+  _expression = outer;
+  return result;
+}
+
+/** Number of enclosing cycles in which the variable may change. */
+size_t udf::invariant_mover::level(udf::variable_declaration_node *const node) const {
+  auto usage = _usage.of(node);
+  if (usage.escapes) return variant(); // may be written through pointers
+
+  auto it = _declared.find(node);
+  size_t declared = it == _declared.end() ? 0 : it->second;
+  for (size_t i = _cycles.size(); i-- > declared; ) {
+    auto &assigned = _usage.assigned(_cycles[i]);
+    if (std::find(assigned.begin(), assigned.end(), node) != assigned.end()) return i + 1;
+    if (usage.global && _usage.calls(_cycles[i])) return i + 1;
+  }
+  return declared;
+}
+
+/** Number of enclosing cycles in which the shape of tensors may change. */
+size_t udf::invariant_mover::shapes() const {
+  for (size_t i = _cycles.size(); i-- > 0; )
+    if (_usage.calls(_cycles[i]) || _usage.reshapes(_cycles[i])) return i + 1;
+  return 0;
+}
+
+bool udf::invariant_mover::movable(const expression &e) const {
+  return !e.effects && e.worth && e.level < variant() && (!e.guarded || _inCondition);
+}
+
+/** Index of the cycle a movable expression leaves. */
+size_t udf::invariant_mover::target(const expression &e) const {
+  return e.guarded ? variant() - 1 : e.level;
+}
+
+/**
+ * Analyse the operands of an operation that has no side effects of its
+ * own and move it if it is invariant and does some work. Operands leaving
+ * the same cycle go with it; those leaving outer cycles stay there.
+ */
+void udf::invariant_mover::operation(cdk::typed_node *const node, const std::vector<cdk::basic_node*> &operands,
+                                     int lvl, bool worth, bool guarded, size_t level) {
+  expression e;
+  e.level = level;
+  e.worth = worth;
+  e.guarded = guarded;
+  for (auto operand : operands) {
+    auto o = analyse(operand, lvl + 2);
+    e.level = std::max(e.level, o.level);
+    e.effects = e.effects || o.effects;
+    e.guarded = e.guarded || o.guarded;
+  }
+
+  if (movable(e)) {
+    size_t cycle = target(e);
+    for (auto operand : operands) {
+      auto it = _targets.find(operand);
+      if (it == _targets.end() || it->second != cycle) continue;
+      std::erase(_moving[cycle], operand);
+      _targets.erase(it);
+    }
+    _moving[cycle].push_back(node);
+    _targets[node] = cycle;
+  }
+  _expression = e;
+}
+
+/** Allocation or side effects: the operands may still move, but not the whole. */
+void udf::invariant_mover::opaque(const std::vector<cdk::basic_node*> &operands, int lvl) {
+  for (auto operand : operands)
+    analyse(operand, lvl + 2);
+  _expression = expression();
+  _expression.level = variant();
+  _expression.effects = true;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY: the address of a variable does not change
+}
+void udf::invariant_mover::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::invariant_mover::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+
+void udf::invariant_mover::do_input_node(udf::input_node *const node, int lvl) {
+  opaque({}, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    if (!_dead.skipped(n)) analyse(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_not_node(cdk::not_node *const node, int lvl) {
+  operation(node, { node->argument() }, lvl, false);
+}
+void udf::invariant_mover::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->argument() }, lvl);
+  else
+    operation(node, { node->argument() }, lvl, false);
+}
+void udf::invariant_mover::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  operation(node, { node->argument() }, lvl, false);
+}
+void udf::invariant_mover::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  opaque({ node->argument() }, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_and_node(cdk::and_node *const node, int lvl) {
+  // the right operand is not evaluated at every iteration
+  auto left = analyse(node->left(), lvl + 2);
+  bool condition = _inCondition;
+  _inCondition = false;
+  auto right = analyse(node->right(), lvl + 2);
+  _inCondition = condition;
+  _expression.level = std::max(left.level, right.level);
+  _expression.effects = left.effects || right.effects;
+}
+void udf::invariant_mover::do_or_node(cdk::or_node *const node, int lvl) {
+  auto left = analyse(node->left(), lvl + 2);
+  bool condition = _inCondition;
+  _inCondition = false;
+  auto right = analyse(node->right(), lvl + 2);
+  _inCondition = condition;
+  _expression.level = std::max(left.level, right.level);
+  _expression.effects = left.effects || right.effects;
+}
+
+// arithmetic on tensors creates new ones
+void udf::invariant_mover::do_add_node(cdk::add_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl);
+}
+void udf::invariant_mover::do_sub_node(cdk::sub_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl);
+}
+void udf::invariant_mover::do_mul_node(cdk::mul_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl);
+}
+// integer division by zero fails
+void udf::invariant_mover::do_div_node(cdk::div_node *const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl, true, node->is_typed(cdk::TYPE_INT));
+}
+void udf::invariant_mover::do_mod_node(cdk::mod_node *const node, int lvl) {
+  operation(node, { node->left(), node->right() }, lvl, true, true);
+}
+
+// comparisons are fused with the jumps that use them
+void udf::invariant_mover::do_lt_node(cdk::lt_node *const node, int lvl) {
+  operation(node, { node->left(), node->right() }, lvl, false);
+}
+void udf::invariant_mover::do_le_node(cdk::le_node *const node, int lvl) {
+  operation(node, { node->left(), node->right() }, lvl, false);
+}
+void udf::invariant_mover::do_ge_node(cdk::ge_node *const node, int lvl) {
+  operation(node, { node->left(), node->right() }, lvl, false);
+}
+void udf::invariant_mover::do_gt_node(cdk::gt_node *const node, int lvl) {
+  operation(node, { node->left(), node->right() }, lvl, false);
+}
+void udf::invariant_mover::do_ne_node(cdk::ne_node *const node, int lvl) {
+  if (node->left()->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl, false);
+}
+void udf::invariant_mover::do_eq_node(cdk::eq_node *const node, int lvl) {
+  if (node->left()->is_typed(cdk::TYPE_TENSOR))
+    opaque({ node->left(), node->right() }, lvl);
+  else
+    operation(node, { node->left(), node->right() }, lvl, false);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  auto lvalue = analyse(node->lvalue(), lvl + 2);
+  _expression.effects = lvalue.effects;
+
+  // only variables are followed: memory may be written in many ways
+  auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue());
+  auto declaration = variable ? _usage.declaration(variable) : nullptr;
+  _expression.level = declaration ? level(declaration) : variant();
+}
+
+void udf::invariant_mover::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  opaque({ node->rvalue(), node->lvalue() }, lvl);
+}
+
+void udf::invariant_mover::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  operation(node, { node->lvalue() }, lvl, false);
+}
+
+void udf::invariant_mover::do_index_node(udf::index_node *const node, int lvl) {
+  operation(node, { node->base(), node->index() }, lvl);
+}
+
+void udf::invariant_mover::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  // only the size of tensors is computed (and their expression evaluated)
+  if (node->expression()->is_typed(cdk::TYPE_TENSOR))
+    operation(node, { node->expression() }, lvl, true, true);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  analyse(node->argument(), lvl + 2);
+}
+
+void udf::invariant_mover::do_write_node(udf::write_node *const node, int lvl) {
+  analyse(node->args(), lvl + 2);
+}
+
+void udf::invariant_mover::do_return_node(udf::return_node *const node, int lvl) {
+  analyse(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::invariant_mover::do_if_node(udf::if_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    // only the live branch is generated
+    if (udf::is_true(*condition)) visit(node->block(), lvl + 2);
+    return;
+  }
+  analyse(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::invariant_mover::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    visit(udf::is_true(*condition) ? node->thenblock() : node->elseblock(), lvl + 2);
+    return;
+  }
+  analyse(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void udf::invariant_mover::do_for_node(udf::for_node *const node, int lvl) {
+  visit(node->init(), lvl + 2);
+
+  _cycles.push_back(node);
+  _moving.emplace_back();
+
+  // the condition is evaluated before every iteration, the first included
+  _inCondition = true;
+  analyse(node->condition(), lvl + 2);
+  _inCondition = false;
+  visit(node->instruction(), lvl + 2);
+  visit(node->increment(), lvl + 2);
+
+  for (auto expression : _moving.back()) {
+    _invariants.hoist(node, expression);
+    _targets.erase(expression);
+  }
+  _moving.pop_back();
+  _cycles.pop_back();
+}
+
+//---------------------------------------------------------------------------
+
+void udf::invariant_mover::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  _declared[node] = _cycles.size();
+  if (!_dead.dropped(node) || (node->initializer() != nullptr && !_dead.skipped(node->initializer())))
+    analyse(node->initializer(), lvl + 2);
+}
+
+void udf::invariant_mover::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::invariant_mover::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  opaque(node->arguments()->nodes(), lvl);
+}
+
+//---------------------------------------------------------------------------
+// queries go to the runtime: they may fail on a bad tensor or index
+
+void udf::invariant_mover::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  // reshaping keeps the number of cells
+  operation(node, { node->tensor() }, lvl, true, true);
+}
+
+void udf::invariant_mover::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  operation(node, { node->tensor() }, lvl, true, true, shapes());
+}
+
+void udf::invariant_mover::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  operation(node, { node->index(), node->tensor() }, lvl, true, true, shapes());
+}
+
+void udf::invariant_mover::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  std::vector<cdk::basic_node*> operands(node->indices()->nodes());
+  operands.push_back(node->tensor());
+  operation(node, operands, lvl, true, true, shapes());
+}
+
+void udf::invariant_mover::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  operation(node, { node->tensor() }, lvl, true, true, shapes());
+}
+
+// tensors are created, combined and reshaped by the runtime
+
+void udf::invariant_mover::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  opaque({ node->cell_values() }, lvl);
+}
+
+void udf::invariant_mover::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  opaque({ node->tensor1(), node->tensor2() }, lvl);
+}
+
+void udf::invariant_mover::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  opaque({ node->tensor(), node->new_dims() }, lvl);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/invariants.h"
+#include "targets/variable_usage.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace udf {
+
+  /**
+   * Move the computations a 'for' repeats with the same result out of it
+   * (see invariants): arithmetic, indexing and pointer arithmetic, and the
+   * tensor queries (capacity, rank, dimensions, cells) over variables the
+   * cycle does not change. Each such expression is taken out of the
+   * outermost cycle in which it is invariant, and only the largest one is
+   * taken. Locals whose address is taken never count as invariant, nor do
+   * globals in cycles that call functions. Queries that go to the runtime,
+   * and divisions, may fail: they are only taken out of the conditions of
+   * their own cycle (outside '&&' and '||'), which are evaluated at least
+   * once anyway. Nothing that allocates or has side effects is moved.
+   */
+  class invariant_mover: public basic_ast_visitor {
+    /** What is known of the expression just visited. */
+    struct expression {
+      size_t level = 0;     // invariant in the cycles from this one in (_cycles.size(): in none)
+      bool effects = false; // side effects or allocation: never moved
+      bool worth = false;   // does some work
+      bool guarded = false; // may fail: moved only out of the current condition
+    };
+
+    const udf::constants &_constants;
+    const udf::dead_code &_dead;
+    udf::invariants &_invariants;
+    const udf::variable_usage &_usage;
+
+    std::vector<const udf::for_node*> _cycles; // enclosing cycles
+    std::vector<std::vector<cdk::typed_node*>> _moving; // out of each enclosing cycle
+    std::unordered_map<const cdk::basic_node*, size_t> _targets; // cycle each one leaves
+    std::unordered_map<const udf::variable_declaration_node*, size_t> _declared; // cycles around each local
+    expression _expression;
+    bool _inCondition = false; // of the innermost cycle, evaluated at every iteration
+
+  public:
+    invariant_mover(std::shared_ptr<cdk::compiler> compiler, const udf::variable_usage &usage,
+                    const udf::constants &constants, const udf::dead_code &dead, udf::invariants &invariants) :
+        basic_ast_visitor(compiler), _constants(constants), _dead(dead), _invariants(invariants), _usage(usage) {
+    }
+
+  public:
+    /** Analyse the whole program. */
+    void move(cdk::basic_node *const node);
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node != nullptr) node->accept(this, lvl);
+    }
+    size_t variant() const {
+      return _cycles.size();
+    }
+    expression analyse(cdk::basic_node *const node, int lvl);
+    size_t level(udf::variable_declaration_node *const node) const;
+    size_t shapes() const;
+    void operation(cdk::typed_node *const node, const std::vector<cdk::basic_node*> &operands, int lvl,
+                   bool worth = true, bool guarded = false, size_t level = 0);
+    void opaque(const std::vector<cdk::basic_node*> &operands, int lvl);
+    bool movable(const expression &e) const;
+    size_t target(const expression &e) const;
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
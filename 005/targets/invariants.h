@@ -0,0 +1,40 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <cdk/ast/typed_node.h>
+#include <cdk/ast/lvalue_node.h>
+
+namespace udf {
+
+  class for_node;
+
+  /**
+   * Expressions moved out of cycles by the invariant mover. Each is
+   * evaluated once, right after the initialization of the 'for' it was
+   * moved out of, in the order given, and kept in a frame slot of its own:
+   * the code generator loads the slot wherever the expression appears in
+   * the cycle. Lvalues (indexing) keep their address in the slot.
+   */
+  class invariants {
+    std::unordered_map<const udf::for_node*, std::vector<cdk::typed_node*>> _hoisted;
+
+  public:
+    void hoist(const udf::for_node *cycle, cdk::typed_node *node) {
+      _hoisted[cycle].push_back(node);
+    }
+
+    /** The expressions to evaluate before the cycle starts. */
+    const std::vector<cdk::typed_node*> &hoisted(const udf::for_node *cycle) const {
+      static const std::vector<cdk::typed_node*> none;
+      auto it = _hoisted.find(cycle);
+      return it == _hoisted.end() ? none : it->second;
+    }
+
+    /** Whether the slot holds an address rather than a value. */
+    static bool address(const cdk::typed_node *node) {
+      return dynamic_cast<const cdk::lvalue_node*>(node) != nullptr;
+    }
+  };
+
+} // udf
@@ -0,0 +1,43 @@
+#include <cstring>
+#include "targets/output_buffer.h"
+
+//---------------------------------------------------------------------------
+
+udf::output_buffer::output_buffer(std::ostream &os, std::size_t size) :
+    _os(os), _sink(os.rdbuf()), _chunk(size) {
+  setp(_chunk.data(), _chunk.data() + _chunk.size());
+  _os.rdbuf(this);
+}
+
+udf::output_buffer::~output_buffer() {
+  bool ok = drain();
+  _os.rdbuf(_sink);
+  if (!ok || _sink->pubsync() != 0) _os.setstate(std::ios::badbit);
+}
+
+//---------------------------------------------------------------------------
+
+bool udf::output_buffer::drain() {
+  std::streamsize pending = pptr() - pbase();
+  setp(_chunk.data(), _chunk.data() + _chunk.size());
+  return pending == 0 || _sink->sputn(_chunk.data(), pending) == pending;
+}
+
+udf::output_buffer::int_type udf::output_buffer::overflow(int_type c) {
+  if (!drain()) return traits_type::eof();
+  if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+  *pptr() = traits_type::to_char_type(c);
+  pbump(1);
+  return c;
+}
+
+std::streamsize udf::output_buffer::xsputn(const char *s, std::streamsize n) {
+  if (n > epptr() - pptr()) {
+    if (!drain()) return 0;
+    // too big to be worth copying: pass it on as it is
+    if (n >= static_cast<std::streamsize>(_chunk.size())) return _sink->sputn(s, n);
+  }
+  std::memcpy(pptr(), s, n);
+  pbump(static_cast<int>(n));
+  return n;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace udf {
+
+  /**
+   * Large buffer placed in front of an output stream while a target writes
+   * to it. Flushes (e.g., from std::endl) are ignored: text reaches the
+   * original stream buffer only in whole chunks, and once more when the
+   * output buffer is destroyed, which also restores the stream.
+   */
+  class output_buffer: public std::streambuf {
+    std::ostream &_os;
+    std::streambuf *_sink;
+    std::vector<char> _chunk;
+
+  public:
+    explicit output_buffer(std::ostream &os, std::size_t size = 1 << 20);
+    ~output_buffer();
+
+    output_buffer(const output_buffer&) = delete;
+    output_buffer &operator=(const output_buffer&) = delete;
+
+  protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override {
+      return 0; // not per line: see drain()
+    }
+
+  private:
+    /** Hand the buffered text to the original stream buffer. */
+    bool drain();
+  };
+
+} // udf
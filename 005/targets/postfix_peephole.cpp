@@ -0,0 +1,212 @@
+#include <bit>
+#include <bitset>
+#include <cstdint>
+#include <initializer_list>
+#include "targets/postfix_peephole.h"
+#include "targets/divisor.h"
+
+namespace {
+
+  using opcode = udf::postfix_peephole::opcode;
+  using instruction = udf::postfix_peephole::instruction;
+  using code = std::vector<instruction>;
+
+  /** Set of opcodes accepted at one position of a pattern. */
+  class opcodes {
+    std::bitset<static_cast<size_t>(opcode::COUNT)> _set;
+  public:
+    opcodes(std::initializer_list<opcode> ops) {
+      for (auto op : ops) _set.set(static_cast<size_t>(op));
+    }
+    bool has(opcode op) const {
+      return _set.test(static_cast<size_t>(op));
+    }
+  };
+
+  struct rule {
+    std::vector<opcodes> pattern;
+    bool (*applies)(const instruction *matched);
+    code (*rewrite)(const instruction *matched);
+  };
+
+  bool always(const instruction*) {
+    return true;
+  }
+
+  opcode negation(opcode comparison) {
+    switch (comparison) {
+      case opcode::LT: return opcode::GE;
+      case opcode::LE: return opcode::GT;
+      case opcode::GT: return opcode::LE;
+      case opcode::GE: return opcode::LT;
+      case opcode::EQ: return opcode::NE;
+      default:         return opcode::EQ;
+    }
+  }
+
+  opcode jump(opcode comparison) {
+    switch (comparison) {
+      case opcode::LT: return opcode::JLT;
+      case opcode::LE: return opcode::JLE;
+      case opcode::GT: return opcode::JGT;
+      case opcode::GE: return opcode::JGE;
+      case opcode::EQ: return opcode::JEQ;
+      default:         return opcode::JNE;
+    }
+  }
+
+  // each pattern is matched against the most recent instructions
+  const std::vector<rule> rules = {
+    // assignment used as an instruction: the copy of the value is discarded
+    { { { opcode::DUP32 }, { opcode::LOCAL, opcode::ADDR }, { opcode::STINT }, { opcode::TRASH } },
+      [](const instruction *m) { return m[3].i == 4; },
+      [](const instruction *m) { return code { m[1], m[2] }; } },
+    { { { opcode::DUP64 }, { opcode::LOCAL, opcode::ADDR }, { opcode::STDOUBLE }, { opcode::TRASH } },
+      [](const instruction *m) { return m[3].i == 8; },
+      [](const instruction *m) { return code { m[1], m[2] }; } },
+
+    // negated comparison: compare the other way
+    { { { opcode::LT, opcode::LE, opcode::GT, opcode::GE, opcode::EQ, opcode::NE }, { opcode::INT }, { opcode::EQ } },
+      [](const instruction *m) { return m[1].i == 0; },
+      [](const instruction *m) { return code { { negation(m[0].op) } }; } },
+
+    // negated condition: jump on the opposite
+    { { { opcode::INT }, { opcode::EQ }, { opcode::JZ, opcode::JNZ } },
+      [](const instruction *m) { return m[0].i == 0; },
+      [](const instruction *m) { return code { { m[2].op == opcode::JZ ? opcode::JNZ : opcode::JZ, 0, 0, m[2].s } }; } },
+
+    // comparison only used by a jump: compare and jump at once
+    { { { opcode::LT, opcode::LE, opcode::GT, opcode::GE, opcode::EQ, opcode::NE }, { opcode::JZ, opcode::JNZ } },
+      always,
+      [](const instruction *m) {
+        return code { { jump(m[1].op == opcode::JZ ? negation(m[0].op) : m[0].op), 0, 0, m[1].s } };
+      } },
+
+    // neutral operands (e.g., pointer arithmetic on 1-byte cells)
+    { { { opcode::INT }, { opcode::MUL, opcode::DIV } },
+      [](const instruction *m) { return m[0].i == 1; },
+      [](const instruction*) { return code {}; } },
+    { { { opcode::INT }, { opcode::ADD, opcode::SUB, opcode::SHTL, opcode::SHTRS, opcode::SHTRU } },
+      [](const instruction *m) { return m[0].i == 0; },
+      [](const instruction*) { return code {}; } },
+
+    // consecutive stack adjustments
+    { { { opcode::TRASH }, { opcode::TRASH } },
+      always,
+      [](const instruction *m) { return code { { opcode::TRASH, m[0].i + m[1].i } }; } },
+    { { { opcode::TRASH } },
+      [](const instruction *m) { return m[0].i == 0; },
+      [](const instruction*) { return code {}; } },
+
+    // return as the last instruction, followed by the function's epilogue
+    { { { opcode::LEAVE }, { opcode::RET }, { opcode::LEAVE }, { opcode::RET } },
+      always,
+      [](const instruction *m) { return code { m[0], m[1] }; } },
+
+    // jump to the instruction that follows
+    { { { opcode::JMP }, { opcode::LABEL } },
+      [](const instruction *m) { return m[0].s == m[1].s; },
+      [](const instruction *m) { return code { m[1] }; } },
+    { { { opcode::JMP }, { opcode::ALIGN }, { opcode::LABEL } },
+      [](const instruction *m) { return m[0].s == m[2].s; },
+      [](const instruction *m) { return code { m[1], m[2] }; } },
+  };
+
+  // instructions older than this cannot be part of a match anymore
+  constexpr size_t window = 32;
+
+}
+
+//---------------------------------------------------------------------------
+
+void udf::postfix_peephole::push(instruction &&instr) {
+  // a known divisor that is not 0, 1 or a power of two (those are shifts), without idiv
+  if (_ix86 && (instr.op == opcode::DIV || instr.op == opcode::MOD) && !_window.empty() &&
+      _window.back().op == opcode::INT) {
+    int d = _window.back().i;
+    std::uint32_t magnitude = d < 0 ? -static_cast<std::uint32_t>(d) : d;
+    if (magnitude >= 2 && !std::has_single_bit(magnitude)) {
+      _window.pop_back();
+      instr = { instr.op == opcode::DIV ? opcode::DIVIDE : opcode::REMAINDER, d };
+    }
+  }
+
+  _window.push_back(std::move(instr));
+
+  for (const auto &r : rules) {
+    size_t n = r.pattern.size();
+    if (_window.size() < n) continue;
+
+    const instruction *tail = &_window[_window.size() - n];
+    bool matches = true;
+    for (size_t k = 0; k < n && matches; k++)
+      matches = r.pattern[k].has(tail[k].op);
+    if (!matches || !r.applies(tail)) continue;
+
+    // replace the match, giving the replacement a chance to match again
+    code replacement = r.rewrite(tail);
+    _window.erase(_window.end() - n, _window.end());
+    for (auto &i : replacement)
+      push(std::move(i));
+    return;
+  }
+
+  if (_window.size() > 2 * window) {
+    for (size_t k = 0; k < window; k++)
+      emit(_window[k]);
+    _window.erase(_window.begin(), _window.begin() + window);
+  }
+}
+
+void udf::postfix_peephole::flush() {
+  for (const auto &i : _window)
+    emit(i);
+  _window.clear();
+}
+
+void udf::postfix_peephole::emit(const instruction &instr) {
+  switch (instr.op) {
+#define __PLAIN(op) case opcode::op: _pf.op(); break;
+#define __INTEGER(op) case opcode::op: _pf.op(instr.i); break;
+#define __REAL(op) case opcode::op: _pf.op(instr.d); break;
+#define __LABEL(op) case opcode::op: _pf.op(instr.s); break;
+    UDF_POSTFIX_PLAIN(__PLAIN)
+    UDF_POSTFIX_INTEGER(__INTEGER)
+    UDF_POSTFIX_REAL(__REAL)
+    UDF_POSTFIX_LABEL(__LABEL)
+#undef __PLAIN
+#undef __INTEGER
+#undef __REAL
+#undef __LABEL
+    case opcode::GLOBAL: _pf.GLOBAL(instr.s, instr.t); break;
+    case opcode::DIVIDE: divide(instr.i, false); break;
+    case opcode::REMAINDER: divide(instr.i, true); break;
+    case opcode::COUNT: break;
+  }
+}
+
+/**
+ * The slot on top of the stack divided by d, in place: the quotient is the
+ * high half of its product by the multiplier, adjusted as in divisor; the
+ * remainder is what the quotient times d leaves of it.
+ */
+void udf::postfix_peephole::divide(int d, bool remainder) {
+  std::uint32_t magnitude = d < 0 ? -static_cast<std::uint32_t>(d) : d;
+  udf::divisor magic(magnitude);
+  auto &os = *_ix86;
+  os << "\tmov\tecx, dword [esp]\n";
+  os << "\tmov\teax, " << magic.multiplier << "\n";
+  os << "\timul\tecx\n";
+  if (magic.multiplier < 0) os << "\tadd\tedx, ecx\n";
+  if (magic.shift > 0) os << "\tsar\tedx, " << magic.shift << "\n";
+  os << "\tmov\teax, edx\n";
+  os << "\tshr\teax, 31\n";
+  os << "\tadd\tedx, eax\n";
+  if (d < 0) os << "\tneg\tedx\n";
+  if (remainder) {
+    os << "\timul\tedx, edx, " << d << "\n";
+    os << "\tsub\tecx, edx\n";
+    os << "\tmov\tdword [esp], ecx\n";
+  } else
+    os << "\tmov\tdword [esp], edx\n";
+}
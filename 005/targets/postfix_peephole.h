@@ -0,0 +1,107 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cdk/emitters/basic_postfix_emitter.h>
+
+/* instructions used by the code generator, by kind of argument */
+#define UDF_POSTFIX_PLAIN(X) \
+  X(ADD) X(ALIGN) X(ALLOC) X(AND) X(BSS) X(DADD) X(DATA) X(DCMP) X(DDIV) X(DIV) X(DMUL) X(DNEG) X(DSUB) \
+  X(DUP32) X(DUP64) X(EQ) X(GE) X(GT) X(I2D) X(LDDOUBLE) X(LDFVAL32) X(LDFVAL64) X(LDINT) X(LE) X(LEAVE) \
+  X(LT) X(MOD) X(MUL) X(NE) X(NEG) X(OR) X(RET) X(RODATA) X(SHTL) X(SHTRS) X(SHTRU) X(SP) X(STDOUBLE) X(STFVAL32) X(STFVAL64) \
+  X(STINT) X(SUB) X(TEXT)
+#define UDF_POSTFIX_INTEGER(X) X(ENTER) X(INT) X(LOCAL) X(SALLOC) X(SINT) X(TRASH)
+#define UDF_POSTFIX_REAL(X) X(DOUBLE) X(SDOUBLE)
+#define UDF_POSTFIX_LABEL(X) \
+  X(ADDR) X(CALL) X(EXTERN) X(JEQ) X(JGE) X(JGT) X(JLE) X(JLT) X(JMP) X(JNE) X(JNZ) X(JZ) X(LABEL) X(SADDR) X(SSTRING)
+
+namespace udf {
+
+  /**
+   * Peephole stage between the code generator and the postfix emitter.
+   * Instructions are kept in a small window; whenever the end of the
+   * window matches one of the patterns in the table (see .cpp), it is
+   * rewritten before anything reaches the emitter.
+   *
+   * The CDK's ix86 emitter divides with idiv. If its stream is given,
+   * division and modulo by a known divisor are instead written there as
+   * ix86 instructions, with a multiplication (see divisor); an emitter
+   * that keeps the top of the stack in registers (postfix_tos_emitter)
+   * does that by itself.
+   */
+  class postfix_peephole {
+  public:
+    enum class opcode {
+#define __OPCODE(op) op,
+      UDF_POSTFIX_PLAIN(__OPCODE) UDF_POSTFIX_INTEGER(__OPCODE) UDF_POSTFIX_REAL(__OPCODE)
+      UDF_POSTFIX_LABEL(__OPCODE) GLOBAL, DIVIDE, REMAINDER, COUNT
+#undef __OPCODE
+    };
+
+    struct instruction {
+      opcode op;
+      int i;             // integer argument
+      double d;          // real argument
+      std::string s, t;  // label/string arguments
+
+      instruction(opcode op, int i = 0, double d = 0, const std::string &s = "", const std::string &t = "") :
+          op(op), i(i), d(d), s(s), t(t) {
+      }
+    };
+
+  private:
+    cdk::basic_postfix_emitter &_pf;
+    std::ostream *_ix86; // stream of the ix86 emitter, for divisions (or nullptr)
+    std::vector<instruction> _window;
+
+  public:
+    explicit postfix_peephole(cdk::basic_postfix_emitter &pf, std::ostream *ix86 = nullptr) :
+        _pf(pf), _ix86(ix86) {
+    }
+
+    ~postfix_peephole() {
+      flush();
+    }
+
+    postfix_peephole(const postfix_peephole&) = delete;
+    postfix_peephole &operator=(const postfix_peephole&) = delete;
+
+  public:
+    /** Send every pending instruction to the emitter. */
+    void flush();
+
+    std::string FUNC() {
+      return _pf.FUNC();
+    }
+    std::string OBJ() {
+      return _pf.OBJ();
+    }
+    std::string NONE() {
+      return _pf.NONE();
+    }
+
+#define __PLAIN(op) void op() { push({ opcode::op }); }
+#define __INTEGER(op) void op(int i) { push({ opcode::op, i }); }
+#define __REAL(op) void op(double d) { push({ opcode::op, 0, d }); }
+#define __LABEL(op) void op(const std::string &s) { push({ opcode::op, 0, 0, s }); }
+    UDF_POSTFIX_PLAIN(__PLAIN)
+    UDF_POSTFIX_INTEGER(__INTEGER)
+    UDF_POSTFIX_REAL(__REAL)
+    UDF_POSTFIX_LABEL(__LABEL)
+#undef __PLAIN
+#undef __INTEGER
+#undef __REAL
+#undef __LABEL
+
+    void GLOBAL(const std::string &name, const std::string &kind) {
+      push({ opcode::GLOBAL, 0, 0, name, kind });
+    }
+
+  private:
+    void push(instruction &&instr);
+    void emit(const instruction &instr);
+    void divide(int divisor, bool remainder);
+  };
+
+} // udf
@@ -4,4 +4,10 @@
  * Postfix for ix86.
  * @var create and register an evaluator for ASM targets.
  */
-udf::postfix_target udf::postfix_target::_self;
+udf::postfix_target udf::postfix_target::_self("asm", true);
+
+/**
+ * Postfix for ix86, every stack slot in memory.
+ * @var create and register an evaluator for ASM-PLAIN targets.
+ */
+udf::postfix_target udf::postfix_target::_plain("asm-plain", false);
@@ -2,31 +2,82 @@
 
 #include <cdk/targets/basic_target.h>
 #include <cdk/ast/basic_node.h>
+#include "targets/analyses.h"
+#include "arena.h"
+#include "time_report.h"
 #include "targets/postfix_writer.h"
+#include "targets/output_buffer.h"
+#include "targets/postfix_tos_emitter.h"
 
 #include <cdk/emitters/postfix_ix86_emitter.h>
+#include <cstdlib>
+#include <cstring>
 
 namespace udf {
 
   class postfix_target: public cdk::basic_target {
     static postfix_target _self;
+    static postfix_target _plain;
+
+    bool _cached; // the top of the stack may be kept in registers
 
   private:
-    postfix_target() :
-        cdk::basic_target("asm") {
+    postfix_target(const char *name, bool cached) :
+        cdk::basic_target(name), _cached(cached) {
+    }
+
+    /**
+     * The top of the stack is kept in registers, except with the asm-plain
+     * target or UDF_STACK_CACHE=0 (every slot in memory, as the CDK's
+     * emitter alone does).
+     */
+    bool stack_cache() const {
+      const char *value = std::getenv("UDF_STACK_CACHE");
+      return _cached && (value == nullptr || std::strcmp(value, "0") != 0);
     }
 
   public:
     bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
+      bool ok = generate(compiler);
+
+      // the syntax tree is not needed anymore: release it in one go
+      compiler->ast(nullptr);
+      udf::arena::close(compiler.get());
+
+      udf::time_report::finish();
+      return ok;
+    }
+
+  private:
+    bool generate(std::shared_ptr<cdk::compiler> compiler) {
+      // check (and annotate) the whole tree once, then analyse it: the
+      // code generator and the frame size calculator only read the results
+      udf::analyses analysed(compiler);
+      if (!analysed.run(compiler)) return false;
+
+      udf::time_report::scope phase(udf::time_report::CODE_GENERATION);
+
       // this symbol table will be used to check identifiers
       // during code generation
-      cdk::symbol_table<udf::symbol> symtab;
+      udf::symbol_table symtab;
+
+      // the assembly text is written in large chunks, never line by line
+      udf::output_buffer buffer(*compiler->ostream());
 
       // this is the backend postfix machine
-      cdk::postfix_ix86_emitter pf(compiler);
+      cdk::postfix_ix86_emitter ix86(compiler);
+
+      // ... possibly behind a cache of the top of its stack
+      udf::postfix_tos_emitter cached(compiler, ix86);
+      cdk::basic_postfix_emitter &pf = stack_cache() ? static_cast<cdk::basic_postfix_emitter&>(cached) : ix86;
+
+      // redundant instruction sequences are rewritten on the way to the emitter
+      // (which divides by known divisors itself only if it caches the stack)
+      udf::postfix_peephole peephole(pf, stack_cache() ? nullptr : compiler->ostream());
 
       // generate assembly code from the syntax tree
-      postfix_writer writer(compiler, symtab, pf);
+      postfix_writer writer(compiler, symtab, peephole, analysed.constants, analysed.dead, analysed.invariants,
+                            analysed.inductions, analysed.fusions);
       compiler->ast()->accept(&writer, 0);
 
       return true;
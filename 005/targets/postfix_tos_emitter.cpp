@@ -0,0 +1,553 @@
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include "targets/postfix_tos_emitter.h"
+#include "targets/divisor.h"
+
+namespace {
+  const char *const EAX = "eax";
+  const char *const EDX = "edx";
+
+  std::string operands(const std::string &first, const std::string &second) {
+    return first + ", " + second;
+  }
+
+  std::string frame(int offset) {
+    return offset < 0 ? "[ebp" + std::to_string(offset) + "]" : "[ebp+" + std::to_string(offset) + "]";
+  }
+
+  std::string hex(std::uint32_t value) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << value;
+    return oss.str();
+  }
+}
+
+//---------------------------------------------------------------------------
+// cache management
+
+/** Write the bottom slot of the cache to the machine stack. */
+void udf::postfix_tos_emitter::spill() {
+  if (_cache[0].real) {
+    if (_size == 2 && _cache[1].real) emit("fxch"); // the bottom one is ST1
+    emit("sub", "esp, 8");
+    emit("fstp", "qword [esp]");
+  } else if (_cache[0].immediate) {
+    emit("push", "dword " + std::to_string(_cache[0].value));
+  } else {
+    emit("push", _cache[0].reg);
+  }
+  _cache[0] = _cache[1];
+  _size--;
+}
+
+void udf::postfix_tos_emitter::flush() {
+  while (_size > 0)
+    spill();
+}
+
+/** Load the cached constants into their registers. */
+void udf::postfix_tos_emitter::settle() {
+  for (int k = 0; k < _size; k++) {
+    slot &s = _cache[k];
+    if (!s.immediate) continue;
+    if (s.value == 0)
+      emit("xor", operands(s.reg, s.reg));
+    else
+      emit("mov", operands(s.reg, std::to_string(s.value)));
+    s.immediate = false;
+  }
+}
+
+/** Make sure the top slot is cached (and of the right kind). */
+void udf::postfix_tos_emitter::need(bool top) {
+  // a slot of the wrong kind means the stack is being used in some other way: start afresh
+  if (_size > 0 && this->top().real != top) flush();
+  if (_size > 0) {
+    settle();
+    return;
+  }
+
+  if (top) {
+    emit("fld", "qword [esp]");
+    emit("add", "esp, 8");
+    _cache[0] = { true, nullptr };
+  } else {
+    emit("pop", EAX);
+    _cache[0] = { false, EAX };
+  }
+  _size = 1;
+}
+
+/** Make sure the top two slots are cached (and of the right kind). */
+void udf::postfix_tos_emitter::need(bool below, bool top) {
+  if (_size == 2 && this->top(1).real != below) flush();
+  need(top);
+  if (_size == 2) return;
+
+  // the missing slot goes under the cached one
+  if (below) {
+    emit("fld", "qword [esp]");
+    emit("add", "esp, 8");
+    if (_cache[0].real) emit("fxch");
+    _cache[1] = _cache[0];
+    _cache[0] = { true, nullptr };
+  } else {
+    const char *reg = !_cache[0].real && _cache[0].reg == EAX ? EDX : EAX;
+    emit("pop", reg);
+    _cache[1] = _cache[0];
+    _cache[0] = { false, reg };
+  }
+  _size = 2;
+}
+
+/** Add an integer slot on top of the cache: returns the register the caller must fill. */
+const char *udf::postfix_tos_emitter::push_integer() {
+  if (_size == 2) spill();
+  const char *reg = _size == 1 && !_cache[0].real && _cache[0].reg == EAX ? EDX : EAX;
+  _cache[_size++] = { false, reg };
+  return reg;
+}
+
+/** Add a real slot on top of the cache: the caller must then load ST0. */
+void udf::postfix_tos_emitter::push_real() {
+  if (_size == 2) spill();
+  _cache[_size++] = { true, nullptr };
+}
+
+//---------------------------------------------------------------------------
+// instructions not affected by the cache
+
+#define __PLAIN(op) void udf::postfix_tos_emitter::op() { _pf.op(); }
+#define __INTEGER(op) void udf::postfix_tos_emitter::op(int value) { _pf.op(value); }
+#define __LABEL(op) void udf::postfix_tos_emitter::op(std::string label) { _pf.op(label); }
+UDF_TOS_DIRECTIVE_PLAIN(__PLAIN)
+UDF_TOS_DIRECTIVE_INTEGER(__INTEGER)
+UDF_TOS_DIRECTIVE_LABEL(__LABEL)
+#undef __PLAIN
+#undef __INTEGER
+#undef __LABEL
+
+void udf::postfix_tos_emitter::GLOBAL(std::string name, std::string type) {
+  _pf.GLOBAL(name, type);
+}
+void udf::postfix_tos_emitter::SDOUBLE(double value) {
+  _pf.SDOUBLE(value);
+}
+
+#define __PLAIN(op) void udf::postfix_tos_emitter::op() { flush(); _pf.op(); }
+#define __INTEGER(op) void udf::postfix_tos_emitter::op(int value) { flush(); _pf.op(value); }
+#define __LABEL(op) void udf::postfix_tos_emitter::op(std::string label) { flush(); _pf.op(label); }
+UDF_TOS_SPILL_PLAIN(__PLAIN)
+UDF_TOS_SPILL_INTEGER(__INTEGER)
+UDF_TOS_SPILL_LABEL(__LABEL)
+#undef __PLAIN
+#undef __INTEGER
+#undef __LABEL
+
+//---------------------------------------------------------------------------
+// loads and stores
+
+void udf::postfix_tos_emitter::INT(int value) {
+  push_integer();
+  _cache[_size - 1].immediate = true; // loaded when needed
+  _cache[_size - 1].value = value;
+}
+
+void udf::postfix_tos_emitter::DOUBLE(double value) {
+  push_real();
+  if (value == 0 && !std::signbit(value)) {
+    emit("fldz");
+  } else if (value == 1) {
+    emit("fld1");
+  } else {
+    auto bits = std::bit_cast<std::uint64_t>(value);
+    emit("push", "dword " + hex(bits >> 32));
+    emit("push", "dword " + hex(bits & 0xffffffff));
+    emit("fld", "qword [esp]");
+    emit("add", "esp, 8");
+  }
+}
+
+void udf::postfix_tos_emitter::LOCAL(int offset) {
+  emit("lea", operands(push_integer(), frame(offset)));
+}
+
+void udf::postfix_tos_emitter::ADDR(std::string name) {
+  emit("mov", operands(push_integer(), "$" + name));
+}
+
+void udf::postfix_tos_emitter::LDINT() {
+  need(false);
+  emit("mov", operands(top().reg, std::string("[") + top().reg + "]"));
+}
+
+void udf::postfix_tos_emitter::STINT() {
+  if (_size == 2 && top(1).immediate && !top().real && !top().immediate) {
+    emit("mov", operands(std::string("dword [") + top().reg + "]", std::to_string(top(1).value)));
+    drop(2);
+    return;
+  }
+  need(false, false);
+  emit("mov", operands(std::string("[") + top().reg + "]", top(1).reg));
+  drop(2);
+}
+
+void udf::postfix_tos_emitter::LDDOUBLE() {
+  need(false);
+  const char *address = top().reg;
+  drop(1);
+  push_real();
+  emit("fld", std::string("qword [") + address + "]");
+}
+
+void udf::postfix_tos_emitter::STDOUBLE() {
+  need(true, false);
+  emit("fstp", std::string("qword [") + top().reg + "]");
+  drop(2);
+}
+
+void udf::postfix_tos_emitter::DUP32() {
+  need(false);
+  const char *source = top().reg;
+  emit("mov", operands(push_integer(), source));
+}
+
+void udf::postfix_tos_emitter::DUP64() {
+  if (_size > 0 && top().real) {
+    push_real();
+    emit("fld", "st0");
+  } else {
+    flush();
+    _pf.DUP64();
+  }
+}
+
+void udf::postfix_tos_emitter::DDUP() {
+  DUP64();
+}
+
+void udf::postfix_tos_emitter::TRASH(int bytes) {
+  // cached values are simply forgotten
+  while (_size > 0 && bytes >= (top().real ? 8 : 4)) {
+    if (top().real) {
+      emit("fstp", "st0");
+      bytes -= 8;
+    } else {
+      bytes -= 4;
+    }
+    drop(1);
+  }
+  if (bytes > 0) {
+    flush();
+    _pf.TRASH(bytes);
+  }
+}
+
+//---------------------------------------------------------------------------
+// function values: already where the cache keeps them
+
+void udf::postfix_tos_emitter::LDFVAL32() {
+  flush();
+  _cache[0] = { false, EAX };
+  _size = 1;
+}
+
+void udf::postfix_tos_emitter::LDFVAL64() {
+  flush();
+  _cache[0] = { true, nullptr };
+  _size = 1;
+}
+
+void udf::postfix_tos_emitter::STFVAL32() {
+  need(false);
+  while (_size > 1)
+    spill();
+  if (top().reg != EAX) emit("mov", operands(EAX, top().reg));
+  drop(1);
+}
+
+void udf::postfix_tos_emitter::STFVAL64() {
+  need(true);
+  while (_size > 1)
+    spill();
+  drop(1);
+}
+
+//---------------------------------------------------------------------------
+// integer arithmetic
+
+void udf::postfix_tos_emitter::binary(const char *opcode) {
+  if (immediate()) {
+    int value = top().value;
+    drop(1);
+    need(false);
+    emit(opcode, operands(top().reg, std::to_string(value)));
+    return;
+  }
+  need(false, false);
+  emit(opcode, operands(top(1).reg, top().reg));
+  drop(1);
+}
+
+/** The count is the top slot: in cl, unless it is a constant. */
+void udf::postfix_tos_emitter::shift(const char *opcode) {
+  if (immediate()) {
+    binary(opcode);
+    return;
+  }
+  need(false, false);
+  emit("mov", operands("ecx", top().reg));
+  emit(opcode, operands(top(1).reg, "cl"));
+  drop(1);
+}
+
+void udf::postfix_tos_emitter::ADD() {
+  binary("add");
+}
+void udf::postfix_tos_emitter::SUB() {
+  binary("sub");
+}
+void udf::postfix_tos_emitter::MUL() {
+  binary("imul");
+}
+void udf::postfix_tos_emitter::AND() {
+  binary("and");
+}
+void udf::postfix_tos_emitter::OR() {
+  binary("or");
+}
+void udf::postfix_tos_emitter::XOR() {
+  binary("xor");
+}
+void udf::postfix_tos_emitter::SHTL() {
+  shift("shl");
+}
+void udf::postfix_tos_emitter::SHTRS() {
+  shift("sar");
+}
+void udf::postfix_tos_emitter::SHTRU() {
+  shift("shr");
+}
+
+/** Division of the slot below by a known divisor (not 0, 1 or a power of two), without idiv. */
+bool udf::postfix_tos_emitter::divide(bool remainder) {
+  if (!immediate()) return false;
+  int d = top().value;
+  std::uint32_t magnitude = d < 0 ? -static_cast<std::uint32_t>(d) : d;
+  if (magnitude < 2 || std::has_single_bit(magnitude)) return false;
+  udf::divisor magic(magnitude);
+
+  drop(1);
+  need(false);
+  if (_size == 2) spill(); // edx:eax is the product
+  emit("mov", operands("ecx", top().reg));
+  emit("mov", operands(EAX, std::to_string(magic.multiplier)));
+  emit("imul", "ecx");
+  if (magic.multiplier < 0) emit("add", operands(EDX, "ecx"));
+  if (magic.shift > 0) emit("sar", operands(EDX, std::to_string(magic.shift)));
+  emit("mov", operands(EAX, EDX));
+  emit("shr", operands(EAX, "31"));
+  emit("add", operands(EDX, EAX));
+  if (d < 0) emit("neg", EDX);
+  drop(1);
+
+  if (remainder) {
+    emit("imul", operands(EDX, operands(EDX, std::to_string(d))));
+    emit("sub", operands("ecx", EDX));
+    emit("mov", operands(EAX, "ecx"));
+  }
+  _cache[_size++] = { false, remainder ? EAX : EDX };
+  return true;
+}
+
+void udf::postfix_tos_emitter::DIV() {
+  if (divide(false)) return;
+  need(false, false);
+  emit("mov", operands("ecx", top().reg));
+  if (top(1).reg != EAX) emit("mov", operands(EAX, top(1).reg));
+  emit("cdq");
+  emit("idiv", "ecx");
+  drop(2);
+  _cache[_size++] = { false, EAX };
+}
+
+void udf::postfix_tos_emitter::MOD() {
+  if (divide(true)) return;
+  DIV();
+  _cache[_size - 1].reg = EDX;
+}
+
+void udf::postfix_tos_emitter::NEG() {
+  need(false);
+  emit("neg", top().reg);
+}
+
+//---------------------------------------------------------------------------
+// comparisons and jumps
+
+void udf::postfix_tos_emitter::compare(const char *condition) {
+  if (immediate()) {
+    int value = top().value;
+    drop(1);
+    need(false);
+    emit("cmp", operands(top().reg, std::to_string(value)));
+  } else {
+    need(false, false);
+    emit("cmp", operands(top(1).reg, top().reg));
+    drop(1);
+  }
+  emit((std::string("set") + condition).c_str(), "cl");
+  emit("movzx", operands(top().reg, "cl"));
+}
+
+void udf::postfix_tos_emitter::EQ() {
+  compare("e");
+}
+void udf::postfix_tos_emitter::NE() {
+  compare("ne");
+}
+void udf::postfix_tos_emitter::LT() {
+  compare("l");
+}
+void udf::postfix_tos_emitter::LE() {
+  compare("le");
+}
+void udf::postfix_tos_emitter::GE() {
+  compare("ge");
+}
+void udf::postfix_tos_emitter::GT() {
+  compare("g");
+}
+void udf::postfix_tos_emitter::LTU() {
+  compare("b");
+}
+void udf::postfix_tos_emitter::LEU() {
+  compare("be");
+}
+void udf::postfix_tos_emitter::GEU() {
+  compare("ae");
+}
+void udf::postfix_tos_emitter::GTU() {
+  compare("a");
+}
+
+/** Compare the top two slots and jump: the target is reached with an empty cache. */
+void udf::postfix_tos_emitter::branch(const char *condition, const std::string &label) {
+  std::string right;
+  if (immediate()) {
+    right = std::to_string(top().value);
+    drop(1);
+    need(false);
+  } else {
+    need(false, false);
+    right = top().reg;
+    drop(1);
+  }
+  const char *left = top().reg;
+  drop(1);
+  emit("cmp", operands(left, right));
+  emit((std::string("j") + condition).c_str(), "near " + label);
+}
+
+void udf::postfix_tos_emitter::JZ(std::string label) {
+  need(false);
+  const char *reg = top().reg;
+  drop(1);
+  flush(); // does not touch reg
+  emit("test", operands(reg, reg));
+  emit("jz", "near " + label);
+}
+
+void udf::postfix_tos_emitter::JNZ(std::string label) {
+  need(false);
+  const char *reg = top().reg;
+  drop(1);
+  flush();
+  emit("test", operands(reg, reg));
+  emit("jnz", "near " + label);
+}
+
+void udf::postfix_tos_emitter::JEQ(std::string label) {
+  branch("e", label);
+}
+void udf::postfix_tos_emitter::JNE(std::string label) {
+  branch("ne", label);
+}
+void udf::postfix_tos_emitter::JLT(std::string label) {
+  branch("l", label);
+}
+void udf::postfix_tos_emitter::JLE(std::string label) {
+  branch("le", label);
+}
+void udf::postfix_tos_emitter::JGT(std::string label) {
+  branch("g", label);
+}
+void udf::postfix_tos_emitter::JGE(std::string label) {
+  branch("ge", label);
+}
+void udf::postfix_tos_emitter::JB(std::string label) {
+  branch("b", label);
+}
+void udf::postfix_tos_emitter::JBE(std::string label) {
+  branch("be", label);
+}
+void udf::postfix_tos_emitter::JA(std::string label) {
+  branch("a", label);
+}
+void udf::postfix_tos_emitter::JAE(std::string label) {
+  branch("ae", label);
+}
+
+//---------------------------------------------------------------------------
+// reals
+
+void udf::postfix_tos_emitter::I2D() {
+  need(false);
+  const char *reg = top().reg;
+  drop(1);
+  push_real();
+  emit("push", reg);
+  emit("fild", "dword [esp]");
+  emit("add", "esp, 4");
+}
+
+void udf::postfix_tos_emitter::real(const char *opcode) {
+  need(true, true);
+  emit(opcode, "st1, st0"); // st1 = st1 op st0, then pop
+  drop(1);
+}
+
+void udf::postfix_tos_emitter::DADD() {
+  real("faddp");
+}
+void udf::postfix_tos_emitter::DSUB() {
+  real("fsubp");
+}
+void udf::postfix_tos_emitter::DMUL() {
+  real("fmulp");
+}
+void udf::postfix_tos_emitter::DDIV() {
+  real("fdivp");
+}
+
+void udf::postfix_tos_emitter::DNEG() {
+  need(true);
+  emit("fchs");
+}
+
+/** -1, 0 or 1, as the first real is less than, equal to or greater than the second. */
+void udf::postfix_tos_emitter::DCMP() {
+  need(true, true);
+  emit("fxch");
+  emit("fucomip", "st0, st1");
+  emit("fstp", "st0");
+  drop(2);
+  const char *reg = push_integer();
+  emit("seta", "cl");
+  emit("setb", "ch");
+  emit("movzx", operands(reg, "cl"));
+  emit("movzx", operands("ecx", "ch"));
+  emit("sub", operands(reg, "ecx"));
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <cdk/emitters/basic_postfix_emitter.h>
+
+/* instructions with no effect on the stack: passed on as they are */
+#define UDF_TOS_DIRECTIVE_PLAIN(X) X(ALIGN)
+#define UDF_TOS_DIRECTIVE_INTEGER(X) X(SALLOC) X(SBYTE) X(SINT) X(SSHORT)
+#define UDF_TOS_DIRECTIVE_LABEL(X) X(EXTERN) X(SADDR) X(SSTRING)
+
+/* instructions left to the underlying emitter, once the cache is on the stack */
+#define UDF_TOS_SPILL_PLAIN(X) \
+  X(ALLOC) X(BSS) X(BRANCH) X(D2I) X(DATA) X(DIVU) X(DUPI) X(LDBYTE) X(LDSHORT) X(LEAVE) X(MODU) X(NOP) X(NOT) \
+  X(POP32) X(POP64) X(RET) X(RODATA) X(ROTL) X(ROTR) X(SP) X(STBYTE) X(STSHORT) X(SWAP32) X(SWAP64) X(TEXT)
+#define UDF_TOS_SPILL_INTEGER(X) X(DECR) X(ENTER) X(INCR) X(LEA) X(LOCA) X(LOCV) X(RETN) X(START)
+#define UDF_TOS_SPILL_LABEL(X) X(ADDRA) X(ADDRV) X(CALL) X(JMP) X(LABEL)
+
+namespace udf {
+
+  /**
+   * Postfix emitter for ix86 that keeps the top (one or two) stack slots
+   * in registers: integers and pointers in eax/edx, reals in the x87
+   * ST0/ST1. Arithmetic, comparisons, loads and stores work on the cached
+   * slots, loading them from the machine stack only when they are not
+   * there. The cache is written back to the stack (spilled) before calls,
+   * labels, jumps and section changes, so that every label is reached
+   * with the same (empty) cache; anything else is handed, after a spill,
+   * to the emitter being wrapped, which writes to the same stream.
+   * Integer constants are only loaded when needed: the instructions that
+   * take an immediate operand use them as such, and division by them is
+   * a multiplication (see divisor).
+   */
+  class postfix_tos_emitter: public cdk::basic_postfix_emitter {
+    struct slot {
+      bool real;
+      const char *reg; // integers: eax or edx; reals: nullptr (their x87 order is the cache order)
+      bool immediate = false; // a constant not yet loaded into reg
+      int value = 0;
+    };
+
+    cdk::basic_postfix_emitter &_pf;
+    slot _cache[2]; // bottom first
+    int _size = 0;
+
+  public:
+    postfix_tos_emitter(std::shared_ptr<cdk::compiler> compiler, cdk::basic_postfix_emitter &pf) :
+        cdk::basic_postfix_emitter(compiler), _pf(pf) {
+    }
+
+    postfix_tos_emitter(const postfix_tos_emitter&) = delete;
+    postfix_tos_emitter &operator=(const postfix_tos_emitter&) = delete;
+
+  private:
+    std::ostream &os() {
+      return *_compiler->ostream();
+    }
+    void emit(const char *opcode, const std::string &operands = "") {
+      os() << '\t' << opcode;
+      if (!operands.empty()) os() << '\t' << operands;
+      os() << '\n';
+    }
+
+    const slot &top(int k = 0) const {
+      return _cache[_size - 1 - k];
+    }
+    void spill();
+    void flush();
+    void settle();
+    bool immediate() const {
+      return _size > 0 && top().immediate;
+    }
+    void drop(int n) {
+      _size -= n;
+    }
+    void need(bool below, bool top);
+    void need(bool top);
+    const char *push_integer();
+    void push_real();
+
+    void binary(const char *opcode);
+    void shift(const char *opcode);
+    bool divide(bool remainder);
+    void compare(const char *condition);
+    void branch(const char *condition, const std::string &label);
+    void real(const char *opcode);
+
+  public:
+#define __PLAIN(op) void op() override;
+#define __INTEGER(op) void op(int) override;
+#define __LABEL(op) void op(std::string) override;
+    UDF_TOS_DIRECTIVE_PLAIN(__PLAIN)
+    UDF_TOS_DIRECTIVE_INTEGER(__INTEGER)
+    UDF_TOS_DIRECTIVE_LABEL(__LABEL)
+    UDF_TOS_SPILL_PLAIN(__PLAIN)
+    UDF_TOS_SPILL_INTEGER(__INTEGER)
+    UDF_TOS_SPILL_LABEL(__LABEL)
+#undef __PLAIN
+#undef __INTEGER
+#undef __LABEL
+    void GLOBAL(std::string name, std::string type) override;
+    void SDOUBLE(double value) override;
+
+    void INT(int value) override;
+    void DOUBLE(double value) override;
+    void LOCAL(int offset) override;
+    void ADDR(std::string name) override;
+    void LDINT() override;
+    void STINT() override;
+    void LDDOUBLE() override;
+    void STDOUBLE() override;
+    void DUP32() override;
+    void DUP64() override;
+    void DDUP() override;
+    void TRASH(int bytes) override;
+    void LDFVAL32() override;
+    void LDFVAL64() override;
+    void STFVAL32() override;
+    void STFVAL64() override;
+
+    void ADD() override;
+    void SUB() override;
+    void MUL() override;
+    void DIV() override;
+    void MOD() override;
+    void NEG() override;
+    void AND() override;
+    void OR() override;
+    void XOR() override;
+    void SHTL() override;
+    void SHTRS() override;
+    void SHTRU() override;
+
+    void EQ() override;
+    void NE() override;
+    void LT() override;
+    void LE() override;
+    void GE() override;
+    void GT() override;
+    void LTU() override;
+    void LEU() override;
+    void GEU() override;
+    void GTU() override;
+
+    void JZ(std::string label) override;
+    void JNZ(std::string label) override;
+    void JEQ(std::string label) override;
+    void JNE(std::string label) override;
+    void JLT(std::string label) override;
+    void JLE(std::string label) override;
+    void JGT(std::string label) override;
+    void JGE(std::string label) override;
+    void JB(std::string label) override;
+    void JBE(std::string label) override;
+    void JA(std::string label) override;
+    void JAE(std::string label) override;
+
+    void I2D() override;
+    void DADD() override;
+    void DSUB() override;
+    void DMUL() override;
+    void DDIV() override;
+    void DNEG() override;
+    void DCMP() override;
+  };
+
+} // udf
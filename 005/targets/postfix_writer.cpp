@@ -1,15 +1,331 @@
+#include <bit>
+#include <limits>
 #include <string>
 #include <sstream>
-#include "targets/type_checker.h"
 #include "targets/postfix_writer.h"
 #include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
 #include "targets/frame_size_calculator.h"
+#include "time_report.h"
 #include "targets/symbol.h"
 
 #include "udf_parser.tab.h"
 
 //---------------------------------------------------------------------------
 
+/** Emit the value found by the constant folder instead of the expression's code. */
+bool udf::postfix_writer::processConstant(cdk::expression_node *const node) {
+  auto value = _constants.find(node);
+  if (value == nullptr) return false;
+
+  if (auto integer = std::get_if<int>(value)) {
+    if (_inFunctionBody)
+      _pf.INT(*integer);
+    else
+      _pf.SINT(*integer);
+  } else {
+    if (_inFunctionBody)
+      _pf.DOUBLE(std::get<double>(*value));
+    else
+      _pf.SDOUBLE(std::get<double>(*value));
+  }
+  return true;
+}
+
+/** Load the value (or address) of an expression computed before its cycle. */
+bool udf::postfix_writer::processInvariant(cdk::typed_node *const node) {
+  auto it = _hoisted.find(node);
+  if (it == _hoisted.end()) return false;
+
+  _pf.LOCAL(it->second);
+  if (!udf::invariants::address(node) && node->is_typed(cdk::TYPE_DOUBLE))
+    _pf.LDDOUBLE();
+  else
+    _pf.LDINT();
+  return true;
+}
+
+/**
+ * Integer multiplication, division and modulo by a known power of two (or
+ * its negation) with shifts. Division rounds towards zero: a negative
+ * dividend is first biased by the divisor minus one, taken from its sign.
+ * Products by the sum or difference of two powers of two (3, 5, 7, 10...)
+ * are two shifts and an addition or a subtraction. Other divisors are
+ * left to the layers below (see postfix_peephole and postfix_tos_emitter).
+ */
+bool udf::postfix_writer::processShifts(cdk::binary_operation_node *const node, int lvl) {
+  if (!node->is_typed(cdk::TYPE_INT)) return false;
+  bool product = dynamic_cast<cdk::mul_node*>(node) != nullptr;
+  bool remainder = dynamic_cast<cdk::mod_node*>(node) != nullptr;
+
+  // products are commutative: the known operand may be either
+  auto operand = node->left();
+  auto value = _constants.find(node->right());
+  if (value == nullptr && product) {
+    operand = node->right();
+    value = _constants.find(node->left());
+  }
+  auto factor = value ? std::get_if<int>(value) : nullptr;
+  if (factor == nullptr || *factor == 0 || *factor == std::numeric_limits<int>::min()) return false;
+  unsigned magnitude = *factor < 0 ? -static_cast<unsigned>(*factor) : *factor;
+  if (!std::has_single_bit(magnitude)) return product && processShiftsAndAdd(operand, *factor, lvl);
+  int bits = std::countr_zero(magnitude);
+
+  operand->accept(this, lvl + 2);
+  auto bias = [&] { // n < 0 ? magnitude - 1 : 0, over n
+    _pf.DUP32();
+    if (bits > 1) {
+      _pf.INT(31);
+      _pf.SHTRS();
+    }
+    _pf.INT(32 - bits);
+    _pf.SHTRU();
+  };
+  if (product) {
+    _pf.INT(bits);
+    _pf.SHTL();
+  } else if (!remainder && bits > 0) {
+    bias();
+    _pf.ADD();
+    _pf.INT(bits);
+    _pf.SHTRS();
+  } else if (remainder && bits > 0) {
+    _pf.DUP32();
+    bias();
+    _pf.ADD();
+    _pf.INT(-static_cast<int>(magnitude));
+    _pf.AND();
+    _pf.SUB();
+  } else if (remainder) {
+    _pf.TRASH(4);
+    _pf.INT(0);
+  }
+  if (*factor < 0 && !remainder) _pf.NEG();
+  return true;
+}
+
+/**
+ * Integer product by a known factor whose magnitude is 2^a + 2^b or
+ * 2^a - 2^b (a > b): the operand shifted by b, plus or minus itself
+ * shifted by a - b. The difference is computed negated (the machine
+ * subtracts the top of the stack), which a negative factor cancels.
+ */
+bool udf::postfix_writer::processShiftsAndAdd(cdk::expression_node *const operand, int factor, int lvl) {
+  unsigned magnitude = factor < 0 ? -static_cast<unsigned>(factor) : factor;
+  int low = std::countr_zero(magnitude);
+  unsigned rest = magnitude >> low; // odd
+  bool sum = std::has_single_bit(rest - 1);
+  if (!sum && !std::has_single_bit(rest + 1)) return false;
+  int high = std::countr_zero(sum ? rest - 1 : rest + 1);
+
+  operand->accept(this, lvl + 2);
+  if (low > 0) {
+    _pf.INT(low);
+    _pf.SHTL();
+  }
+  _pf.DUP32();
+  _pf.INT(high);
+  _pf.SHTL();
+  if (sum) {
+    _pf.ADD();
+    if (factor < 0) _pf.NEG();
+  } else {
+    _pf.SUB();
+    if (factor > 0) _pf.NEG();
+  }
+  return true;
+}
+
+/** Indexing strength-reduced to a running pointer: the pointer is its address. */
+bool udf::postfix_writer::processInduction(cdk::typed_node *const node) {
+  auto it = _running.find(node);
+  if (it == _running.end()) return false;
+
+  _pf.LOCAL(it->second);
+  _pf.LDINT();
+  return true;
+}
+
+/**
+ * Label of the read-only cells of a tensor literal whose cells are all
+ * known: identical literals share them. The emitter aligns data to 4
+ * bytes only; the cells are aligned to 8, so that none of them spans two
+ * cache lines, by a directive of the assembler written after everything
+ * that came before it.
+ */
+std::string udf::postfix_writer::literal(udf::tensor_node *const node) {
+  std::vector<double> values;
+  std::vector<std::uint64_t> key;
+  for (auto cell : node->cell_values()->nodes()) {
+    values.push_back(std::visit([](auto v) { return static_cast<double>(v); }, *_constants.find(cell)));
+    key.push_back(std::bit_cast<std::uint64_t>(values.back()));
+  }
+  auto it = _literals.find(key);
+  if (it != _literals.end()) return it->second;
+
+  const auto lbl = mklbl(++_lbl);
+  _pf.RODATA();
+  _pf.flush();
+  *_compiler->ostream() << "\talign\t8\n";
+  _pf.LABEL(lbl);
+  for (auto value : values)
+    _pf.SDOUBLE(value);
+  _pf.TEXT();
+  _literals.emplace(key, lbl);
+  return lbl;
+}
+
+/**
+ * An elementwise tensor expression computed by a kernel of its own (see
+ * fusions). The operands are evaluated in order, tensors replaced by the
+ * address of their first cell, and kept in frame slots; so are the new
+ * tensor, the address of its first cell and the offset of the cell being
+ * computed, the same in all tensors (literals included). A literal alone
+ * is loaded by the runtime in one call.
+ */
+bool udf::postfix_writer::processFusion(cdk::expression_node *const node, int lvl) {
+  auto kernel = _fusions.find(node);
+  if (kernel == nullptr) return false;
+  auto &dims = cdk::tensor_type::cast(node->type())->dims();
+
+  // arguments of tensor_load: the new tensor goes above the cells
+  if (kernel->steps.size() == 1 && kernel->steps[0].op == udf::fusions::operation::literal) {
+    _pf.ADDR(literal(kernel->literals[0]));
+    for (size_t i = dims.size(); i-- > 0; )
+      _pf.INT(dims[i]);
+    _pf.INT(dims.size());
+    _functions_to_declare.insert("tensor_create");
+    _pf.CALL("tensor_create");
+    _pf.TRASH(4 * dims.size() + 4);
+    _pf.LDFVAL32();
+    _functions_to_declare.insert("tensor_load");
+    _pf.CALL("tensor_load");
+    _pf.TRASH(8);
+    _pf.LDFVAL32();
+    return true;
+  }
+
+  _functions_to_declare.insert("tensor_getptr");
+
+  // the address of the first cell: the tensor goes above as many zero indices as its rank
+  auto first = [&](size_t rank) {
+    _pf.CALL("tensor_getptr");
+    _pf.TRASH(4 * rank + 4);
+    _pf.LDFVAL32();
+  };
+
+  for (auto operand : kernel->operands) {
+    if (operand->is_typed(cdk::TYPE_TENSOR)) {
+      size_t rank = cdk::tensor_type::cast(operand->type())->n_dims();
+      for (size_t i = 0; i < rank; i++)
+        _pf.INT(0);
+      operand->accept(this, lvl + 2);
+      first(rank);
+    } else {
+      operand->accept(this, lvl + 2);
+      if (operand->is_typed(cdk::TYPE_INT)) _pf.I2D();
+    }
+  }
+
+  // the slots are taken only now: operands may have kernels of their own
+  const int saved = _offset;
+  std::vector<int> slots(kernel->operands.size());
+  for (size_t i = slots.size(); i-- > 0; ) {
+    bool tensor = kernel->operands[i]->is_typed(cdk::TYPE_TENSOR);
+    _offset -= tensor ? 4 : 8;
+    slots[i] = _offset;
+    _pf.LOCAL(_offset);
+    if (tensor)
+      _pf.STINT();
+    else
+      _pf.STDOUBLE();
+  }
+
+  for (size_t i = dims.size(); i-- > 0; )
+    _pf.INT(dims[i]);
+  _pf.INT(dims.size());
+  _functions_to_declare.insert("tensor_create");
+  _pf.CALL("tensor_create");
+  _pf.TRASH(4 * dims.size() + 4);
+  _pf.LDFVAL32();
+  const int result = _offset -= 4;
+  _pf.LOCAL(result);
+  _pf.STINT();
+
+  for (size_t i = 0; i < dims.size(); i++)
+    _pf.INT(0);
+  _pf.LOCAL(result);
+  _pf.LDINT();
+  first(dims.size());
+  const int cells = _offset -= 4;
+  _pf.LOCAL(cells);
+  _pf.STINT();
+
+  const int offset = _offset -= 4;
+  _pf.INT(0);
+  _pf.LOCAL(offset);
+  _pf.STINT();
+
+  std::vector<std::string> literals;
+  for (auto tensor : kernel->literals)
+    literals.push_back(literal(tensor));
+
+  auto cell = [&](int slot) { // address of the current cell of a tensor
+    _pf.LOCAL(slot);
+    _pf.LDINT();
+    _pf.LOCAL(offset);
+    _pf.LDINT();
+    _pf.ADD();
+  };
+
+  // there is at least one cell: the test is at the bottom
+  const auto lbl = mklbl(++_lbl);
+  _pf.ALIGN();
+  _pf.LABEL(lbl);
+  for (auto &step : kernel->steps) {
+    switch (step.op) {
+      case udf::fusions::operation::load:
+        if (kernel->operands[step.operand]->is_typed(cdk::TYPE_TENSOR))
+          cell(slots[step.operand]);
+        else
+          _pf.LOCAL(slots[step.operand]);
+        _pf.LDDOUBLE();
+        break;
+      case udf::fusions::operation::literal:
+        _pf.ADDR(literals[step.operand]);
+        _pf.LOCAL(offset);
+        _pf.LDINT();
+        _pf.ADD();
+        _pf.LDDOUBLE();
+        break;
+      case udf::fusions::operation::add: _pf.DADD(); break;
+      case udf::fusions::operation::sub: _pf.DSUB(); break;
+      case udf::fusions::operation::mul: _pf.DMUL(); break;
+      case udf::fusions::operation::div: _pf.DDIV(); break;
+      case udf::fusions::operation::neg: _pf.DNEG(); break;
+    }
+  }
+  cell(cells);
+  _pf.STDOUBLE();
+
+  _pf.LOCAL(offset);
+  _pf.LDINT();
+  _pf.INT(8);
+  _pf.ADD();
+  _pf.LOCAL(offset);
+  _pf.STINT();
+  _pf.LOCAL(offset);
+  _pf.LDINT();
+  _pf.INT(static_cast<int>(8 * kernel->cells));
+  _pf.JLT(lbl);
+
+  _pf.LOCAL(result);
+  _pf.LDINT();
+  _offset = saved;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
 void udf::postfix_writer::do_nil_node(cdk::nil_node * const node, int lvl) {
   // EMPTY
 }
@@ -23,38 +339,25 @@ void udf::postfix_writer::do_double_node(cdk::double_node * const node, int lvl)
     _pf.SDOUBLE(node->value());
 }
 void udf::postfix_writer::do_not_node(cdk::not_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   node->argument()->accept(this, lvl + 2); // the value we want to compare
   _pf.INT(0);                              // we want to compare it to false
   _pf.EQ(); // checks whether the last two values on the stack are equal
 }
 void udf::postfix_writer::do_and_node(cdk::and_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  const auto lbl = mklbl(++_lbl);
-  node->left()->accept(this, lvl + 2);
-  _pf.DUP32();
-  _pf.JZ(lbl);
-  node->right()->accept(this, lvl + 2);
-  _pf.AND();
-  _pf.ALIGN();
-  _pf.LABEL(lbl);
+  if (processConstant(node)) return;
+  processLogical(node, lvl);
 }
 void udf::postfix_writer::do_or_node(cdk::or_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  const auto lbl = mklbl(++_lbl);
-  node->left()->accept(this, lvl + 2);
-  _pf.DUP32();
-  _pf.JNZ(lbl);
-  node->right()->accept(this, lvl + 2);
-  _pf.OR();
-  _pf.ALIGN();
-  _pf.LABEL(lbl);
+  if (processConstant(node)) return;
+  processLogical(node, lvl);
 }
 
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_sequence_node(cdk::sequence_node * const node, int lvl) {
   for (size_t i = 0; i < node->size(); i++) {
+    if (_dead.skipped(node->node(i))) continue; // unreachable or useless
     node->node(i)->accept(this, lvl);
   }
 }
@@ -89,8 +392,7 @@ void udf::postfix_writer::do_string_node(cdk::string_node * const node, int lvl)
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_unary_minus_node(cdk::unary_minus_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processConstant(node) || processFusion(node, lvl)) return;
   node->argument()->accept(this, lvl);
   if (node->argument()->is_typed(cdk::TYPE_INT))
     _pf.NEG();
@@ -108,15 +410,14 @@ void udf::postfix_writer::do_unary_minus_node(cdk::unary_minus_node * const node
 }
 
 void udf::postfix_writer::do_unary_plus_node(cdk::unary_plus_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node) || processFusion(node, lvl)) return;
   node->argument()->accept(this, lvl);
 }
 
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_add_node(cdk::add_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processConstant(node) || processInvariant(node) || processFusion(node, lvl)) return;
   if(!node->is_typed(cdk::TYPE_TENSOR)) {
     node->left()->accept(this, lvl + 2);
 
@@ -174,10 +475,13 @@ void udf::postfix_writer::do_add_node(cdk::add_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_sub_node(cdk::sub_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processConstant(node) || processInvariant(node) || processFusion(node, lvl)) return;
   node->left()->accept(this, lvl);
+  if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
+    _pf.I2D();
   node->right()->accept(this, lvl);
+  if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
+    _pf.I2D();
 
   if (!node->is_typed(cdk::TYPE_DOUBLE) && !node->is_typed(cdk::TYPE_TENSOR)) {
     _pf.SUB();
@@ -229,8 +533,7 @@ void udf::postfix_writer::do_sub_node(cdk::sub_node * const node, int lvl) {
   }
 }
 void udf::postfix_writer::do_mul_node(cdk::mul_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processConstant(node) || processInvariant(node) || processShifts(node, lvl) || processFusion(node, lvl)) return;
   if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)){
     node->right()->accept(this, lvl + 2);
     node->left()->accept(this, lvl + 2);
@@ -276,11 +579,14 @@ void udf::postfix_writer::do_mul_node(cdk::mul_node * const node, int lvl) {
   }
 }
 void udf::postfix_writer::do_div_node(cdk::div_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processConstant(node) || processInvariant(node) || processShifts(node, lvl) || processFusion(node, lvl)) return;
   if (!node->is_typed(cdk::TYPE_TENSOR)) {
     node->left()->accept(this, lvl);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
     node->right()->accept(this, lvl);
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
 
     if (node->is_typed(cdk::TYPE_DOUBLE))
       _pf.DDIV();
@@ -312,8 +618,6 @@ void udf::postfix_writer::do_div_node(cdk::div_node * const node, int lvl) {
         _pf.I2D();
 
       node->right()->accept(this, lvl);
-      _functions_to_declare.insert("mem_init");
-      _pf.CALL("mem_init");
       _functions_to_declare.insert("tensor_ones");
       size_t n_dims = cdk::tensor_type::cast(node->right()->type())->n_dims();
 
@@ -338,7 +642,7 @@ void udf::postfix_writer::do_div_node(cdk::div_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_mod_node(cdk::mod_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node) || processInvariant(node) || processShifts(node, lvl)) return;
   node->left()->accept(this, lvl);
   node->right()->accept(this, lvl);
   _pf.MOD();
@@ -347,11 +651,11 @@ void udf::postfix_writer::do_mod_node(cdk::mod_node * const node, int lvl) {
 void udf::postfix_writer::processCompares(cdk::binary_operation_node *const node, int lvl) {
 
   node->left()->accept(this, lvl);
-  if (node->left()->is_typed(cdk::TYPE_DOUBLE) && node->right()->is_typed(cdk::TYPE_INT)) {
+  if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_DOUBLE)) {
     _pf.I2D();
   }
   node->right()->accept(this, lvl);
-  if (node->right()->is_typed(cdk::TYPE_DOUBLE) && node->left()->is_typed(cdk::TYPE_INT)) {
+  if (node->right()->is_typed(cdk::TYPE_INT) && node->left()->is_typed(cdk::TYPE_DOUBLE)) {
     _pf.I2D();
   }
 
@@ -361,31 +665,122 @@ void udf::postfix_writer::processCompares(cdk::binary_operation_node *const node
   }
 }
 
+/** Operands of == and != (other than tensors): reals are compared with DCMP, like the other comparisons. */
+void udf::postfix_writer::processEquality(cdk::binary_operation_node *const node, int lvl) {
+  if (node->left()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_DOUBLE)) {
+    processCompares(node, lvl);
+  } else {
+    node->left()->accept(this, lvl);
+    node->right()->accept(this, lvl);
+  }
+}
+
+namespace {
+  /** Whether a comparison can become a conditional jump (tensors are compared by the runtime). */
+  bool is_scalar(cdk::expression_node *const node) {
+    return !node->is_typed(cdk::TYPE_TENSOR);
+  }
+}
+
+/**
+ * Jump to lbl if the condition's value is `when` and fall through otherwise.
+ * Comparisons jump directly, instead of computing 0 or 1 to be tested, and
+ * each operand of && and || jumps to where evaluation must continue.
+ */
+void udf::postfix_writer::processCondition(cdk::expression_node *const node, const std::string &lbl, bool when,
+                                           int lvl) {
+  if (auto value = _constants.find(node)) {
+    if (udf::is_true(*value) == when) _pf.JMP(lbl);
+    return;
+  }
+
+  if (auto n = dynamic_cast<cdk::not_node*>(node)) {
+    processCondition(n->argument(), lbl, !when, lvl);
+  } else if (auto n = dynamic_cast<cdk::and_node*>(node)) {
+    if (when) {
+      const auto lblFalse = mklbl(++_lbl);
+      processCondition(n->left(), lblFalse, false, lvl);
+      processCondition(n->right(), lbl, true, lvl);
+      _pf.LABEL(lblFalse);
+    } else {
+      processCondition(n->left(), lbl, false, lvl);
+      processCondition(n->right(), lbl, false, lvl);
+    }
+  } else if (auto n = dynamic_cast<cdk::or_node*>(node)) {
+    if (when) {
+      processCondition(n->left(), lbl, true, lvl);
+      processCondition(n->right(), lbl, true, lvl);
+    } else {
+      const auto lblTrue = mklbl(++_lbl);
+      processCondition(n->left(), lblTrue, true, lvl);
+      processCondition(n->right(), lbl, false, lvl);
+      _pf.LABEL(lblTrue);
+    }
+  } else if (auto n = dynamic_cast<cdk::lt_node*>(node)) {
+    processCompares(n, lvl);
+    when ? _pf.JLT(lbl) : _pf.JGE(lbl);
+  } else if (auto n = dynamic_cast<cdk::le_node*>(node)) {
+    processCompares(n, lvl);
+    when ? _pf.JLE(lbl) : _pf.JGT(lbl);
+  } else if (auto n = dynamic_cast<cdk::ge_node*>(node)) {
+    processCompares(n, lvl);
+    when ? _pf.JGE(lbl) : _pf.JLT(lbl);
+  } else if (auto n = dynamic_cast<cdk::gt_node*>(node)) {
+    processCompares(n, lvl);
+    when ? _pf.JGT(lbl) : _pf.JLE(lbl);
+  } else if (auto n = dynamic_cast<cdk::eq_node*>(node); n && is_scalar(n->left()) && is_scalar(n->right())) {
+    processEquality(n, lvl);
+    when ? _pf.JEQ(lbl) : _pf.JNE(lbl);
+  } else if (auto n = dynamic_cast<cdk::ne_node*>(node); n && is_scalar(n->left()) && is_scalar(n->right())) {
+    processEquality(n, lvl);
+    when ? _pf.JNE(lbl) : _pf.JEQ(lbl);
+  } else {
+    node->accept(this, lvl);
+    when ? _pf.JNZ(lbl) : _pf.JZ(lbl);
+  }
+}
+
+/** Value (0 or 1) of && and ||, computed with jumps. */
+void udf::postfix_writer::processLogical(cdk::expression_node *const node, int lvl) {
+  const auto lblFalse = mklbl(++_lbl), lblEnd = mklbl(++_lbl);
+  processCondition(node, lblFalse, false, lvl);
+  _pf.INT(1);
+  _pf.JMP(lblEnd);
+  _pf.ALIGN();
+  _pf.LABEL(lblFalse);
+  _pf.INT(0);
+  _pf.ALIGN();
+  _pf.LABEL(lblEnd);
+}
+
 void udf::postfix_writer::do_lt_node(cdk::lt_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   processCompares(node, lvl);
   _pf.LT();
 }
 void udf::postfix_writer::do_le_node(cdk::le_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   processCompares(node, lvl);
   _pf.LE();
 }
 void udf::postfix_writer::do_ge_node(cdk::ge_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   processCompares(node, lvl);
   _pf.GE();
 }
 void udf::postfix_writer::do_gt_node(cdk::gt_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   processCompares(node, lvl);
   _pf.GT();
 }
 void udf::postfix_writer::do_ne_node(cdk::ne_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  node->left()->accept(this, lvl);
-  node->right()->accept(this, lvl);
+  if (processConstant(node)) return;
+  if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+    node->left()->accept(this, lvl);
+    node->right()->accept(this, lvl);
+  } else {
+    processEquality(node, lvl);
+  }
 
   if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
     auto t1_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->left()->type());
@@ -409,10 +804,13 @@ void udf::postfix_writer::do_ne_node(cdk::ne_node * const node, int lvl) {
     _pf.NE();
 }
 void udf::postfix_writer::do_eq_node(cdk::eq_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  
-  node->right()->accept(this, lvl);
-  node->left()->accept(this, lvl);
+  if (processConstant(node)) return;
+  if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+    node->right()->accept(this, lvl);
+    node->left()->accept(this, lvl);
+  } else {
+    processEquality(node, lvl);
+  }
 
   if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
     auto t1_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->left()->type());
@@ -440,9 +838,7 @@ void udf::postfix_writer::do_eq_node(cdk::eq_node * const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_variable_node(cdk::variable_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  const std::string &id = node->name();
-  auto symbol = _symtab.find(id);
+  auto symbol = _symtab.find(udf::name_of(node));
   if (symbol->global()) {
     _pf.ADDR(symbol->name());
   } else {
@@ -451,7 +847,7 @@ void udf::postfix_writer::do_variable_node(cdk::variable_node * const node, int
 }
 
 void udf::postfix_writer::do_rvalue_node(cdk::rvalue_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processConstant(node)) return;
   node->lvalue()->accept(this, lvl);
   if (node->is_typed(cdk::TYPE_DOUBLE))
     _pf.LDDOUBLE();
@@ -460,9 +856,15 @@ void udf::postfix_writer::do_rvalue_node(cdk::rvalue_node * const node, int lvl)
 }
 
 void udf::postfix_writer::do_assignment_node(cdk::assignment_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   node->rvalue()->accept(this, lvl); // determine the new value
 
+  if (_dead.dropped(node)) {
+    // nobody reads the variable: only the value is left
+    if (node->is_typed(cdk::TYPE_DOUBLE) && node->rvalue()->is_typed(cdk::TYPE_INT))
+      _pf.I2D();
+    return;
+  }
+
   if (!node->is_typed(cdk::TYPE_DOUBLE)) {
     _pf.DUP32();
   } else {
@@ -481,8 +883,6 @@ void udf::postfix_writer::do_assignment_node(cdk::assignment_node * const node,
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_evaluation_node(udf::evaluation_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   node->argument()->accept(this, lvl); // determine the value
   if (node->argument()->is_typed(cdk::TYPE_VOID)) {
   } else 
@@ -492,10 +892,15 @@ void udf::postfix_writer::do_evaluation_node(udf::evaluation_node * const node,
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_if_node(udf::if_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (auto condition = _constants.find(node->condition())) {
+    // known condition: only the live branch is generated
+    if (udf::is_true(*condition))
+      node->block()->accept(this, lvl + 2);
+    return;
+  }
+
   int lbl1;
-  node->condition()->accept(this, lvl);
-  _pf.JZ(mklbl(lbl1 = ++_lbl));
+  processCondition(node->condition(), mklbl(lbl1 = ++_lbl), false, lvl);
   node->block()->accept(this, lvl + 2);
   _pf.LABEL(mklbl(lbl1));
 }
@@ -503,10 +908,17 @@ void udf::postfix_writer::do_if_node(udf::if_node * const node, int lvl) {
 //---------------------------------------------------------------------------
 
 void udf::postfix_writer::do_if_else_node(udf::if_else_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (auto condition = _constants.find(node->condition())) {
+    // known condition: only the live branch is generated
+    if (udf::is_true(*condition))
+      node->thenblock()->accept(this, lvl + 2);
+    else if (node->elseblock())
+      node->elseblock()->accept(this, lvl + 2);
+    return;
+  }
+
   int lbl1, lbl2;
-  node->condition()->accept(this, lvl);
-  _pf.JZ(mklbl(lbl1 = ++_lbl));
+  processCondition(node->condition(), mklbl(lbl1 = ++_lbl), false, lvl);
   node->thenblock()->accept(this, lvl + 2);
   _pf.JMP(mklbl(lbl2 = ++_lbl));
   _pf.LABEL(mklbl(lbl1));
@@ -532,28 +944,71 @@ void udf::postfix_writer::do_continue_node(udf::continue_node * const node, int
 }
 
 void udf::postfix_writer::do_for_node(udf::for_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   _forIni.push(++_lbl);
   _forStep.push(++_lbl);
   _forEnd.push(++_lbl);
+  int lblTest = ++_lbl;
 
   _symtab.push();
 
   node->init()->accept(this, lvl + 2);
 
+  // invariant expressions are computed once, before the cycle
+  for (auto expression : _invariants.hoisted(node)) {
+    expression->accept(this, lvl + 2);
+    bool real = !udf::invariants::address(expression) && expression->is_typed(cdk::TYPE_DOUBLE);
+    _offset -= real ? 8 : 4;
+    _pf.LOCAL(_offset);
+    if (real)
+      _pf.STDOUBLE();
+    else
+      _pf.STINT();
+    _hoisted[expression] = _offset;
+  }
+
+  // indexing that follows induction variables walks running pointers
+  for (auto &pointer : _inductions.pointers(node)) {
+    pointer.start->accept(this, lvl + 2);
+    _offset -= 4;
+    _pf.LOCAL(_offset);
+    _pf.STINT();
+    for (auto use : pointer.uses)
+      _running[use] = _offset;
+    _steps[pointer.step].emplace_back(_offset, pointer.cells * static_cast<int>(pointer.start->type()->size()));
+  }
+
+  // the condition is tested at the bottom: one jump per cycle, taken while it holds
+  _pf.JMP(mklbl(lblTest));
+
   _pf.ALIGN();
   _pf.LABEL(mklbl(_forIni.top()));
-  
-  node->condition()->accept(this, lvl + 2);
-  _pf.JZ(mklbl(_forEnd.top()));
-
   node->instruction()->accept(this, lvl + 2);
 
   _pf.ALIGN();
   _pf.LABEL(mklbl(_forStep.top()));
-  node->increment()->accept(this, lvl + 2);
-  
-  _pf.JMP(mklbl(_forIni.top()));
+  for (auto n : node->increment()->nodes()) {
+    if (_dead.skipped(n)) continue;
+    n->accept(this, lvl + 2);
+    for (auto [slot, bytes] : _steps[n]) {
+      _pf.LOCAL(slot);
+      _pf.LDINT();
+      _pf.INT(bytes);
+      _pf.ADD();
+      _pf.LOCAL(slot);
+      _pf.STINT();
+    }
+  }
+
+  _pf.ALIGN();
+  _pf.LABEL(mklbl(lblTest));
+  auto condition = node->condition();
+  for (size_t i = 0; i + 1 < condition->size(); i++)
+    condition->node(i)->accept(this, lvl + 2);
+  if (condition->size() == 0)
+    _pf.JMP(mklbl(_forIni.top()));
+  else
+    processCondition(dynamic_cast<cdk::expression_node*>(condition->node(condition->size() - 1)),
+                     mklbl(_forIni.top()), true, lvl + 2);
 
   _pf.ALIGN();
   _pf.LABEL(mklbl(_forEnd.top()));
@@ -566,9 +1021,6 @@ void udf::postfix_writer::do_for_node(udf::for_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_input_node(udf::input_node * const node, int lvl) {
-
-  ASSERT_SAFE_EXPRESSIONS;
-
   if (node->is_typed(cdk::TYPE_DOUBLE)) {
     _functions_to_declare.insert("readd");
     _pf.CALL("readd");
@@ -584,7 +1036,6 @@ void udf::postfix_writer::do_input_node(udf::input_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   if (_inFunctionBody)
     _pf.INT(0);
   else
@@ -592,7 +1043,6 @@ void udf::postfix_writer::do_nullptr_node(udf::nullptr_node *const node, int lvl
 }
 
 void udf::postfix_writer::do_stack_alloc_node(udf::stack_alloc_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   node->argument()->accept(this, lvl);
 
   _pf.INT(cdk::reference_type::cast(node->type())->referenced()->size());
@@ -602,9 +1052,6 @@ void udf::postfix_writer::do_stack_alloc_node(udf::stack_alloc_node * const node
 }
 
 void udf::postfix_writer::do_return_node(udf::return_node * const node, int lvl) {
-
-  ASSERT_SAFE_EXPRESSIONS;
-
   // should not reach here without returning a value (if not void)
   if (_function->type()->name() != cdk::TYPE_VOID) {
     node->retval()->accept(this, lvl + 2);
@@ -622,13 +1069,12 @@ void udf::postfix_writer::do_return_node(udf::return_node * const node, int lvl)
     }
   }
 
-  //_returnSeen = true;
   _pf.LEAVE();
   _pf.RET();
 }
 
 void udf::postfix_writer::do_sizeof_node(udf::sizeof_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processInvariant(node)) return;
   if (node->expression()->is_typed(cdk::TYPE_TENSOR)) {
     node->expression()->accept(this, lvl + 2);
     _functions_to_declare.insert("tensor_size");
@@ -642,9 +1088,6 @@ void udf::postfix_writer::do_sizeof_node(udf::sizeof_node * const node, int lvl)
 }
 
 void udf::postfix_writer::do_write_node(udf::write_node * const node, int lvl) {
-
-  ASSERT_SAFE_EXPRESSIONS;
-
   for (size_t ix = 0; ix < node->args()->size(); ix++) {
     auto child = dynamic_cast<cdk::expression_node*>(node->args()->node(ix));
 
@@ -683,25 +1126,35 @@ void udf::postfix_writer::do_write_node(udf::write_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_function_declaration_node(udf::function_declaration_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   if (_inFunctionBody || _inFunctionArgs) {
     error(node->lineno(), "cannot declare function in body or in arguments");
     return;
   }
 
-  if (!new_symbol()) return;
+  // types were already checked: just make the function known here
+  auto function = udf::make_symbol(node->qualifier(), node->type(), udf::function_name(node->identifier()),
+                                   false, true, true);
+  std::vector<std::shared_ptr<cdk::basic_type>> argtypes;
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    argtypes.push_back(node->argument(ax)->type());
+  function->set_argument_types(argtypes);
 
-  auto function = new_symbol();
+  if (!_symtab.find(function->name())) _symtab.insert(function->name(), function);
   _functions_to_declare.insert(function->name());
-  reset_new_symbol();
 }
 
 void udf::postfix_writer::do_variable_declaration_node(udf::variable_declaration_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS; 
-
   auto id = node->identifier();
   int offset = 0, typesize = node->type()->size();
+
+  if (_inFunctionBody && _dead.dropped(node)) {
+    // never read: no slot, and the initializer only matters for its side effects
+    if (node->initializer() && !_dead.skipped(node->initializer())) {
+      node->initializer()->accept(this, lvl);
+      _pf.TRASH(node->initializer()->type()->size());
+    }
+    return;
+  }
   
   if(_inFunctionBody) {
     // local variables
@@ -717,11 +1170,10 @@ void udf::postfix_writer::do_variable_declaration_node(udf::variable_declaration
     offset = 0;  // global var
   }
  
-  auto symbol = new_symbol();  // o typechecker ja deu insert na symtab
-  if (symbol) {
-    symbol->set_offset(offset);  // def acima (para saber se é global/local/args...)
-    reset_new_symbol(); 
-  }
+  // o typechecker ja deduziu o tipo (auto incluido)
+  auto symbol = udf::make_symbol(node->qualifier(), node->type(), id, (bool)node->initializer(), false);
+  symbol->set_offset(offset);  // def acima (para saber se é global/local/args...)
+  _symtab.insert(id, symbol);
 
   if(_inFunctionBody) {
     // if local var, no action needed unless an initialier exists
@@ -766,54 +1218,53 @@ void udf::postfix_writer::do_variable_declaration_node(udf::variable_declaration
       }
     }
   } 
-  else {
-    // gloval vars neste else
-    if (!_function) {
-      if (node->initializer() == nullptr) {  // sem valor inicial
-        _pf.BSS();         // data segment for uninitialized values
+  else if (!_inFunctionArgs) {
+    // gloval vars neste else (also those declared after functions)
+    if (node->initializer() == nullptr) {  // sem valor inicial
+      _pf.BSS();         // data segment for uninitialized values
+      _pf.ALIGN();
+      _pf.LABEL(id);
+      _pf.SALLOC(typesize); // declares an uninitialized vector with length size (in bytes)
+    } else { 
+      // com valor inicial
+      if (node->is_typed(cdk::TYPE_INT) || node->is_typed(cdk::TYPE_DOUBLE) || node->is_typed(cdk::TYPE_POINTER)) {
+
+        _pf.DATA();
         _pf.ALIGN();
-        _pf.LABEL(id);
-        _pf.SALLOC(typesize); // declares an uninitialized vector with length size (in bytes)
-      } else { 
-        // com valor inicial
-        if (node->is_typed(cdk::TYPE_INT) || node->is_typed(cdk::TYPE_DOUBLE) || node->is_typed(cdk::TYPE_POINTER)) {
-
-          _pf.DATA();
-          _pf.ALIGN();
-          _pf.LABEL(id);  
+        _pf.LABEL(id);  
 
-          if (node->is_typed(cdk::TYPE_INT)) {
-            node->initializer()->accept(this, lvl);
-          } else if (node->is_typed(cdk::TYPE_POINTER)) {
+        if (node->is_typed(cdk::TYPE_INT)) {
+          node->initializer()->accept(this, lvl);
+        } else if (node->is_typed(cdk::TYPE_POINTER)) {
+          node->initializer()->accept(this, lvl);
+        } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+          if (node->initializer()->is_typed(cdk::TYPE_DOUBLE)) {
             node->initializer()->accept(this, lvl);
-          } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
-            if (node->initializer()->is_typed(cdk::TYPE_DOUBLE)) {
-              node->initializer()->accept(this, lvl);
-            } else if (node->initializer()->is_typed(cdk::TYPE_INT)) {
-              cdk::integer_node * dclini = dynamic_cast<cdk::integer_node*>(node->initializer());
-              cdk::double_node ddi(dclini->lineno(), dclini->value());
-              ddi.accept(this, lvl);
-            } else {
-              std::cerr << node->lineno() << ": '" << id << "' has bad initializer for real value\n";
-            }
+          } else if (auto value = _constants.find(node->initializer())) {
+            _pf.SDOUBLE(std::get<int>(*value));
+          } else if (node->initializer()->is_typed(cdk::TYPE_INT)) {
+            cdk::integer_node * dclini = dynamic_cast<cdk::integer_node*>(node->initializer());
+            cdk::double_node ddi(dclini->lineno(), dclini->value());
+            ddi.accept(this, lvl);
+          } else {
+            std::cerr << node->lineno() << ": '" << id << "' has bad initializer for real value\n";
           }
-        } 
-        else if (node->is_typed(cdk::TYPE_STRING)) {
-          _pf.DATA();
-          _pf.ALIGN();
-          _pf.LABEL(id);
-          node->initializer()->accept(this, lvl);
-        } 
-        else {
-          std::cerr << node->lineno() << ": '" << id << "' has unexpected initializer\n";
         }
+      } 
+      else if (node->is_typed(cdk::TYPE_STRING)) {
+        _pf.DATA();
+        _pf.ALIGN();
+        _pf.LABEL(id);
+        node->initializer()->accept(this, lvl);
+      } 
+      else {
+        std::cerr << node->lineno() << ": '" << id << "' has unexpected initializer\n";
       }
     }
   }
 }
 
 void udf::postfix_writer::do_block_node(udf::block_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   _symtab.push();
   if (node->declarations())
     node->declarations()->accept(this, lvl + 2);
@@ -823,17 +1274,21 @@ void udf::postfix_writer::do_block_node(udf::block_node * const node, int lvl) {
 }
 
 void udf::postfix_writer::do_function_definition_node(udf::function_definition_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
   if (_inFunctionBody || _inFunctionArgs) {
     error(node->lineno(), "cannot define function in body or in arguments");
     return;
   }
 
   // remember symbol so that args and body know
-  _function = new_symbol();
+  _function = udf::make_symbol(node->qualifier(), node->type(), udf::function_name(node->identifier()),
+                               true, true, false);
+  std::vector<std::shared_ptr<cdk::basic_type>> argtypes;
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    argtypes.push_back(node->argument(ax)->type());
+  _function->set_argument_types(argtypes);
+
+  if (!_symtab.replace(_function->name(), _function)) _symtab.insert(_function->name(), _function);
   _functions_to_declare.erase(_function->name());  // just in case
-  reset_new_symbol();
 
   _offset = 8; // prepare for arguments (4: remember to account for return address)
   _symtab.push(); // scope of args
@@ -856,8 +1311,8 @@ void udf::postfix_writer::do_function_definition_node(udf::function_definition_n
   _pf.LABEL(_function->name());
 
   // compute stack size to be reserved for local variables
-  frame_size_calculator lsc(_compiler, _symtab, _function);
-  node->accept(&lsc, lvl);
+  frame_size_calculator lsc(_compiler, _symtab, _function, _dead, _invariants, _inductions, _fusions);
+  udf::time_report::timed(udf::time_report::FRAME_SIZE, [&] { node->accept(&lsc, lvl); });
   _pf.ENTER(lsc.localsize()); // total stack size reserved for local variables
 
   if(!_memInitialized && node->identifier() == "udf") {
@@ -868,18 +1323,14 @@ void udf::postfix_writer::do_function_definition_node(udf::function_definition_n
 
   _offset = 0; // prepare for local variable
 
-  //_returnSeen = false;
   _inFunctionBody = true;
-  os() << "        ;; before body " << std::endl;
   node->block()->accept(this, lvl + 4); // block has its own scope
-  os() << "        ;; after body " << std::endl;
   _inFunctionBody = false;
 
-  // if (!_returnSeen) {
-    _pf.LEAVE();
-    _pf.RET();
-  // }
-  
+  // after a final 'return', the peephole drops this second epilogue
+  _pf.LEAVE();
+  _pf.RET();
+
   _symtab.pop(); // scope of arguments
 
   if (node->identifier() == "udf") {
@@ -891,9 +1342,7 @@ void udf::postfix_writer::do_function_definition_node(udf::function_definition_n
 
 
 void udf::postfix_writer::do_function_call_node(udf::function_call_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
-  auto symbol = _symtab.find(node->identifier());
+  auto symbol = _symtab.find(node->id());
 
   size_t argsSize = 0;
   if (node->arguments()->size() > 0) {
@@ -921,7 +1370,7 @@ void udf::postfix_writer::do_function_call_node(udf::function_call_node * const
 }
 
 void udf::postfix_writer::do_tensor_capacity_node(udf::tensor_capacity_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processInvariant(node)) return;
   node->tensor()->accept(this, lvl + 2);
   _functions_to_declare.insert("tensor_size");
   _pf.CALL("tensor_size");
@@ -930,7 +1379,6 @@ void udf::postfix_writer::do_tensor_capacity_node(udf::tensor_capacity_node * co
 }
 
 void udf::postfix_writer::do_tensor_contraction_node(udf::tensor_contraction_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   node->tensor2()->accept(this, lvl + 2);
   node->tensor1()->accept(this, lvl + 2);
 
@@ -941,8 +1389,7 @@ void udf::postfix_writer::do_tensor_contraction_node(udf::tensor_contraction_nod
 }
 
 void udf::postfix_writer::do_tensor_dims_node(udf::tensor_dims_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processInvariant(node)) return;
   node->tensor()->accept(this, lvl + 2);
   _functions_to_declare.insert("tensor_get_dims");
   _pf.CALL("tensor_get_dims");
@@ -951,8 +1398,7 @@ void udf::postfix_writer::do_tensor_dims_node(udf::tensor_dims_node * const node
 }
 
 void udf::postfix_writer::do_tensor_dim_node(udf::tensor_dim_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processInvariant(node)) return;
   node->index()->accept(this, lvl + 2); // aceitar o índice
   node->tensor()->accept(this, lvl + 2);
   _functions_to_declare.insert("tensor_get_dim_size");
@@ -962,8 +1408,7 @@ void udf::postfix_writer::do_tensor_dim_node(udf::tensor_dim_node * const node,
 }
 
 void udf::postfix_writer::do_tensor_index_node(udf::tensor_index_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-
+  if (processInvariant(node)) return;
   for (size_t i = 0; i < node->indices()->size(); i++) {
     node->indices()->node(i)->accept(this, lvl + 2); // aceitar cada índice
   }
@@ -976,7 +1421,7 @@ void udf::postfix_writer::do_tensor_index_node(udf::tensor_index_node * const no
 }
 
 void udf::postfix_writer::do_tensor_rank_node(udf::tensor_rank_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processInvariant(node)) return;
   node->tensor()->accept(this, lvl + 2);
   _functions_to_declare.insert("tensor_get_n_dims");
   _pf.CALL("tensor_get_n_dims");
@@ -985,8 +1430,6 @@ void udf::postfix_writer::do_tensor_rank_node(udf::tensor_rank_node * const node
 }
 
 void udf::postfix_writer::do_tensor_reshape_node(udf::tensor_reshape_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
-  
   for (ssize_t i = node->new_dims()->size() - 1; i >= 0; i--) {
     node->new_dims()->node(i)->accept(this, lvl + 2); // aceitar cada dimensão
   }
@@ -1001,10 +1444,8 @@ void udf::postfix_writer::do_tensor_reshape_node(udf::tensor_reshape_node * cons
 }
 
 void udf::postfix_writer::do_tensor_node(udf::tensor_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processFusion(node, lvl)) return; // known cells: copied
   _pf.TEXT();
-  _functions_to_declare.insert("mem_init");
-  _pf.CALL("mem_init");
   // por argumentos de tensor_create na pilha
   for (ssize_t i = node->dims().size() - 1; i >= 0; i--) {
     _pf.INT(node->dims()[i]);
@@ -1033,16 +1474,22 @@ void udf::postfix_writer::do_tensor_node(udf::tensor_node * const node, int lvl)
 }
 
 void udf::postfix_writer::do_address_of_node(udf::address_of_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
   node->lvalue()->accept(this, lvl + 2);
 }
 
 void udf::postfix_writer::do_index_node(udf::index_node * const node, int lvl) {
-  ASSERT_SAFE_EXPRESSIONS;
+  if (processInvariant(node) || processInduction(node)) return;
   node->base()->accept(this, lvl);
   node->index()->accept(this, lvl);
 
-  _pf.INT(node->type()->size());
-  _pf.MUL();   
+  // cells whose size is a power of two are reached by shifting
+  unsigned size = node->type()->size();
+  if (std::has_single_bit(size)) {
+    _pf.INT(std::countr_zero(size));
+    _pf.SHTL();
+  } else {
+    _pf.INT(size);
+    _pf.MUL();
+  }
   _pf.ADD(); 
 }
\ No newline at end of file
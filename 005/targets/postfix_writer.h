@@ -4,7 +4,15 @@
 
 #include <sstream>
 #include <stack>
-#include <cdk/emitters/basic_postfix_emitter.h>
+#include "targets/postfix_peephole.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/invariants.h"
+#include "targets/inductions.h"
+#include "targets/fusions.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
 #include <set>
 
 namespace udf {
@@ -13,24 +21,33 @@ namespace udf {
   //! Traverse syntax tree and generate the corresponding assembly code.
   //!
   class postfix_writer: public basic_ast_visitor {
-    cdk::symbol_table<udf::symbol> &_symtab;
-    cdk::basic_postfix_emitter &_pf;
+    udf::symbol_table &_symtab;
+    udf::postfix_peephole &_pf;
+    const udf::constants &_constants;
+    const udf::dead_code &_dead;
+    const udf::invariants &_invariants;
+    const udf::inductions &_inductions;
+    const udf::fusions &_fusions;
     int _lbl;
 
     bool _inFunctionBody = false, _inFunctionArgs = false;
     bool _inForInit;
-    bool _returnSeen;
     std::stack<int> _forIni, _forStep, _forEnd;
     std::shared_ptr<udf::symbol> _function;
     std::string _currentBodyRetLabel;
     std::set<std::string> _functions_to_declare;
     int _offset;
     bool _memInitialized = false;
+    std::unordered_map<const cdk::basic_node*, int> _hoisted; // frame slot of each invariant
+    std::unordered_map<const cdk::basic_node*, int> _running; // frame slot of each strength-reduced indexing
+    std::unordered_map<const cdk::basic_node*, std::vector<std::pair<int, int>>> _steps; // slots (and bytes) each increment moves
+    std::map<std::vector<std::uint64_t>, std::string> _literals; // label of each distinct set of known cells
 
   public:
-    postfix_writer(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<udf::symbol> &symtab,
-                   cdk::basic_postfix_emitter &pf) :
-        basic_ast_visitor(compiler), _symtab(symtab), _pf(pf), _lbl(0), _inFunctionBody(false), _inForInit(false) {
+    postfix_writer(std::shared_ptr<cdk::compiler> compiler, udf::symbol_table &symtab,
+                   udf::postfix_peephole &pf, const udf::constants &constants, const udf::dead_code &dead,
+                   const udf::invariants &invariants, const udf::inductions &inductions, const udf::fusions &fusions) :
+        basic_ast_visitor(compiler), _symtab(symtab), _pf(pf), _constants(constants), _dead(dead), _invariants(invariants), _inductions(inductions), _fusions(fusions), _lbl(0), _inFunctionBody(false), _inForInit(false) {
     }
 
   public:
@@ -39,6 +56,16 @@ namespace udf {
     }
   protected:
   void processCompares(cdk::binary_operation_node *const node, int lvl);
+  void processEquality(cdk::binary_operation_node *const node, int lvl);
+  void processCondition(cdk::expression_node *const node, const std::string &lbl, bool when, int lvl);
+  void processLogical(cdk::expression_node *const node, int lvl);
+  bool processConstant(cdk::expression_node *const node);
+  bool processInvariant(cdk::typed_node *const node);
+  bool processInduction(cdk::typed_node *const node);
+  bool processShifts(cdk::binary_operation_node *const node, int lvl);
+  bool processShiftsAndAdd(cdk::expression_node *const operand, int factor, int lvl);
+  bool processFusion(cdk::expression_node *const node, int lvl);
+  std::string literal(udf::tensor_node *const node);
   
   private:
     /** Method used to generate sequential labels. */
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <string>
+#include "targets/register_allocator.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+namespace {
+
+  // callee-saved: they survive the calls without being saved by the caller
+  const std::vector<std::string> integer_registers = { "rbx", "r12", "r13", "r14", "r15" };
+  // no xmm register is callee-saved: the caller saves those live at each call
+  const std::vector<std::string> real_registers = { "xmm8", "xmm9", "xmm10", "xmm11",
+                                                    "xmm12", "xmm13", "xmm14", "xmm15" };
+
+  bool fits_register(udf::variable_declaration_node *const node) {
+    return node->is_typed(cdk::TYPE_INT) || node->is_typed(cdk::TYPE_DOUBLE) || node->is_typed(cdk::TYPE_POINTER) ||
+           node->is_typed(cdk::TYPE_STRING) || node->is_typed(cdk::TYPE_TENSOR);
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::allocate(cdk::basic_node *const node) {
+  if (node == nullptr) return;
+  node->accept(this, 0);
+}
+
+std::vector<std::string> udf::register_allocator::live_reals(const udf::function_definition_node *node,
+                                                             int position) const {
+  std::vector<std::string> live;
+  auto it = _functions.find(node);
+  if (it == _functions.end()) return live;
+  for (auto &[interval, name] : it->second.reals)
+    if ((position < 0 || interval.contains(position)) && std::find(live.begin(), live.end(), name) == live.end())
+      live.push_back(name);
+  return live;
+}
+
+const std::vector<std::string> &udf::register_allocator::saved(const udf::function_definition_node *node) const {
+  static const std::vector<std::string> none;
+  auto it = _functions.find(node);
+  return it == _functions.end() ? none : it->second.saved;
+}
+
+/** Local variables and arguments live from their declaration on. */
+void udf::register_allocator::declare(udf::variable_declaration_node *const node, int start) {
+  if (!_inFunction || _usage.of(node).escapes || !fits_register(node)) return;
+  _intervals[node] = { start, start };
+  _candidates.push_back(node);
+}
+
+/** Linear scan over the intervals of the function, one pool at a time. */
+void udf::register_allocator::scan(udf::function_definition_node *const node) {
+  std::stable_sort(_candidates.begin(), _candidates.end(), [this](auto a, auto b) {
+    return _intervals[a].start < _intervals[b].start;
+  });
+
+  auto &info = _functions[node];
+  for (bool real : { false, true }) {
+    const auto &pool = real ? real_registers : integer_registers;
+    std::vector<std::string> available(pool.rbegin(), pool.rend());
+    std::vector<const udf::variable_declaration_node*> active;
+
+    for (auto variable : _candidates) {
+      if (variable->is_typed(cdk::TYPE_DOUBLE) != real) continue;
+      const auto &current = _intervals[variable];
+
+      // intervals that ended before this one give their registers back
+      std::erase_if(active, [&](auto other) {
+        if (_intervals[other].end >= current.start) return false;
+        available.push_back(_registers[other]);
+        return true;
+      });
+
+      if (!available.empty()) {
+        _registers[variable] = available.back();
+        available.pop_back();
+        active.push_back(variable);
+        continue;
+      }
+
+      // no register left: the interval that lasts longer stays in memory
+      auto longest = std::max_element(active.begin(), active.end(), [this](auto a, auto b) {
+        return _intervals[a].end < _intervals[b].end;
+      });
+      if (longest != active.end() && _intervals[*longest].end > current.end) {
+        _registers[variable] = _registers[*longest];
+        _registers.erase(*longest);
+        *longest = variable;
+      }
+    }
+  }
+
+  for (auto variable : _candidates) {
+    auto name = register_of(variable);
+    if (name == nullptr) continue;
+    if (variable->is_typed(cdk::TYPE_DOUBLE))
+      info.reals.emplace_back(_intervals[variable], *name);
+    else if (std::find(info.saved.begin(), info.saved.end(), *name) == info.saved.end())
+      info.saved.push_back(*name);
+  }
+  _candidates.clear();
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_input_node(udf::input_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::register_allocator::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    visit(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::register_allocator::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::register_allocator::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::register_allocator::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_add_node(cdk::add_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_sub_node(cdk::sub_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_mul_node(cdk::mul_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_div_node(cdk::div_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_mod_node(cdk::mod_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::register_allocator::do_eq_node(cdk::eq_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_variable_node(cdk::variable_node *const node, int lvl) {
+  auto variable = _usage.declaration(node);
+  auto it = _intervals.find(variable);
+  if (it == _intervals.end()) return;
+  it->second.end = std::max(it->second.end, _position);
+  for (auto &cycle : _cycles)
+    cycle.push_back(variable);
+}
+
+void udf::register_allocator::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::register_allocator::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::register_allocator::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::register_allocator::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::register_allocator::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  statement(node);
+  visit(node->argument(), lvl + 2);
+}
+
+void udf::register_allocator::do_write_node(udf::write_node *const node, int lvl) {
+  statement(node);
+  visit(node->args(), lvl + 2);
+}
+
+void udf::register_allocator::do_return_node(udf::return_node *const node, int lvl) {
+  statement(node);
+  visit(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::register_allocator::do_if_node(udf::if_node *const node, int lvl) {
+  statement(node);
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::register_allocator::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  statement(node);
+  visit(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void udf::register_allocator::do_for_node(udf::for_node *const node, int lvl) {
+  // every expression of the header is a statement of its own
+  auto statements = [&](cdk::sequence_node *const sequence) {
+    for (auto n : sequence->nodes()) {
+      if (!dynamic_cast<udf::variable_declaration_node*>(n)) statement(n);
+      visit(n, lvl + 2);
+    }
+  };
+
+  statements(node->init());
+
+  // variables declared before the cycle and used in it stay live until its end
+  const int first = _position + 1;
+  _cycles.emplace_back();
+  statements(node->condition());
+  visit(node->instruction(), lvl + 2);
+  statements(node->increment());
+  for (auto variable : _cycles.back()) {
+    auto &interval = _intervals[variable];
+    if (interval.start < first) interval.end = std::max(interval.end, _position);
+  }
+  _cycles.pop_back();
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  if (!_inFunction) return;
+  statement(node);
+  visit(node->initializer(), lvl + 2);
+  declare(node, _position);
+}
+
+void udf::register_allocator::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  _inFunction = true;
+  statement(node);
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    declare(dynamic_cast<udf::variable_declaration_node*>(node->argument(ax)), _position);
+  visit(node->block(), lvl + 2);
+  scan(node);
+  _inFunction = false;
+}
+
+void udf::register_allocator::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::register_allocator::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  visit(node->cell_values(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor1(), lvl + 2);
+  visit(node->tensor2(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->indices(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::register_allocator::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->new_dims(), lvl + 2);
+}
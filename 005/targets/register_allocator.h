@@ -0,0 +1,93 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/variable_usage.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace udf {
+
+  /**
+   * Choose machine registers for the locals and arguments of each function
+   * whose address is never taken. Liveness is computed per function body,
+   * at statement granularity: every statement gets a position and every
+   * variable the interval of positions from its declaration to its last
+   * use (to the end of any cycle that uses it, if declared before the
+   * cycle). Intervals are then allocated by linear scan, integers and
+   * pointers to callee-saved registers and reals to xmm8-xmm15, which the
+   * code generator saves around calls while the variable is live.
+   */
+  class register_allocator: public basic_ast_visitor {
+  public:
+    struct interval {
+      int start, end; // both included
+      bool contains(int position) const {
+        return start <= position && position <= end;
+      }
+    };
+
+  private:
+    struct function {
+      std::vector<std::pair<interval, std::string>> reals; // allocated to xmm registers
+      std::vector<std::string> saved;                       // callee-saved registers used
+    };
+
+    const udf::variable_usage &_usage;
+    std::unordered_map<const cdk::basic_node*, int> _positions;
+    std::unordered_map<const udf::variable_declaration_node*, interval> _intervals;
+    std::unordered_map<const udf::variable_declaration_node*, std::string> _registers;
+    std::unordered_map<const udf::function_definition_node*, function> _functions;
+    std::vector<udf::variable_declaration_node*> _candidates; // of the current function
+    std::vector<std::vector<const udf::variable_declaration_node*>> _cycles; // variables used in each enclosing cycle
+    int _position = 0;
+    bool _inFunction = false;
+
+  public:
+    register_allocator(std::shared_ptr<cdk::compiler> compiler, const udf::variable_usage &usage) :
+        basic_ast_visitor(compiler), _usage(usage) {
+    }
+
+  public:
+    /** Allocate registers for every function of the program. */
+    void allocate(cdk::basic_node *const node);
+
+    /** Position of a statement (-1 if it has none). */
+    int position(const cdk::basic_node *node) const {
+      auto it = _positions.find(node);
+      return it == _positions.end() ? -1 : it->second;
+    }
+
+    /** Register holding a variable (nullptr if kept in memory). */
+    const std::string *register_of(const udf::variable_declaration_node *node) const {
+      auto it = _registers.find(node);
+      return it == _registers.end() ? nullptr : &it->second;
+    }
+
+    /** The xmm registers holding variables live at a position (all of them if unknown). */
+    std::vector<std::string> live_reals(const udf::function_definition_node *node, int position) const;
+
+    /** The callee-saved registers a function uses. */
+    const std::vector<std::string> &saved(const udf::function_definition_node *node) const;
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node != nullptr) node->accept(this, lvl);
+    }
+    void statement(cdk::basic_node *const node) {
+      _positions[node] = ++_position;
+    }
+    void declare(udf::variable_declaration_node *const node, int start);
+    void scan(udf::function_definition_node *const node);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
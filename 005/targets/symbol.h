@@ -4,11 +4,12 @@
 #include <memory>
 #include <cdk/types/basic_type.h>
 #include <cdk/types/reference_type.h>
+#include "identifier.h"
 
 namespace udf {
 
   class symbol {
-    std::string _name; // identifier
+    udf::identifier _name; // interned identifier
     int _value;
 
     int _qualifier; // qualifiers: public, forward, "private" (i.e., none)
@@ -36,6 +37,9 @@ namespace udf {
       return _type->name() == name;
     }
     const std::string &name() const {
+      return _name.str();
+    }
+    const udf::identifier &id() const {
       return _name;
     }
     long value() const {
@@ -106,4 +110,9 @@ namespace udf {
     return std::make_shared<symbol>(qualifier, type, name, initialized, function, forward);
   }
 
+  /** The entry point "udf" is known to the runtime as "_main". */
+  inline std::string function_name(const std::string &identifier) {
+    return identifier == "udf" ? "_main" : identifier;
+  }
+
 } // udf
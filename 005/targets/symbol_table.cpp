@@ -0,0 +1,49 @@
+#include "targets/symbol_table.h"
+
+//---------------------------------------------------------------------------
+
+void udf::symbol_table::pop() {
+  if (_scopes.empty()) return; // the global scope is never closed
+  std::size_t height = _scopes.back();
+  _scopes.pop_back();
+
+  // restore the definitions shadowed by the closing scope
+  while (_records.size() > height) {
+    auto &r = _records.back();
+    _slots[locate(r.name)].top = r.shadowed;
+    _records.pop_back();
+  }
+}
+
+bool udf::symbol_table::insert(const udf::identifier &name, std::shared_ptr<udf::symbol> symbol) {
+  slot &s = claim(&name.str());
+  if (s.top >= 0 && _records[s.top].scope == depth()) return false;
+
+  _records.push_back({ s.name, symbol, s.top, depth() });
+  s.top = _records.size() - 1;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+udf::symbol_table::slot &udf::symbol_table::claim(const std::string *name) {
+  // names are never removed from the hash, so it only grows with the
+  // number of distinct names: keep it at most half full
+  if (2 * (_used + 1) > _slots.size()) grow();
+
+  slot &s = _slots[locate(name)];
+  if (s.name == nullptr) {
+    s.name = name;
+    _used++;
+  }
+  return s;
+}
+
+void udf::symbol_table::grow() {
+  std::vector<slot> old(2 * _slots.size());
+  old.swap(_slots);
+  for (const auto &s : old) {
+    if (s.name == nullptr) continue;
+    _slots[locate(s.name)] = s;
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "identifier.h"
+#include "targets/symbol.h"
+
+namespace udf {
+
+  /**
+   * Flat scoped symbol table. An open-addressing hash maps each interned
+   * name to the innermost of its definitions; definitions are kept in a
+   * single stack, each one linked to the definition it shadows. Opening a
+   * scope just records the stack height; closing it unwinds the records
+   * added since then.
+   */
+  class symbol_table {
+    struct record {
+      const std::string *name;
+      std::shared_ptr<udf::symbol> symbol;
+      std::int32_t shadowed; // previous definition of the same name (-1 if none)
+      std::uint32_t scope;   // depth of the scope that defined it
+    };
+
+    struct slot {
+      const std::string *name = nullptr; // nullptr marks an empty slot
+      std::int32_t top = -1;             // innermost definition (-1 if none)
+    };
+
+    std::vector<slot> _slots;
+    std::size_t _used = 0;               // slots with a name
+    std::vector<record> _records;
+    std::vector<std::size_t> _scopes;    // stack height when each scope was opened
+
+  public:
+    symbol_table() :
+        _slots(64) {
+    }
+
+  public:
+    void push() {
+      _scopes.push_back(_records.size());
+    }
+
+    void pop();
+
+    /** Insert in the current scope: fails if the name is already defined there. */
+    bool insert(const udf::identifier &name, std::shared_ptr<udf::symbol> symbol);
+
+    /** Replace the innermost definition of the name: fails if there is none. */
+    bool replace(const udf::identifier &name, std::shared_ptr<udf::symbol> symbol) {
+      auto top = lookup(&name.str()).top;
+      if (top < 0) return false;
+      _records[top].symbol = symbol;
+      return true;
+    }
+
+    std::shared_ptr<udf::symbol> find_local(const udf::identifier &name) const {
+      auto top = lookup(&name.str()).top;
+      return top >= 0 && _records[top].scope == depth() ? _records[top].symbol : nullptr;
+    }
+
+    std::shared_ptr<udf::symbol> find(const udf::identifier &name) const {
+      auto top = lookup(&name.str()).top;
+      return top >= 0 ? _records[top].symbol : nullptr;
+    }
+
+  private:
+    std::uint32_t depth() const {
+      return _scopes.size();
+    }
+
+    std::size_t position(const std::string *name) const {
+      // interned names are aligned pointers: mix the bits before masking
+      auto h = reinterpret_cast<std::uintptr_t>(name) * 0x9E3779B97F4A7C15ull;
+      return (h >> 32) & (_slots.size() - 1);
+    }
+
+    /** Index of the name's slot, or of the empty slot where it would go. */
+    std::size_t locate(const std::string *name) const {
+      auto ix = position(name);
+      while (_slots[ix].name != nullptr && _slots[ix].name != name)
+        ix = (ix + 1) & (_slots.size() - 1);
+      return ix;
+    }
+
+    const slot &lookup(const std::string *name) const {
+      return _slots[locate(name)];
+    }
+
+    slot &claim(const std::string *name);
+    void grow();
+  };
+
+} // udf
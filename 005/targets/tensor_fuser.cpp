@@ -0,0 +1,336 @@
+#include <string>
+#include "targets/tensor_fuser.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::fuse(cdk::basic_node *const node) {
+  visit(node, 0);
+}
+
+/** Whether the expression computes each cell of a tensor from the same cell of its operands. */
+bool udf::tensor_fuser::elementwise(cdk::expression_node *const node) {
+  if (!node->is_typed(cdk::TYPE_TENSOR)) return false;
+  return dynamic_cast<cdk::add_node*>(node) || dynamic_cast<cdk::sub_node*>(node) ||
+         dynamic_cast<cdk::mul_node*>(node) || dynamic_cast<cdk::div_node*>(node) ||
+         dynamic_cast<cdk::unary_minus_node*>(node) || dynamic_cast<cdk::unary_plus_node*>(node);
+}
+
+/** Whether the expression is a tensor literal whose cells are all known. */
+bool udf::tensor_fuser::constant(cdk::expression_node *const node) const {
+  auto literal = dynamic_cast<udf::tensor_node*>(node);
+  if (literal == nullptr) return false;
+  for (auto cell : literal->cell_values()->nodes())
+    if (_constants.find(cell) == nullptr) return false;
+  return true;
+}
+
+/**
+ * Passes over memory the code generator makes for an elementwise tree
+ * without a kernel: one runtime call per operator (more for some), one
+ * copy per known literal.
+ */
+size_t udf::tensor_fuser::calls(cdk::expression_node *const node) const {
+  if (constant(node)) return 1;
+  if (!elementwise(node)) return 0;
+  if (auto plus = dynamic_cast<cdk::unary_plus_node*>(node)) return calls(plus->argument());
+  if (auto minus = dynamic_cast<cdk::unary_minus_node*>(node)) return 1 + calls(minus->argument());
+
+  auto binary = dynamic_cast<cdk::binary_operation_node*>(node);
+  size_t own = 1;
+  if (!binary->left()->is_typed(cdk::TYPE_TENSOR)) {
+    if (dynamic_cast<cdk::sub_node*>(node)) own = 2;      // negation, then addition
+    else if (dynamic_cast<cdk::div_node*>(node)) own = 3; // ones, division, then product
+  }
+  return own + calls(binary->left()) + calls(binary->right());
+}
+
+/** Append the program computing a cell of the expression (operands become loads). */
+void udf::tensor_fuser::flatten(cdk::expression_node *const node, udf::fusions::kernel &k) const {
+  using op = udf::fusions::operation;
+  if (constant(node)) {
+    k.steps.push_back({ op::literal, k.literals.size() });
+    k.literals.push_back(dynamic_cast<udf::tensor_node*>(node));
+  } else if (!elementwise(node)) {
+    k.steps.push_back({ op::load, k.operands.size() });
+    k.operands.push_back(node);
+  } else if (auto plus = dynamic_cast<cdk::unary_plus_node*>(node)) {
+    flatten(plus->argument(), k);
+  } else if (auto minus = dynamic_cast<cdk::unary_minus_node*>(node)) {
+    flatten(minus->argument(), k);
+    k.steps.push_back({ op::neg, 0 });
+  } else {
+    auto binary = dynamic_cast<cdk::binary_operation_node*>(node);
+    flatten(binary->left(), k);
+    flatten(binary->right(), k);
+    if (dynamic_cast<cdk::add_node*>(node)) k.steps.push_back({ op::add, 0 });
+    else if (dynamic_cast<cdk::sub_node*>(node)) k.steps.push_back({ op::sub, 0 });
+    else if (dynamic_cast<cdk::mul_node*>(node)) k.steps.push_back({ op::mul, 0 });
+    else k.steps.push_back({ op::div, 0 });
+  }
+}
+
+/** Record the kernel computing the expression; its operands are searched in turn. */
+void udf::tensor_fuser::kernel(cdk::expression_node *const node, int lvl) {
+  udf::fusions::kernel k;
+  k.cells = 1;
+  for (auto dim : cdk::tensor_type::cast(node->type())->dims())
+    k.cells *= dim;
+  flatten(node, k);
+  _fusions.fuse(_function, node, k);
+  for (auto operand : k.operands)
+    visit(operand, lvl + 2);
+}
+
+/** An arithmetic operation: the root of a kernel, or searched like any other expression. */
+void udf::tensor_fuser::operation(cdk::expression_node *const node, int lvl) {
+  if (_function != nullptr && elementwise(node) && calls(node) > 1) {
+    kernel(node, lvl);
+  } else if (auto unary = dynamic_cast<cdk::unary_operation_node*>(node)) {
+    visit(unary->argument(), lvl + 2);
+  } else if (auto binary = dynamic_cast<cdk::binary_operation_node*>(node)) {
+    visit(binary->left(), lvl + 2);
+    visit(binary->right(), lvl + 2);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_variable_node(cdk::variable_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::tensor_fuser::do_input_node(udf::input_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    if (!_dead.skipped(n)) visit(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::tensor_fuser::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_add_node(cdk::add_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_sub_node(cdk::sub_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_mul_node(cdk::mul_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_div_node(cdk::div_node *const node, int lvl) {
+  operation(node, lvl);
+}
+void udf::tensor_fuser::do_mod_node(cdk::mod_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::tensor_fuser::do_eq_node(cdk::eq_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  // only the size of tensors is computed (and their expression evaluated)
+  if (node->expression()->is_typed(cdk::TYPE_TENSOR)) visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_write_node(udf::write_node *const node, int lvl) {
+  visit(node->args(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_return_node(udf::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_block_node(udf::block_node *const node, int lvl) {
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_if_node(udf::if_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    // only the live branch is generated
+    if (udf::is_true(*condition)) visit(node->block(), lvl + 2);
+    return;
+  }
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  if (auto condition = _constants.find(node->condition())) {
+    visit(udf::is_true(*condition) ? node->thenblock() : node->elseblock(), lvl + 2);
+    return;
+  }
+  visit(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_for_node(udf::for_node *const node, int lvl) {
+  visit(node->init(), lvl + 2);
+  visit(node->condition(), lvl + 2);
+  visit(node->instruction(), lvl + 2);
+  visit(node->increment(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  if (!_dead.dropped(node) || (node->initializer() != nullptr && !_dead.skipped(node->initializer())))
+    visit(node->initializer(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  _function = node;
+  visit(node->block(), lvl + 2);
+  _function = nullptr;
+}
+
+void udf::tensor_fuser::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::tensor_fuser::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->index(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->indices(), lvl + 2);
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  // known cells are copied, not put one by one
+  if (_function != nullptr && constant(node))
+    kernel(node, lvl);
+  else
+    visit(node->cell_values(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor1(), lvl + 2);
+  visit(node->tensor2(), lvl + 2);
+}
+
+void udf::tensor_fuser::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->new_dims(), lvl + 2);
+}
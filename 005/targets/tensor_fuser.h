@@ -0,0 +1,57 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/fusions.h"
+
+namespace udf {
+
+  /**
+   * Find the elementwise tensor expressions worth a kernel of their own
+   * (see fusions): trees of tensor additions, subtractions, products,
+   * divisions and negations, whose leaves are any other tensor or scalar
+   * expressions, that would otherwise take more than one runtime call.
+   * Tensor literals whose cells are all known count as one: they are read
+   * in place, or copied if alone. Only the largest tree is fused; the
+   * leaves are searched in turn.
+   */
+  class tensor_fuser: public basic_ast_visitor {
+    const udf::constants &_constants;
+    const udf::dead_code &_dead;
+    udf::fusions &_fusions;
+
+    const udf::function_definition_node *_function = nullptr; // being analysed
+
+  public:
+    tensor_fuser(std::shared_ptr<cdk::compiler> compiler, const udf::constants &constants, const udf::dead_code &dead,
+                 udf::fusions &fusions) :
+        basic_ast_visitor(compiler), _constants(constants), _dead(dead), _fusions(fusions) {
+    }
+
+  public:
+    /** Analyse the whole program. */
+    void fuse(cdk::basic_node *const node);
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      // a known value is not computed at all
+      if (node != nullptr && _constants.find(node) == nullptr) node->accept(this, lvl);
+    }
+    static bool elementwise(cdk::expression_node *const node);
+    bool constant(cdk::expression_node *const node) const;
+    size_t calls(cdk::expression_node *const node) const;
+    void flatten(cdk::expression_node *const node, udf::fusions::kernel &k) const;
+    void kernel(cdk::expression_node *const node, int lvl);
+    void operation(cdk::expression_node *const node, int lvl);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
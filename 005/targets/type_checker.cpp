@@ -2,6 +2,7 @@
 #include "targets/type_checker.h"
 #include ".auto/all_nodes.h"
 #include <cdk/types/primitive_type.h>
+#include "type_cache.h"
 
 #include "udf_parser.tab.h"
 
@@ -21,6 +22,27 @@ bool udf::type_checker::checkPointers(std::shared_ptr<cdk::basic_type> t1, std::
 
 //---------------------------------------------------------------------------
 
+void udf::type_checker::check(cdk::basic_node *const node, int lvl) {
+  if (node == nullptr) return;
+  if (auto sequence = dynamic_cast<cdk::sequence_node*>(node)) {
+    for (auto n : sequence->nodes())
+      check(n, lvl);
+    return;
+  }
+
+  // problems are reported per declaration/instruction, so that checking
+  // can go on with the next one
+  try {
+    node->accept(this, lvl);
+  }
+  catch (const std::string &problem) {
+    std::cerr << node->lineno() << ": " << problem << std::endl;
+    _errors++;
+  }
+}
+
+//---------------------------------------------------------------------------
+
 void udf::type_checker::do_sequence_node(cdk::sequence_node *const node, int lvl) {
   for (auto n : node->nodes())
     n->accept(this, lvl);
@@ -39,17 +61,17 @@ void udf::type_checker::do_data_node(cdk::data_node *const node, int lvl) {
 
 void udf::type_checker::do_integer_node(cdk::integer_node *const node, int lvl) {
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::do_double_node(cdk::double_node *const node, int lvl) {
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+  node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
 }
 
 void udf::type_checker::do_string_node(cdk::string_node *const node, int lvl) {
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+  node->type(udf::types::primitive(4, cdk::TYPE_STRING));
 }
 
 //---------------------------------------------------------------------------
@@ -75,7 +97,7 @@ void udf::type_checker::processLogicalBinaryExpression(cdk::binary_operation_nod
     throw std::string("integer expression expected in logical binary expression");
   }
 
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::do_and_node(cdk::and_node *const node, int lvl) {
@@ -90,12 +112,11 @@ void udf::type_checker::do_or_node(cdk::or_node *const node, int lvl) {
 void udf::type_checker::processUnaryExpression(cdk::unary_operation_node *const node, int lvl) {
   node->argument()->accept(this, lvl + 2);
   if (node->argument()->is_typed(cdk::TYPE_INT))
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(udf::types::primitive(4, cdk::TYPE_INT));
   else if (node->argument()->is_typed(cdk::TYPE_DOUBLE))
-    node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+    node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
   else if (node->argument()->is_typed(cdk::TYPE_TENSOR)) {
-    auto tensor = cdk::tensor_type::cast(node->argument()->type());
-    node->type(cdk::tensor_type::create(tensor->dims()));
+    node->type(node->argument()->type());
   }
   else
     throw std::string("wrong type in unary expression");
@@ -118,33 +139,26 @@ void udf::type_checker::processIRTBinaryExpression(cdk::binary_operation_node *c
 
   if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
     // check if tensors have the same dimensions 
-    auto t1_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->left()->type());
-    auto t2_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->right()->type());
-    const auto &dims1 = t1_type->dims();
-    const auto &dims2 = t2_type->dims();
-    if (dims1 != dims2) {
+    if (node->left()->type() != node->right()->type()) {
       throw std::string("tensors in multiplication/division must have the same dimensions");
     }
-    auto tensor = cdk::tensor_type::cast(node->left()->type());
-    node->type(cdk::tensor_type::create(tensor->dims()));
+    node->type(node->left()->type());
   }
   else if ((node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_INT)) ||
            (node->right()->is_typed(cdk::TYPE_TENSOR) && node->left()->is_typed(cdk::TYPE_INT)) ||
            (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_DOUBLE)) ||
            (node->right()->is_typed(cdk::TYPE_TENSOR) && node->left()->is_typed(cdk::TYPE_DOUBLE))) {
 
-    auto tensor = node->left()->is_typed(cdk::TYPE_TENSOR) ? 
-      cdk::tensor_type::cast(node->left()->type()) : cdk::tensor_type::cast(node->right()->type());
-    node->type(cdk::tensor_type::create(tensor->dims()));
+    node->type(node->left()->is_typed(cdk::TYPE_TENSOR) ? node->left()->type() : node->right()->type());
   }
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_DOUBLE)) {
     if (node->left()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_DOUBLE)
         || node->right()->is_typed(cdk::TYPE_INT) || node->left()->is_typed(cdk::TYPE_INT))
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
   }
 
   else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_INT))
-    node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->type(udf::types::primitive(4, cdk::TYPE_INT));
 
   else
     throw std::string("wrong type in IRT binary expression");
@@ -160,7 +174,7 @@ void udf::type_checker::processIRBinaryExpression(cdk::binary_operation_node *co
   if (!node->right()->is_typed(cdk::TYPE_INT) && !node->right()->is_typed(cdk::TYPE_DOUBLE)) 
     throw std::string("wrong type in right argument of IR binary expression");
   
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::processIBinaryExpression(cdk::binary_operation_node *const node, int lvl) {
@@ -173,13 +187,13 @@ void udf::type_checker::processIBinaryExpression(cdk::binary_operation_node *con
   if (!node->right()->is_typed(cdk::TYPE_INT)) 
     throw std::string("wrong type in right argument of I binary expression");
 
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::processBinaryComparativeExpression(cdk::binary_operation_node *const node, int lvl) {
   ASSERT_UNSPEC;
   processIRBinaryExpression(node, lvl);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::processBinaryEqualityExpression(cdk::binary_operation_node *const node, int lvl) {
@@ -194,7 +208,7 @@ void udf::type_checker::processBinaryEqualityExpression(cdk::binary_operation_no
   if (!checkPointers(node->left()->type(), node->right()->type())) {
     throw std::string("arguments of equality expression must be of the same type");
   }
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::processBinaryAddSubExpression(cdk::binary_operation_node *const node, int lvl, bool subtraction) {
@@ -210,49 +224,42 @@ void udf::type_checker::processBinaryAddSubExpression(cdk::binary_operation_node
     node->type(node->right()->type());
   } 
   else if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
-    auto t1_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->left()->type());
-    auto t2_type = std::dynamic_pointer_cast<cdk::tensor_type>(node->right()->type());
-    const auto &dims1 = t1_type->dims();
-    const auto &dims2 = t2_type->dims();
-    if (dims1 != dims2) {
+    if (node->left()->type() != node->right()->type()) {
       throw std::string("tensors in addition/subtraction must have the same dimensions");
     }
-    auto tensor = cdk::tensor_type::cast(node->left()->type());
-    node->type(cdk::tensor_type::create(tensor->dims()));
+    node->type(node->left()->type());
   }
   else if ((node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_INT)) ||
            (node->right()->is_typed(cdk::TYPE_TENSOR) && node->left()->is_typed(cdk::TYPE_INT)) ||
            (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_DOUBLE)) ||
            (node->right()->is_typed(cdk::TYPE_TENSOR) && node->left()->is_typed(cdk::TYPE_DOUBLE))) {
-    auto tensor = node->left()->is_typed(cdk::TYPE_TENSOR) ? 
-      cdk::tensor_type::cast(node->left()->type()) : cdk::tensor_type::cast(node->right()->type());
-    node->type(cdk::tensor_type::create(tensor->dims()));
+    node->type(node->left()->is_typed(cdk::TYPE_TENSOR) ? node->left()->type() : node->right()->type());
   }
   else if (node->left()->is_typed(cdk::TYPE_INT) || node->left()->is_typed(cdk::TYPE_UNSPEC)) {
     if (node->right()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(udf::types::primitive(4, cdk::TYPE_INT));
       return;
     }
     else if (node->right()->is_typed(cdk::TYPE_DOUBLE)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
       return;
     }
     else if (node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-      node->left()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-      node->right()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(udf::types::primitive(4, cdk::TYPE_INT));
+      node->left()->type(udf::types::primitive(4, cdk::TYPE_INT));
+      node->right()->type(udf::types::primitive(4, cdk::TYPE_INT));
       return;
     }
   } 
   else if (node->left()->is_typed(cdk::TYPE_DOUBLE)) {
     
     if (node->right()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
       return;
     }
     else if (node->right()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-      node->right()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
+      node->right()->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
       return;
     }
   }
@@ -261,7 +268,7 @@ void udf::type_checker::processBinaryAddSubExpression(cdk::binary_operation_node
       if ((node->left()->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_POINTER)) &&
           (checkPointers(node->left()->type(), node->right()->type()))) {
         
-            node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+            node->type(udf::types::primitive(4, cdk::TYPE_INT));
             return;
       }
     }
@@ -310,13 +317,13 @@ void udf::type_checker::do_eq_node(cdk::eq_node *const node, int lvl) {
 void udf::type_checker::do_variable_node(cdk::variable_node *const node, int lvl) {
   
   ASSERT_UNSPEC;
-  const std::string &id = node->name();
+  const udf::identifier id = udf::name_of(node);
   std::shared_ptr<udf::symbol> symbol = _symtab.find(id);
 
   if (symbol != nullptr) {
     node->type(symbol->type());
   } else {
-    throw id;
+    throw id.str();
   }
 }
 
@@ -349,11 +356,11 @@ void udf::type_checker::do_assignment_node(cdk::assignment_node *const node, int
 
   if (node->lvalue()->is_typed(cdk::TYPE_INT)) {
     if (node->rvalue()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(udf::types::primitive(4, cdk::TYPE_INT));
     }
     else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
-      node->rvalue()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      node->type(udf::types::primitive(4, cdk::TYPE_INT));
+      node->rvalue()->type(udf::types::primitive(4, cdk::TYPE_INT));
     }
     else {
       throw std::string("wrong assignment to integer");
@@ -364,14 +371,14 @@ void udf::type_checker::do_assignment_node(cdk::assignment_node *const node, int
       node->type(node->rvalue()->type());
     } 
     else if (node->rvalue()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_POINTER));
+      node->type(udf::types::primitive(4, cdk::TYPE_POINTER));
     }
     else if (node->rvalue()->is_typed(cdk::TYPE_DOUBLE)) {
-      node->type(cdk::primitive_type::create(1, cdk::TYPE_VOID));
+      node->type(udf::types::primitive(1, cdk::TYPE_VOID));
     } 
     else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_ERROR));
-      node->rvalue()->type(cdk::primitive_type::create(4, cdk::TYPE_ERROR));
+      node->type(udf::types::primitive(4, cdk::TYPE_ERROR));
+      node->rvalue()->type(udf::types::primitive(4, cdk::TYPE_ERROR));
     } 
     else {
       throw std::string("wrong assignment to pointer");
@@ -380,10 +387,10 @@ void udf::type_checker::do_assignment_node(cdk::assignment_node *const node, int
   else if (node->lvalue()->is_typed(cdk::TYPE_DOUBLE)) {
 
     if (node->rvalue()->is_typed(cdk::TYPE_DOUBLE) || node->rvalue()->is_typed(cdk::TYPE_INT)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
     } else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
-      node->rvalue()->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+      node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
+      node->rvalue()->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
     } else {
       throw std::string("wrong assignment to real");
     }
@@ -391,10 +398,10 @@ void udf::type_checker::do_assignment_node(cdk::assignment_node *const node, int
   else if (node->lvalue()->is_typed(cdk::TYPE_STRING)) {
 
     if (node->rvalue()->is_typed(cdk::TYPE_STRING)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+      node->type(udf::types::primitive(4, cdk::TYPE_STRING));
     } else if (node->rvalue()->is_typed(cdk::TYPE_UNSPEC)) {
-      node->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
-      node->rvalue()->type(cdk::primitive_type::create(4, cdk::TYPE_STRING));
+      node->type(udf::types::primitive(4, cdk::TYPE_STRING));
+      node->rvalue()->type(udf::types::primitive(4, cdk::TYPE_STRING));
     } else {
       throw std::string("wrong assignment to string");
     }
@@ -457,13 +464,13 @@ void udf::type_checker::do_for_node(udf::for_node *const node, int lvl) {
 
 void udf::type_checker::do_input_node(udf::input_node *const node, int lvl) {
   ASSERT_UNSPEC;
-  node->type(cdk::primitive_type::create(0, cdk::TYPE_UNSPEC));
+  node->type(udf::types::primitive(0, cdk::TYPE_UNSPEC));
 }
 
 
 void udf::type_checker::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
   ASSERT_UNSPEC;
-  node->type(cdk::reference_type::create(4, nullptr));
+  node->type(udf::types::reference(4, nullptr));
 }
 
 void udf::type_checker::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
@@ -471,13 +478,13 @@ void udf::type_checker::do_stack_alloc_node(udf::stack_alloc_node *const node, i
   node->argument()->accept(this, lvl + 2);
 
   if (node->argument()->is_typed(cdk::TYPE_UNSPEC)) {
-    node->argument()->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+    node->argument()->type(udf::types::primitive(4, cdk::TYPE_INT));
   } 
   else if (!node->argument()->is_typed(cdk::TYPE_INT)) {
     throw std::string("wrong type in argument of unary expression");
   }
 
-  node->type(cdk::reference_type::create(4, cdk::primitive_type::create(1, cdk::TYPE_VOID)));
+  node->type(udf::types::reference(4, udf::types::primitive(1, cdk::TYPE_VOID)));
 }
 
 void udf::type_checker::do_return_node(udf::return_node *const node, int lvl) {
@@ -498,7 +505,7 @@ void udf::type_checker::do_return_node(udf::return_node *const node, int lvl) {
       _inBlockReturnType = node->retval()->type();
     } else {
       if (_inBlockReturnType != node->retval()->type()) {
-        _function->set_type(cdk::primitive_type::create(0, cdk::TYPE_ERROR));  // probably irrelevant
+        _function->set_type(udf::types::primitive(0, cdk::TYPE_ERROR));  // probably irrelevant
         throw std::string("all return statements in a function must return the same type.");
       }
     }
@@ -543,7 +550,7 @@ void udf::type_checker::do_return_node(udf::return_node *const node, int lvl) {
 void udf::type_checker::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
   ASSERT_UNSPEC;
   node->expression()->accept(this, lvl + 2);
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::do_write_node(udf::write_node *const node, int lvl) {
@@ -554,7 +561,7 @@ void udf::type_checker::do_write_node(udf::write_node *const node, int lvl) {
     child->accept(this, lvl);
 
     if (child->is_typed(cdk::TYPE_UNSPEC)) {
-      child->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+      child->type(udf::types::primitive(4, cdk::TYPE_INT));
     } 
     else if (!child->is_typed(cdk::TYPE_INT) && !child->is_typed(cdk::TYPE_DOUBLE)
           && !child->is_typed(cdk::TYPE_STRING) && !child->is_typed(cdk::TYPE_TENSOR)) {
@@ -564,12 +571,7 @@ void udf::type_checker::do_write_node(udf::write_node *const node, int lvl) {
 }
 
 void udf::type_checker::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
-  std::string id;
-
-  if (node->identifier() == "udf") 
-    id = "_main";
-  else 
-    id = node->identifier();
+  std::string id = udf::function_name(node->identifier());
 
   auto function = udf::make_symbol(node->qualifier(), node->type(), id, false, true, true); 
 
@@ -584,7 +586,6 @@ void udf::type_checker::do_function_declaration_node(udf::function_declaration_n
   }
   else {
     _symtab.insert(function->name(), function);
-    _parent->set_new_symbol(function);  
   }
 }
 
@@ -628,24 +629,20 @@ void udf::type_checker::do_variable_declaration_node(udf::variable_declaration_n
   auto id = node->identifier();
 
   auto symbol = udf::make_symbol(node->qualifier(), node->type(), id, (bool)node->initializer(), false);
-  if (_symtab.insert(id, symbol)) {
-    _parent->set_new_symbol(symbol);
-  } else {
+  if (!_symtab.insert(id, symbol)) {
     throw std::string("variable '" + id + "' redeclared");
   }
 }
 
 void udf::type_checker::do_block_node(udf::block_node *const node, int lvl) {
+  _symtab.push();
+  check(node->declarations(), lvl + 2);
+  check(node->instructions(), lvl + 2);
+  _symtab.pop();
 }
 
 void udf::type_checker::do_function_definition_node(udf::function_definition_node * const node, int lvl) {
-  
-  std::string id;
-
-  if (node->identifier() == "udf")
-    id = "_main";
-  else
-    id = node->identifier();
+  std::string id = udf::function_name(node->identifier());
 
   _inBlockReturnType = nullptr;
 
@@ -660,13 +657,25 @@ void udf::type_checker::do_function_definition_node(udf::function_definition_nod
   if (previous) {
     if (previous->function() && previous->forward()) { 
       _symtab.replace(function->name(), function);
-      _parent->set_new_symbol(function);
     } else {
       throw std::string("conflicting definition for '" + function->name() + "'");
     }
   } else {
     _symtab.insert(function->name(), function);
-    _parent->set_new_symbol(function);
+  }
+
+  _function = function;
+  _symtab.push(); // scope of arguments
+  node->arguments()->accept(this, lvl + 2);
+  node->block()->accept(this, lvl + 2);
+  _symtab.pop();
+  _function = nullptr;
+
+  // auto functions get the type deduced from their return statements
+  if (node->type() == nullptr) {
+    if (function->type() == nullptr)
+      function->set_type(udf::types::primitive(0, cdk::TYPE_VOID));
+    node->type(function->type());
   }
 }
 
@@ -674,7 +683,7 @@ void udf::type_checker::do_function_call_node(udf::function_call_node * const no
   ASSERT_UNSPEC;
 
   const std::string &id = node->identifier();
-  auto symbol = _symtab.find(id);
+  auto symbol = _symtab.find(node->id());
   if (symbol == nullptr) throw std::string("symbol '" + id + "' is undeclared.");
   if (!symbol->function()) throw std::string("symbol '" + id + "' is not a function.");
 
@@ -701,7 +710,7 @@ void udf::type_checker::do_tensor_capacity_node(udf::tensor_capacity_node * cons
   if (!node->tensor()->is_typed(cdk::TYPE_TENSOR)) {
     throw std::string("tensor capacity requires a tensor argument");
   }
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT));
+  node->type(udf::types::primitive(4, cdk::TYPE_INT));
 }
 
 void udf::type_checker::do_tensor_contraction_node(udf::tensor_contraction_node * const node, int lvl) {
@@ -726,8 +735,7 @@ void udf::type_checker::do_tensor_contraction_node(udf::tensor_contraction_node
     throw std::string("tensor contraction requires last dimension of the first tensor to match the first dimension of the second tensor");
   }
 
-  auto tensor = cdk::tensor_type::cast(node->tensor1()->type());
-  node->type(cdk::tensor_type::create(tensor->dims()));
+  node->type(node->tensor1()->type());
 }
 
 void udf::type_checker::do_tensor_dims_node(udf::tensor_dims_node * const node, int lvl) {
@@ -737,7 +745,7 @@ void udf::type_checker::do_tensor_dims_node(udf::tensor_dims_node * const node,
   if (!node->tensor()->is_typed(cdk::TYPE_TENSOR)) {
     throw std::string("tensor dimensions requires a tensor argument");
   }
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_POINTER));
+  node->type(udf::types::primitive(4, cdk::TYPE_POINTER));
 }
 
 void udf::type_checker::do_tensor_dim_node(udf::tensor_dim_node * const node, int lvl) {
@@ -763,7 +771,7 @@ void udf::type_checker::do_tensor_dim_node(udf::tensor_dim_node * const node, in
     }
   }
 
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT)); 
+  node->type(udf::types::primitive(4, cdk::TYPE_INT)); 
 }
 
 void udf::type_checker::do_tensor_index_node(udf::tensor_index_node * const node, int lvl) {
@@ -780,7 +788,7 @@ void udf::type_checker::do_tensor_index_node(udf::tensor_index_node * const node
       throw std::string("integer expected in tensor index");
     } 
   }
-  node->type(cdk::primitive_type::create(8, cdk::TYPE_DOUBLE));
+  node->type(udf::types::primitive(8, cdk::TYPE_DOUBLE));
 }
 
 void udf::type_checker::do_tensor_rank_node(udf::tensor_rank_node * const node, int lvl) {
@@ -790,7 +798,7 @@ void udf::type_checker::do_tensor_rank_node(udf::tensor_rank_node * const node,
   if (!node->tensor()->is_typed(cdk::TYPE_TENSOR)) {
     throw std::string("tensor rank requires a tensor argument");
   }
-  node->type(cdk::primitive_type::create(4, cdk::TYPE_INT)); 
+  node->type(udf::types::primitive(4, cdk::TYPE_INT)); 
 }
 
 void udf::type_checker::do_tensor_reshape_node(udf::tensor_reshape_node * const node, int lvl) {
@@ -827,8 +835,7 @@ void udf::type_checker::do_tensor_reshape_node(udf::tensor_reshape_node * const
     throw std::string("reshape dimensions must match the original tensor capacity");
   }
   
-  auto tensor = cdk::tensor_type::cast(node->tensor()->type());
-  node->type(cdk::tensor_type::create(tensor->dims()));
+  node->type(node->tensor()->type());
 }
 
 void udf::type_checker::do_tensor_node(udf::tensor_node *const node, int lvl) {
@@ -843,13 +850,13 @@ void udf::type_checker::do_tensor_node(udf::tensor_node *const node, int lvl) {
       throw std::string("tensor cell values must be integer or double expressions");
     }
   }
-  node->type(cdk::tensor_type::create(node->dims()));
+  node->type(udf::types::tensor(node->dims()));
 }
 
 void udf::type_checker::do_address_of_node(udf::address_of_node * const node, int lvl) {
   ASSERT_UNSPEC;
   node->lvalue()->accept(this, lvl + 2);
-  node->type(cdk::reference_type::create(4, node->lvalue()->type()));
+  node->type(udf::types::reference(4, node->lvalue()->type()));
 }
 
 void udf::type_checker::do_index_node(udf::index_node * const node, int lvl) {
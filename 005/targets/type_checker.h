@@ -5,17 +5,19 @@
 namespace udf {
 
   /**
-   * Print nodes as XML elements to the output stream.
+   * Type check the whole tree in a single pass, before code generation.
+   * Every expression node is left with its type set, so later passes only
+   * read node->type() and never check a subtree again.
    */
   class type_checker: public basic_ast_visitor {
-    cdk::symbol_table<udf::symbol> &_symtab;
+    udf::symbol_table &_symtab;
     std::shared_ptr<udf::symbol> _function;
     std::shared_ptr<cdk::basic_type> _inBlockReturnType = nullptr;
-    basic_ast_visitor *_parent;
+    int _errors = 0;
 
   public:
-    type_checker(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<udf::symbol> &symtab, std::shared_ptr<udf::symbol> func, basic_ast_visitor *parent) :
-        basic_ast_visitor(compiler), _symtab(symtab), _function(func), _parent(parent) {
+    type_checker(std::shared_ptr<cdk::compiler> compiler, udf::symbol_table &symtab) :
+        basic_ast_visitor(compiler), _symtab(symtab), _function(nullptr) {
     }
 
   public:
@@ -23,6 +25,15 @@ namespace udf {
       os().flush();
     }
 
+  public:
+    /** Check a node (each element, if a sequence) and report problems. */
+    void check(cdk::basic_node *const node, int lvl);
+
+    /** number of problems reported so far */
+    int errors() const {
+      return _errors;
+    }
+
   protected:
     void processUnaryExpression(cdk::unary_operation_node *const node, int lvl);
     void processBinaryExpression(cdk::binary_operation_node *const node, int lvl);
@@ -49,20 +60,3 @@ namespace udf {
   };
 
 } // udf
-
-//---------------------------------------------------------------------------
-//     HELPER MACRO FOR TYPE CHECKING
-//---------------------------------------------------------------------------
-
-#define CHECK_TYPES(compiler, symtab, function, node) { \
-  try { \
-    udf::type_checker checker(compiler, symtab, function, this); \
-    (node)->accept(&checker, 0); \
-  } \
-  catch (const std::string &problem) { \
-    std::cerr << (node)->lineno() << ": " << problem << std::endl; \
-    return; \
-  } \
-}
-
-#define ASSERT_SAFE_EXPRESSIONS CHECK_TYPES(_compiler, _symtab, _function, node)
@@ -0,0 +1,277 @@
+#include <string>
+#include "targets/variable_usage.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+
+//---------------------------------------------------------------------------
+
+/** Declaration of the variable an lvalue names directly (nullptr if not a variable). */
+udf::variable_declaration_node *udf::variable_usage::target(cdk::lvalue_node *const node) {
+  auto variable = dynamic_cast<cdk::variable_node*>(node);
+  return variable ? declaration(variable) : nullptr;
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_nil_node(cdk::nil_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_data_node(cdk::data_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_double_node(cdk::double_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_integer_node(cdk::integer_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_string_node(cdk::string_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_input_node(udf::input_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_break_node(udf::break_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_continue_node(udf::continue_node *const node, int lvl) {
+  // EMPTY
+}
+void udf::variable_usage::do_function_declaration_node(udf::function_declaration_node *const node, int lvl) {
+  // EMPTY
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_sequence_node(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes())
+    visit(n, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_not_node(cdk::not_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::variable_usage::do_unary_minus_node(cdk::unary_minus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::variable_usage::do_unary_plus_node(cdk::unary_plus_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+void udf::variable_usage::do_stack_alloc_node(udf::stack_alloc_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_and_node(cdk::and_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_or_node(cdk::or_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_add_node(cdk::add_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_sub_node(cdk::sub_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_mul_node(cdk::mul_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_div_node(cdk::div_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_mod_node(cdk::mod_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_lt_node(cdk::lt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_le_node(cdk::le_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_ge_node(cdk::ge_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_gt_node(cdk::gt_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_ne_node(cdk::ne_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+void udf::variable_usage::do_eq_node(cdk::eq_node *const node, int lvl) {
+  visit(node->left(), lvl + 2);
+  visit(node->right(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_variable_node(cdk::variable_node *const node, int lvl) {
+  auto symbol = _symtab.find(udf::name_of(node));
+  if (symbol == nullptr) return;
+  auto it = _declared.find(symbol.get());
+  if (it != _declared.end()) _declarations[node] = it->second;
+}
+
+void udf::variable_usage::do_rvalue_node(cdk::rvalue_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+
+  auto variable = target(node->lvalue());
+  if (variable != nullptr) _usage[variable].read = true;
+}
+
+void udf::variable_usage::do_assignment_node(cdk::assignment_node *const node, int lvl) {
+  visit(node->rvalue(), lvl + 2);
+  visit(node->lvalue(), lvl + 2);
+
+  auto variable = target(node->lvalue());
+  if (variable == nullptr) return;
+  _usage[variable].written = true;
+  for (auto cycle : _cycles)
+    _assigned[cycle].push_back(variable);
+}
+
+void udf::variable_usage::do_address_of_node(udf::address_of_node *const node, int lvl) {
+  visit(node->lvalue(), lvl + 2);
+
+  auto variable = target(node->lvalue());
+  if (variable != nullptr) _usage[variable].escapes = true;
+}
+
+void udf::variable_usage::do_index_node(udf::index_node *const node, int lvl) {
+  visit(node->base(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_evaluation_node(udf::evaluation_node *const node, int lvl) {
+  visit(node->argument(), lvl + 2);
+}
+
+void udf::variable_usage::do_write_node(udf::write_node *const node, int lvl) {
+  visit(node->args(), lvl + 2);
+}
+
+void udf::variable_usage::do_return_node(udf::return_node *const node, int lvl) {
+  visit(node->retval(), lvl + 2);
+}
+
+void udf::variable_usage::do_sizeof_node(udf::sizeof_node *const node, int lvl) {
+  visit(node->expression(), lvl + 2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_block_node(udf::block_node *const node, int lvl) {
+  _symtab.push();
+  visit(node->declarations(), lvl + 2);
+  visit(node->instructions(), lvl + 2);
+  _symtab.pop();
+}
+
+void udf::variable_usage::do_if_node(udf::if_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  visit(node->block(), lvl + 2);
+}
+
+void udf::variable_usage::do_if_else_node(udf::if_else_node *const node, int lvl) {
+  visit(node->condition(), lvl + 2);
+  visit(node->thenblock(), lvl + 2);
+  visit(node->elseblock(), lvl + 2);
+}
+
+void udf::variable_usage::do_for_node(udf::for_node *const node, int lvl) {
+  _symtab.push();
+  visit(node->init(), lvl + 2);
+
+  // only the parts that are repeated count as assignments inside the cycle
+  _cycles.push_back(node);
+  visit(node->condition(), lvl + 2);
+  visit(node->instruction(), lvl + 2);
+  visit(node->increment(), lvl + 2);
+  _cycles.pop_back();
+
+  _symtab.pop();
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_variable_declaration_node(udf::variable_declaration_node *const node, int lvl) {
+  visit(node->initializer(), lvl + 2);
+
+  auto symbol = udf::make_symbol(node->qualifier(), node->type(), node->identifier(),
+                                 node->initializer() != nullptr, false);
+  if (!_symtab.insert(node->id(), symbol)) _symtab.replace(node->id(), symbol); // definition after declaration
+  _declared[symbol.get()] = node;
+  _usage[node].global = !_inFunction;
+}
+
+void udf::variable_usage::do_function_definition_node(udf::function_definition_node *const node, int lvl) {
+  _inFunction = true;
+  _symtab.push(); // scope of arguments
+  visit(node->arguments(), lvl + 2);
+  visit(node->block(), lvl + 2);
+  _symtab.pop();
+  _inFunction = false;
+}
+
+void udf::variable_usage::do_function_call_node(udf::function_call_node *const node, int lvl) {
+  visit(node->arguments(), lvl + 2);
+  _calling.insert(_cycles.begin(), _cycles.end());
+}
+
+//---------------------------------------------------------------------------
+
+void udf::variable_usage::do_tensor_node(udf::tensor_node *const node, int lvl) {
+  visit(node->cell_values(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_capacity_node(udf::tensor_capacity_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_contraction_node(udf::tensor_contraction_node *const node, int lvl) {
+  visit(node->tensor1(), lvl + 2);
+  visit(node->tensor2(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_dims_node(udf::tensor_dims_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_dim_node(udf::tensor_dim_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->index(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_index_node(udf::tensor_index_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->indices(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_rank_node(udf::tensor_rank_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+}
+
+void udf::variable_usage::do_tensor_reshape_node(udf::tensor_reshape_node *const node, int lvl) {
+  visit(node->tensor(), lvl + 2);
+  visit(node->new_dims(), lvl + 2);
+  _reshaping.insert(_cycles.begin(), _cycles.end());
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace udf {
+
+  /**
+   * Resolve every variable use to its declaration and record how each
+   * variable is used: whether its value is ever read, whether it is ever
+   * assigned, whether its address is taken, which variables are assigned
+   * inside each 'for' and which cycles call functions or reshape tensors.
+   */
+  class variable_usage: public basic_ast_visitor {
+  public:
+    struct usage {
+      bool global = false;  // declared outside functions
+      bool read = false;    // its value is used
+      bool written = false; // assigned (besides its initialization)
+      bool escapes = false; // its address is taken
+    };
+
+  private:
+    udf::symbol_table _symtab;
+    std::unordered_map<const udf::symbol*, udf::variable_declaration_node*> _declared;
+    std::unordered_map<const cdk::variable_node*, udf::variable_declaration_node*> _declarations;
+    std::unordered_map<const udf::variable_declaration_node*, usage> _usage;
+    std::unordered_map<const udf::for_node*, std::vector<udf::variable_declaration_node*>> _assigned;
+    std::unordered_set<const udf::for_node*> _calling, _reshaping;
+    std::vector<const udf::for_node*> _cycles; // enclosing cycles
+    bool _inFunction = false;
+
+  public:
+    variable_usage(std::shared_ptr<cdk::compiler> compiler) :
+        basic_ast_visitor(compiler) {
+    }
+
+  public:
+    /** Analyse the whole program. */
+    void analyse(cdk::basic_node *const node) {
+      if (node != nullptr) node->accept(this, 0);
+    }
+
+    /** Declaration of the variable used (nullptr if unknown). */
+    udf::variable_declaration_node *declaration(const cdk::variable_node *node) const {
+      auto it = _declarations.find(node);
+      return it == _declarations.end() ? nullptr : it->second;
+    }
+
+    usage of(const udf::variable_declaration_node *node) const {
+      auto it = _usage.find(node);
+      return it == _usage.end() ? usage() : it->second;
+    }
+
+    /** Variables assigned by the condition, body or increment of a cycle. */
+    const std::vector<udf::variable_declaration_node*> &assigned(const udf::for_node *node) const {
+      static const std::vector<udf::variable_declaration_node*> none;
+      auto it = _assigned.find(node);
+      return it == _assigned.end() ? none : it->second;
+    }
+
+    /** Whether a cycle calls functions (which may change any global or tensor). */
+    bool calls(const udf::for_node *node) const {
+      return _calling.count(node) != 0;
+    }
+
+    /** Whether a cycle reshapes tensors. */
+    bool reshapes(const udf::for_node *node) const {
+      return _reshaping.count(node) != 0;
+    }
+
+  private:
+    void visit(cdk::basic_node *const node, int lvl) {
+      if (node != nullptr) node->accept(this, lvl);
+    }
+    udf::variable_declaration_node *target(cdk::lvalue_node *const node);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
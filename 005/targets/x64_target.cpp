@@ -0,0 +1,13 @@
+#include "targets/x64_target.h"
+
+/**
+ * Native x86-64 (System V ABI, SSE2 doubles).
+ * @var create and register an evaluator for ASM64 targets.
+ */
+udf::x64_target udf::x64_target::_self("asm64", true);
+
+/**
+ * Native x86-64, locals and temporaries in memory.
+ * @var create and register an evaluator for ASM64-PLAIN targets.
+ */
+udf::x64_target udf::x64_target::_plain("asm64-plain", false);
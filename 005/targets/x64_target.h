@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cdk/targets/basic_target.h>
+#include <cdk/ast/basic_node.h>
+#include "targets/analyses.h"
+#include "arena.h"
+#include "time_report.h"
+#include "targets/register_allocator.h"
+#include "targets/x64_writer.h"
+#include "targets/output_buffer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace udf {
+
+  class x64_target: public cdk::basic_target {
+    static x64_target _self;
+    static x64_target _plain;
+
+    bool _allocated; // locals and temporaries may be given registers
+
+  private:
+    x64_target(const char *name, bool allocated) :
+        cdk::basic_target(name), _allocated(allocated) {
+    }
+
+    /**
+     * Registers are used, except with the asm64-plain target or
+     * UDF_REGISTERS=0 (everything in memory, as in the ix86 code).
+     */
+    bool registers() const {
+      const char *value = std::getenv("UDF_REGISTERS");
+      return _allocated && (value == nullptr || std::strcmp(value, "0") != 0);
+    }
+
+  public:
+    bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
+      bool ok = generate(compiler);
+
+      // the syntax tree is not needed anymore: release it in one go
+      compiler->ast(nullptr);
+      udf::arena::close(compiler.get());
+
+      udf::time_report::finish();
+      return ok;
+    }
+
+  private:
+    bool generate(std::shared_ptr<cdk::compiler> compiler) {
+      udf::analyses analysed(compiler);
+      if (!analysed.run(compiler)) return false;
+
+      // locals whose address is never taken and temporaries go to registers
+      udf::register_allocator allocator(compiler, analysed.usage);
+      if (registers()) {
+        udf::time_report::scope phase(udf::time_report::REGISTER_ALLOCATION);
+        allocator.allocate(compiler->ast());
+      }
+
+      udf::time_report::scope phase(udf::time_report::CODE_GENERATION);
+
+      udf::symbol_table symtab;
+      udf::output_buffer buffer(*compiler->ostream());
+
+      // x86-64 code is written directly from the tree: the postfix machine
+      // is built around 4-byte pointers and stack-passed arguments
+      *compiler->ostream() << "default rel\n";
+      x64_writer writer(compiler, symtab, analysed.constants, analysed.dead, analysed.invariants, analysed.inductions,
+                        analysed.fusions, registers() ? &allocator : nullptr);
+      compiler->ast()->accept(&writer, 0);
+
+      return true;
+    }
+
+  };
+
+} // udf
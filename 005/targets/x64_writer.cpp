@@ -0,0 +1,1584 @@
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <sstream>
+#include "targets/x64_writer.h"
+#include "targets/divisor.h"
+#include ".auto/all_nodes.h"  // all_nodes.h is automatically generated
+#include "targets/frame_size_calculator.h"
+#include "time_report.h"
+#include "targets/symbol.h"
+
+#include "udf_parser.tab.h"
+
+//---------------------------------------------------------------------------
+
+namespace {
+
+  const char *const integer_arguments[] = { "rdi", "rsi", "rdx", "rcx", "r8", "r9" };
+  const size_t real_arguments = 8; // xmm0 to xmm7
+
+  // caller-saved registers not used otherwise: rax/xmm0 and rcx/xmm1 hold
+  // operands, rdx is taken by division
+  const char *const integer_temporaries[] = { "r10", "r11", "r9", "r8", "rdi", "rsi" };
+  const char *const real_temporaries[] = { "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7" };
+
+  bool is_real(std::shared_ptr<cdk::basic_type> type) {
+    return type->name() == cdk::TYPE_DOUBLE;
+  }
+
+  /** Size in the LP64 data model: pointers, strings and tensors take 8 bytes. */
+  size_t size_of(std::shared_ptr<cdk::basic_type> type) {
+    if (type->name() == cdk::TYPE_INT) return 4;
+    if (type->name() == cdk::TYPE_DOUBLE) return 8;
+    if (type->name() == cdk::TYPE_VOID) return 1;
+    return 8;
+  }
+
+  /** Size of the objects a pointer type refers to (void counts as 1). */
+  size_t referenced_size(std::shared_ptr<cdk::basic_type> type) {
+    return size_of(cdk::reference_type::cast(type)->referenced());
+  }
+
+  /** The 32-bit part of a general purpose register. */
+  std::string dword(const std::string &name) {
+    return std::isdigit(name[1]) ? name + "d" : "e" + name.substr(1);
+  }
+
+  std::string bits(double value) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::bit_cast<std::uint64_t>(value);
+    return oss.str();
+  }
+
+}
+
+//---------------------------------------------------------------------------
+
+/** Memory operand of a variable: globals are addressed relative to rip. */
+std::string udf::x64_writer::address(const std::shared_ptr<udf::symbol> &symbol) {
+  std::ostringstream oss;
+  if (symbol->global())
+    oss << "[rel " << symbol->name() << "]";
+  else
+    oss << "[rbp" << (symbol->offset() < 0 ? "" : "+") << symbol->offset() << "]";
+  return oss.str();
+}
+
+void udf::x64_writer::load(std::shared_ptr<cdk::basic_type> type, const std::string &memory) {
+  if (type->name() == cdk::TYPE_INT)
+    emit("mov eax, dword ", memory);
+  else if (type->name() == cdk::TYPE_DOUBLE)
+    emit("movsd xmm0, qword ", memory);
+  else
+    emit("mov rax, qword ", memory);
+}
+
+void udf::x64_writer::store(std::shared_ptr<cdk::basic_type> type, const std::string &memory) {
+  if (type->name() == cdk::TYPE_INT)
+    emit("mov dword ", memory, ", eax");
+  else if (type->name() == cdk::TYPE_DOUBLE)
+    emit("movsd qword ", memory, ", xmm0");
+  else
+    emit("mov qword ", memory, ", rax");
+}
+
+/** Load a variable, from its register if it has one. */
+void udf::x64_writer::load(const std::shared_ptr<udf::symbol> &symbol) {
+  auto it = _registers.find(symbol.get());
+  if (it == _registers.end())
+    load(symbol->type(), address(symbol));
+  else if (symbol->is_typed(cdk::TYPE_INT))
+    emit("mov eax, ", dword(it->second));
+  else if (symbol->is_typed(cdk::TYPE_DOUBLE))
+    emit("movapd xmm0, ", it->second);
+  else
+    emit("mov rax, ", it->second);
+}
+
+void udf::x64_writer::store(const std::shared_ptr<udf::symbol> &symbol) {
+  auto it = _registers.find(symbol.get());
+  if (it == _registers.end())
+    store(symbol->type(), address(symbol));
+  else if (symbol->is_typed(cdk::TYPE_INT))
+    emit("mov ", dword(it->second), ", eax");
+  else if (symbol->is_typed(cdk::TYPE_DOUBLE))
+    emit("movapd ", it->second, ", xmm0");
+  else
+    emit("mov ", it->second, ", rax");
+}
+
+/** Give a variable the register chosen for its declaration, if any. */
+void udf::x64_writer::allocate(udf::variable_declaration_node *const node, const std::shared_ptr<udf::symbol> &symbol) {
+  if (_allocator == nullptr) return;
+  // symbols of earlier scopes of the function may have had the same address
+  if (auto name = _allocator->register_of(node))
+    _registers[symbol.get()] = *name;
+  else
+    _registers.erase(symbol.get());
+}
+
+void udf::x64_writer::statement(cdk::basic_node *const node) {
+  if (_allocator) _position = _allocator->position(node);
+}
+
+/** Expressions and declarations of a 'for' header, each a statement. */
+void udf::x64_writer::statements(cdk::sequence_node *const node, int lvl) {
+  for (auto n : node->nodes()) {
+    if (!dynamic_cast<udf::variable_declaration_node*>(n)) statement(n);
+    n->accept(this, lvl);
+  }
+}
+
+/** Restore the callee-saved registers (kept at the top of the frame) and return. */
+void udf::x64_writer::epilogue() {
+  if (_allocator) {
+    const auto &saved = _allocator->saved(_definition);
+    for (size_t i = 0; i < saved.size(); i++)
+      emit("mov ", saved[i], ", qword [rbp-", 8 * (i + 1), "]");
+  }
+  emit("leave");
+  emit("ret");
+}
+
+void udf::x64_writer::load_real(double value) {
+  emit("mov rax, ", bits(value));
+  emit("movq xmm0, rax");
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::push(bool real) {
+  if (real) {
+    emit("sub rsp, 8");
+    emit("movsd qword [rsp], xmm0");
+  } else
+    emit("push rax");
+  _depth++;
+}
+
+void udf::x64_writer::pop(bool real, const std::string &target) {
+  if (real) {
+    emit("movsd ", target, ", qword [rsp]");
+    emit("add rsp, 8");
+  } else
+    emit("pop ", target);
+  _depth--;
+}
+
+void udf::x64_writer::push_integer(int value) {
+  emit("push ", value);
+  _depth++;
+}
+
+void udf::x64_writer::push_real(double value) {
+  emit("mov rax, ", bits(value));
+  emit("push rax");
+  _depth++;
+}
+
+/** Keep the value as a pending operand: in a free register, if allowed. */
+void udf::x64_writer::hold(bool real) {
+  if (_allocator) {
+    for (auto name : real ? real_temporaries : integer_temporaries) {
+      if (std::find(_held.begin(), _held.end(), name) != _held.end()) continue;
+      emit(real ? "movapd " : "mov ", name, real ? ", xmm0" : ", rax");
+      _held.push_back(name);
+      return;
+    }
+  }
+  push(real);
+  _held.push_back("");
+}
+
+void udf::x64_writer::release(bool real, const std::string &target) {
+  auto name = _held.back();
+  _held.pop_back();
+  if (name.empty())
+    pop(real, target);
+  else
+    emit(real ? "movapd " : "mov ", target, ", ", name);
+}
+
+void udf::x64_writer::trash(int slots) {
+  if (slots == 0) return;
+  emit("add rsp, ", 8 * slots);
+  _depth -= slots;
+}
+
+/**
+ * Call a function whose arguments were pushed last to first (the first one
+ * is on top of the stack, as in the ix86 code). Registers holding pending
+ * operands or live variables are saved above the arguments. Arguments are
+ * moved to registers; those that do not fit are pushed again, below a
+ * padding slot if needed to keep the stack aligned at 16 bytes. The pushed
+ * arguments are discarded after the call.
+ */
+void udf::x64_writer::call(const std::string &name, const std::vector<bool> &reals) {
+  std::vector<std::string> saved;
+  if (_allocator) {
+    for (auto &held : _held)
+      if (!held.empty()) saved.push_back(held);
+    for (auto &live : _allocator->live_reals(_definition, _position))
+      saved.push_back(live);
+  }
+  for (auto &r : saved) {
+    if (r.starts_with("xmm")) {
+      emit("sub rsp, 8");
+      emit("movsd qword [rsp], ", r);
+    } else
+      emit("push ", r);
+  }
+  const size_t s = saved.size();
+
+  std::vector<size_t> stacked;
+  size_t integers = 0, floats = 0;
+  for (size_t ax = 0; ax < reals.size(); ax++) {
+    if (reals[ax] && floats < real_arguments)
+      emit("movsd xmm", floats++, ", qword [rsp+", 8 * (s + ax), "]");
+    else if (!reals[ax] && integers < std::size(integer_arguments))
+      emit("mov ", integer_arguments[integers++], ", qword [rsp+", 8 * (s + ax), "]");
+    else
+      stacked.push_back(ax);
+  }
+
+  const bool pad = (_depth + s + stacked.size()) % 2 != 0;
+  if (pad) emit("sub rsp, 8");
+  for (size_t k = stacked.size(); k-- > 0; ) {
+    // every push moves the original slots one further away
+    size_t moved = s + (pad ? 1 : 0) + (stacked.size() - 1 - k);
+    emit("push qword [rsp+", 8 * (stacked[k] + moved), "]");
+  }
+
+  emit("mov eax, ", floats); // variadic callees need the number of vector registers
+  emit("call ", name, " wrt ..plt");
+  size_t extra = stacked.size() + (pad ? 1 : 0);
+  if (s == 0) extra += reals.size();
+  if (extra > 0) emit("add rsp, ", 8 * extra);
+
+  for (size_t k = s; k-- > 0; ) {
+    if (saved[k].starts_with("xmm")) {
+      emit("movsd ", saved[k], ", qword [rsp]");
+      emit("add rsp, 8");
+    } else
+      emit("pop ", saved[k]);
+  }
+  if (s > 0 && reals.size() > 0) emit("add rsp, ", 8 * reals.size());
+  _depth -= reals.size();
+}
+
+//---------------------------------------------------------------------------
+
+/** Evaluate an expression, converting integers if a real value is expected. */
+void udf::x64_writer::evaluate(cdk::expression_node *const node, bool real) {
+  node->accept(this, 0);
+  if (real && node->is_typed(cdk::TYPE_INT))
+    emit("cvtsi2sd xmm0, eax");
+}
+
+void udf::x64_writer::argument(cdk::expression_node *const node, bool real) {
+  evaluate(node, real);
+  push(real);
+}
+
+/** Left operand in rax/xmm0, right operand in rcx/xmm1. */
+void udf::x64_writer::operands(cdk::binary_operation_node *const node, bool real) {
+  evaluate(node->left(), real);
+  hold(real);
+  evaluate(node->right(), real);
+  if (real)
+    emit("movapd xmm1, xmm0");
+  else
+    emit("mov rcx, rax");
+  release(real, real ? "xmm0" : "rax");
+}
+
+/**
+ * A right operand that needs no code of its own, in register mode: an
+ * integer known at compile time or a variable of the operation's type.
+ * Empty if the operand must be evaluated.
+ */
+std::string udf::x64_writer::simple(cdk::expression_node *const node, bool real, bool immediate) {
+  if (_allocator == nullptr) return "";
+  if (!real && immediate) {
+    if (auto value = _constants.find(node); value && std::holds_alternative<int>(*value))
+      return std::to_string(std::get<int>(*value));
+    if (auto integer = dynamic_cast<cdk::integer_node*>(node)) return std::to_string(integer->value());
+  }
+
+  auto rvalue = dynamic_cast<cdk::rvalue_node*>(node);
+  auto variable = rvalue ? dynamic_cast<cdk::variable_node*>(rvalue->lvalue()) : nullptr;
+  if (variable == nullptr || !node->is_typed(real ? cdk::TYPE_DOUBLE : cdk::TYPE_INT)) return "";
+  auto symbol = _symtab.find(udf::name_of(variable));
+  auto it = _registers.find(symbol.get());
+  if (it != _registers.end()) return real ? it->second : dword(it->second);
+  return (real ? "qword " : "dword ") + address(symbol);
+}
+
+/** Left operand in eax/xmm0; the right one is returned (register, memory or immediate). */
+std::string udf::x64_writer::direct_operands(cdk::binary_operation_node *const node, bool real, bool immediate) {
+  auto right = simple(node->right(), real, immediate);
+  if (right.empty()) {
+    operands(node, real);
+    return real ? "xmm1" : "ecx";
+  }
+  evaluate(node->left(), real);
+  return right;
+}
+
+/**
+ * Compare the operands, setting the flags: the condition code given for
+ * their kind is returned (reals, compared with ucomisd, also set the
+ * parity flag when unordered).
+ */
+std::string udf::x64_writer::comparison(cdk::binary_operation_node *const node, const char *integer,
+                                        const char *unsigned_, const char *real, bool &reals) {
+  reals = node->left()->is_typed(cdk::TYPE_DOUBLE) || node->right()->is_typed(cdk::TYPE_DOUBLE);
+  if (reals) {
+    auto right = direct_operands(node, true);
+    emit("ucomisd xmm0, ", right);
+    return real;
+  } else if (node->left()->is_typed(cdk::TYPE_INT) && node->right()->is_typed(cdk::TYPE_INT)) {
+    auto right = direct_operands(node, false);
+    emit("cmp eax, ", right);
+    return integer;
+  } else {
+    // addresses: compared as unsigned 64-bit values
+    node->left()->accept(this, 0);
+    if (node->left()->is_typed(cdk::TYPE_INT)) emit("movsxd rax, eax");
+    hold(false);
+    node->right()->accept(this, 0);
+    if (node->right()->is_typed(cdk::TYPE_INT)) emit("movsxd rax, eax");
+    emit("mov rcx, rax");
+    release(false, "rax");
+    emit("cmp rax, rcx");
+    return unsigned_;
+  }
+}
+
+void udf::x64_writer::compare(cdk::binary_operation_node *const node, const char *integer, const char *unsigned_,
+                              const char *real) {
+  bool reals;
+  auto code = comparison(node, integer, unsigned_, real, reals);
+  // unordered operands (NaN) are never equal
+  if (reals && code == "e") {
+    emit("sete al");
+    emit("setnp cl");
+    emit("and al, cl");
+  } else if (reals && code == "ne") {
+    emit("setne al");
+    emit("setp cl");
+    emit("or al, cl");
+  } else
+    emit("set", code, " al");
+  emit("movzx eax, al");
+}
+
+namespace {
+  /** The condition code that holds when the given one does not. */
+  std::string negated(const std::string &code) {
+    static const std::map<std::string, std::string> opposites = {
+      { "l", "ge" }, { "ge", "l" }, { "le", "g" }, { "g", "le" }, { "b", "ae" },
+      { "ae", "b" }, { "be", "a" }, { "a", "be" }, { "e", "ne" }, { "ne", "e" }
+    };
+    return opposites.at(code);
+  }
+}
+
+/** Jump to lbl if the comparison's value is `when`, with the same results as compare(). */
+void udf::x64_writer::branch(cdk::binary_operation_node *const node, const char *integer, const char *unsigned_,
+                             const char *real, const std::string &lbl, bool when) {
+  bool reals;
+  auto code = comparison(node, integer, unsigned_, real, reals);
+  if (!when) code = negated(code);
+  if (reals && code == "e") {
+    const auto unordered = mklbl(++_lbl);
+    emit("jp ", unordered);
+    emit("je ", lbl);
+    label(unordered);
+  } else if (reals && code == "ne") {
+    emit("jne ", lbl);
+    emit("jp ", lbl);
+  } else
+    emit("j", code, " ", lbl);
+}
+
+namespace {
+  /** Whether a comparison can become a conditional jump (tensors are compared by the runtime). */
+  bool is_scalar(cdk::expression_node *const node) {
+    return !node->is_typed(cdk::TYPE_TENSOR);
+  }
+}
+
+/**
+ * Jump to lbl if the condition's value is `when` and fall through otherwise.
+ * Comparisons jump directly, instead of computing 0 or 1 to be tested, and
+ * each operand of && and || jumps to where evaluation must continue.
+ */
+void udf::x64_writer::processCondition(cdk::expression_node *const node, const std::string &lbl, bool when, int lvl) {
+  if (auto value = _constants.find(node)) {
+    if (udf::is_true(*value) == when) emit("jmp ", lbl);
+    return;
+  }
+
+  if (auto n = dynamic_cast<cdk::not_node*>(node)) {
+    processCondition(n->argument(), lbl, !when, lvl);
+  } else if (auto n = dynamic_cast<cdk::and_node*>(node)) {
+    if (when) {
+      const auto lblFalse = mklbl(++_lbl);
+      processCondition(n->left(), lblFalse, false, lvl);
+      processCondition(n->right(), lbl, true, lvl);
+      label(lblFalse);
+    } else {
+      processCondition(n->left(), lbl, false, lvl);
+      processCondition(n->right(), lbl, false, lvl);
+    }
+  } else if (auto n = dynamic_cast<cdk::or_node*>(node)) {
+    if (when) {
+      processCondition(n->left(), lbl, true, lvl);
+      processCondition(n->right(), lbl, true, lvl);
+    } else {
+      const auto lblTrue = mklbl(++_lbl);
+      processCondition(n->left(), lblTrue, true, lvl);
+      processCondition(n->right(), lbl, false, lvl);
+      label(lblTrue);
+    }
+  } else if (auto n = dynamic_cast<cdk::lt_node*>(node)) {
+    branch(n, "l", "b", "b", lbl, when);
+  } else if (auto n = dynamic_cast<cdk::le_node*>(node)) {
+    branch(n, "le", "be", "be", lbl, when);
+  } else if (auto n = dynamic_cast<cdk::ge_node*>(node)) {
+    branch(n, "ge", "ae", "ae", lbl, when);
+  } else if (auto n = dynamic_cast<cdk::gt_node*>(node)) {
+    branch(n, "g", "a", "a", lbl, when);
+  } else if (auto n = dynamic_cast<cdk::eq_node*>(node); n && is_scalar(n->left()) && is_scalar(n->right())) {
+    branch(n, "e", "e", "e", lbl, when);
+  } else if (auto n = dynamic_cast<cdk::ne_node*>(node); n && is_scalar(n->left()) && is_scalar(n->right())) {
+    branch(n, "ne", "ne", "ne", lbl, when);
+  } else {
+    node->accept(this, lvl);
+    emit("test eax, eax");
+    emit(when ? "jnz " : "jz ", lbl);
+  }
+}
+
+/** Value (0 or 1) of && and ||, computed with jumps. */
+void udf::x64_writer::processLogical(cdk::expression_node *const node, int lvl) {
+  const auto lblFalse = mklbl(++_lbl), lblEnd = mklbl(++_lbl);
+  processCondition(node, lblFalse, false, lvl);
+  emit("mov eax, 1");
+  emit("jmp ", lblEnd);
+  label(lblFalse);
+  emit("xor eax, eax");
+  label(lblEnd);
+}
+
+/** Load the value found by the constant folder instead of the expression's code. */
+bool udf::x64_writer::processConstant(cdk::expression_node *const node) {
+  auto value = _constants.find(node);
+  if (value == nullptr || !_inFunctionBody) return false;
+
+  if (auto integer = std::get_if<int>(value))
+    emit("mov eax, ", *integer);
+  else
+    load_real(std::get<double>(*value));
+  return true;
+}
+
+/** Load the value (or address) of an expression computed before its cycle. */
+bool udf::x64_writer::processInvariant(cdk::typed_node *const node) {
+  auto it = _hoisted.find(node);
+  if (it == _hoisted.end()) return false;
+
+  std::ostringstream slot;
+  slot << "[rbp" << it->second << "]";
+  if (udf::invariants::address(node))
+    emit("mov rax, qword ", slot.str());
+  else
+    load(node->type(), slot.str());
+  return true;
+}
+
+/** Indexing strength-reduced to a running pointer: the pointer is its address. */
+bool udf::x64_writer::processInduction(cdk::typed_node *const node) {
+  auto it = _running.find(node);
+  if (it == _running.end()) return false;
+
+  emit("mov rax, qword [rbp", it->second, "]");
+  return true;
+}
+
+/** Integer multiplication by a known power of two, 3, 5 or 9: a shift or a scaled addition. */
+bool udf::x64_writer::processProduct(cdk::binary_operation_node *const node) {
+  if (!node->is_typed(cdk::TYPE_INT)) return false;
+  auto operand = node->left();
+  auto value = _constants.find(node->right());
+  if (value == nullptr) {
+    operand = node->right();
+    value = _constants.find(node->left());
+  }
+  auto factor = value ? std::get_if<int>(value) : nullptr;
+  if (factor == nullptr || *factor <= 0) return false;
+  bool scaled = *factor == 3 || *factor == 5 || *factor == 9;
+  if (!scaled && !std::has_single_bit(static_cast<unsigned>(*factor))) return false;
+
+  evaluate(operand, false);
+  if (scaled)
+    emit("lea eax, [rax+rax*", *factor - 1, "]");
+  else if (*factor > 1)
+    emit("shl eax, ", std::countr_zero(static_cast<unsigned>(*factor)));
+  return true;
+}
+
+/**
+ * Integer division (or modulo) by a known divisor without idiv: powers of
+ * two are shifts, negative dividends biased by the divisor minus one; any
+ * other divisor is a multiplication (see divisor). Both round towards zero.
+ */
+bool udf::x64_writer::processDivision(cdk::binary_operation_node *const node, bool remainder) {
+  auto value = _constants.find(node->right());
+  auto divisor = value ? std::get_if<int>(value) : nullptr;
+  if (divisor == nullptr || *divisor == 0 || *divisor == std::numeric_limits<int>::min()) return false;
+  std::uint32_t magnitude = *divisor < 0 ? -static_cast<std::uint32_t>(*divisor) : *divisor;
+
+  // the remainder has the sign of the dividend, whatever that of the divisor
+  evaluate(node->left(), false);
+  if (magnitude == 1) {
+    if (remainder) emit("xor eax, eax");
+  } else if (std::has_single_bit(magnitude)) {
+    emit("lea ecx, [rax+", magnitude - 1, "]");
+    emit("test eax, eax");
+    if (remainder) {
+      emit("cmovns ecx, eax");
+      emit("and ecx, ", -static_cast<int>(magnitude));
+      emit("sub eax, ecx");
+    } else {
+      emit("cmovs eax, ecx");
+      emit("sar eax, ", std::countr_zero(magnitude));
+    }
+  } else {
+    udf::divisor magic(magnitude);
+    emit("movsxd rcx, eax");
+    emit("imul rax, rcx, ", magic.multiplier);
+    emit("sar rax, 32");
+    if (magic.multiplier < 0) emit("add eax, ecx");
+    if (magic.shift > 0) emit("sar eax, ", magic.shift);
+    emit("mov edx, eax");
+    emit("shr edx, 31");
+    emit("add eax, edx");
+    if (remainder) {
+      emit("imul eax, eax, ", magnitude);
+      emit("sub ecx, eax");
+      emit("mov eax, ecx");
+    }
+  }
+  if (*divisor < 0 && !remainder) emit("neg eax");
+  return true;
+}
+
+/**
+ * Label of the read-only cells of a tensor literal whose cells are all
+ * known: identical literals share them.
+ */
+std::string udf::x64_writer::literal(udf::tensor_node *const node) {
+  std::vector<std::uint64_t> key;
+  for (auto cell : node->cell_values()->nodes())
+    key.push_back(std::bit_cast<std::uint64_t>(
+        std::visit([](auto v) { return static_cast<double>(v); }, *_constants.find(cell))));
+  auto it = _literals.find(key);
+  if (it != _literals.end()) return it->second;
+
+  const auto lbl = mklbl(++_lbl);
+  emit("section .rodata");
+  emit("align 8");
+  label(lbl);
+  for (auto cell : key)
+    emit("dq ", bits(std::bit_cast<double>(cell)));
+  emit("section .text");
+  _literals.emplace(key, lbl);
+  return lbl;
+}
+
+/**
+ * An elementwise tensor expression computed by a kernel of its own (see
+ * fusions). The operands are evaluated in order, tensors replaced by the
+ * address of their first cell, and kept in frame slots with the new tensor
+ * and the address of its first cell; rcx counts the cells. An operand
+ * loaded right before the operation that takes it is used from memory, as
+ * are the cells of known literals. A literal alone is loaded by the
+ * runtime in one call.
+ */
+bool udf::x64_writer::processFusion(cdk::expression_node *const node) {
+  auto kernel = _fusions.find(node);
+  if (kernel == nullptr) return false;
+  auto &dims = cdk::tensor_type::cast(node->type())->dims();
+
+  // arguments of tensor_load: the new tensor goes above the cells
+  if (kernel->steps.size() == 1 && kernel->steps[0].op == udf::fusions::operation::literal) {
+    emit("lea rax, [rel ", literal(kernel->literals[0]), "]");
+    push(false);
+    processTensorCreation(dims, "tensor_create");
+    push(false);
+    _functions_to_declare.insert("tensor_load");
+    call("tensor_load", { false, false });
+    return true;
+  }
+
+  _functions_to_declare.insert("tensor_getptr");
+
+  // the address of the first cell: the tensor goes above as many zero indices as its rank
+  auto first = [&](size_t rank) {
+    call("tensor_getptr", std::vector<bool>(rank + 1, false));
+  };
+
+  for (auto operand : kernel->operands) {
+    if (operand->is_typed(cdk::TYPE_TENSOR)) {
+      size_t rank = cdk::tensor_type::cast(operand->type())->n_dims();
+      for (size_t i = 0; i < rank; i++)
+        push_integer(0);
+      argument(operand, false);
+      first(rank);
+      push(false);
+    } else
+      argument(operand, true);
+  }
+
+  // the slots are taken only now: operands may have kernels of their own
+  const int saved = _offset;
+  std::vector<int> slots(kernel->operands.size());
+  for (size_t i = slots.size(); i-- > 0; ) {
+    pop(false, "rax");
+    slots[i] = _offset -= 8;
+    emit("mov qword [rbp", slots[i], "], rax");
+  }
+
+  processTensorCreation(dims, "tensor_create");
+  const int result = _offset -= 8;
+  emit("mov qword [rbp", result, "], rax");
+  for (size_t i = 0; i < dims.size(); i++)
+    push_integer(0);
+  push(false);
+  first(dims.size());
+  const int cells = _offset -= 8;
+  emit("mov qword [rbp", cells, "], rax");
+
+  std::vector<std::string> literals;
+  for (auto tensor : kernel->literals)
+    literals.push_back(literal(tensor));
+
+  auto memory = [&](const udf::fusions::step &step) {
+    std::ostringstream oss;
+    auto operand = step.operand;
+    if (step.op == udf::fusions::operation::literal) {
+      emit("lea rdx, [rel ", literals[operand], "]");
+      oss << "qword [rdx+rcx*8]";
+    } else if (kernel->operands[operand]->is_typed(cdk::TYPE_TENSOR)) {
+      emit("mov rdx, qword [rbp", slots[operand], "]");
+      oss << "qword [rdx+rcx*8]";
+    } else
+      oss << "qword [rbp" << slots[operand] << "]";
+    return oss.str();
+  };
+  auto instruction = [](udf::fusions::operation op) {
+    switch (op) {
+      case udf::fusions::operation::add: return "addsd";
+      case udf::fusions::operation::sub: return "subsd";
+      case udf::fusions::operation::mul: return "mulsd";
+      case udf::fusions::operation::div: return "divsd";
+      default: return "";
+    }
+  };
+
+  // there is at least one cell: the test is at the bottom
+  const auto lbl = mklbl(++_lbl);
+  emit("xor ecx, ecx");
+  emit("align 16");
+  label(lbl);
+  bool live = false; // xmm0 holds a pending value
+  auto &steps = kernel->steps;
+  for (size_t i = 0; i < steps.size(); i++) {
+    if (steps[i].op == udf::fusions::operation::load || steps[i].op == udf::fusions::operation::literal) {
+      auto &step = steps[i];
+      if (i + 1 < steps.size() && *instruction(steps[i + 1].op)) {
+        emit(instruction(steps[++i].op), " xmm0, ", memory(step));
+        continue;
+      }
+      if (live) hold(true);
+      emit("movsd xmm0, ", memory(step));
+      live = true;
+    } else if (steps[i].op == udf::fusions::operation::neg) {
+      emit("movq rax, xmm0");
+      emit("btc rax, 63");
+      emit("movq xmm0, rax");
+    } else {
+      emit("movapd xmm1, xmm0");
+      release(true, "xmm0");
+      emit(instruction(steps[i].op), " xmm0, xmm1");
+    }
+  }
+  emit("mov rdx, qword [rbp", cells, "]");
+  emit("movsd qword [rdx+rcx*8], xmm0");
+  emit("inc rcx");
+  emit("cmp rcx, ", kernel->cells);
+  emit("jl ", lbl);
+
+  emit("mov rax, qword [rbp", result, "]");
+  _offset = saved;
+  return true;
+}
+
+/** Create a tensor with the runtime function that takes the dimensions. */
+void udf::x64_writer::processTensorCreation(const std::vector<size_t> &dims, const std::string &function) {
+  for (size_t i = dims.size(); i-- > 0; )
+    push_integer(dims[i]);
+  push_integer(dims.size());
+  _functions_to_declare.insert(function);
+  call(function, std::vector<bool>(dims.size() + 1, false));
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_nil_node(cdk::nil_node * const node, int lvl) {
+  // EMPTY
+}
+void udf::x64_writer::do_data_node(cdk::data_node * const node, int lvl) {
+  // EMPTY
+}
+void udf::x64_writer::do_double_node(cdk::double_node * const node, int lvl) {
+  if (_inFunctionBody)
+    load_real(node->value());
+  else
+    emit("dq ", bits(node->value()));
+}
+void udf::x64_writer::do_not_node(cdk::not_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  node->argument()->accept(this, lvl + 2);
+  emit("test eax, eax");
+  emit("sete al");
+  emit("movzx eax, al");
+}
+void udf::x64_writer::do_and_node(cdk::and_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  processLogical(node, lvl);
+}
+void udf::x64_writer::do_or_node(cdk::or_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  processLogical(node, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_sequence_node(cdk::sequence_node * const node, int lvl) {
+  for (size_t i = 0; i < node->size(); i++) {
+    if (_dead.skipped(node->node(i))) continue; // unreachable or useless
+    node->node(i)->accept(this, lvl);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_integer_node(cdk::integer_node * const node, int lvl) {
+  if (_inFunctionBody)
+    emit("mov eax, ", node->value());
+  else
+    emit("dd ", node->value());
+}
+
+void udf::x64_writer::do_string_node(cdk::string_node * const node, int lvl) {
+  const auto lbl = mklbl(++_lbl);
+
+  std::ostringstream bytes;
+  for (unsigned char c : node->value())
+    bytes << static_cast<int>(c) << ", ";
+  bytes << 0;
+
+  emit("section .rodata");
+  label(lbl);
+  emit("db ", bytes.str());
+
+  if (_inFunctionBody) { // local string
+    emit("section .text");
+    emit("lea rax, [rel ", lbl, "]");
+  } else { // global string: the variable's label is already in .data
+    emit("section .data");
+    emit("dq ", lbl);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_unary_minus_node(cdk::unary_minus_node * const node, int lvl) {
+  if (processConstant(node) || processFusion(node)) return;
+  if (node->argument()->is_typed(cdk::TYPE_TENSOR)) {
+    push_real(-1);
+    argument(node->argument(), false);
+    _functions_to_declare.insert("tensor_mul_scalar");
+    call("tensor_mul_scalar", { false, true });
+    return;
+  }
+
+  node->argument()->accept(this, lvl);
+  if (node->argument()->is_typed(cdk::TYPE_INT))
+    emit("neg eax");
+  else if (node->argument()->is_typed(cdk::TYPE_DOUBLE)) {
+    emit("movq rax, xmm0");
+    emit("btc rax, 63");
+    emit("movq xmm0, rax");
+  }
+}
+
+void udf::x64_writer::do_unary_plus_node(cdk::unary_plus_node * const node, int lvl) {
+  if (processConstant(node) || processFusion(node)) return;
+  node->argument()->accept(this, lvl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_add_node(cdk::add_node * const node, int lvl) {
+  if (processConstant(node) || processInvariant(node) || processFusion(node)) return;
+  if (node->is_typed(cdk::TYPE_TENSOR)) {
+    if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+      argument(node->right(), false);
+      argument(node->left(), false);
+      _functions_to_declare.insert("tensor_add");
+      call("tensor_add", { false, false });
+    } else {
+      if (node->left()->is_typed(cdk::TYPE_TENSOR)) {
+        argument(node->right(), true);
+        argument(node->left(), false);
+      } else {
+        argument(node->left(), true);
+        argument(node->right(), false);
+      }
+      _functions_to_declare.insert("tensor_add_scalar");
+      call("tensor_add_scalar", { false, true });
+    }
+  } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    emit("addsd xmm0, ", direct_operands(node, true));
+  } else if (node->is_typed(cdk::TYPE_POINTER)) {
+    operands(node, false);
+    if (node->left()->is_typed(cdk::TYPE_POINTER)) {
+      emit("movsxd rcx, ecx");
+      emit("imul rcx, rcx, ", referenced_size(node->left()->type()));
+    } else {
+      emit("movsxd rax, eax");
+      emit("imul rax, rax, ", referenced_size(node->right()->type()));
+    }
+    emit("add rax, rcx");
+  } else {
+    emit("add eax, ", direct_operands(node, false));
+  }
+}
+
+void udf::x64_writer::do_sub_node(cdk::sub_node * const node, int lvl) {
+  if (processConstant(node) || processInvariant(node) || processFusion(node)) return;
+  if (node->is_typed(cdk::TYPE_TENSOR)) {
+    if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+      argument(node->left(), false);
+      argument(node->right(), false);
+      _functions_to_declare.insert("tensor_sub");
+      call("tensor_sub", { false, false });
+    } else if (node->right()->is_typed(cdk::TYPE_TENSOR)) {
+      // scalar - tensor: negate the tensor and add the scalar
+      argument(node->left(), true);
+      push_real(-1);
+      argument(node->right(), false);
+      _functions_to_declare.insert("tensor_mul_scalar");
+      call("tensor_mul_scalar", { false, true });
+      push(false);
+      _functions_to_declare.insert("tensor_add_scalar");
+      call("tensor_add_scalar", { false, true });
+    } else {
+      argument(node->right(), true);
+      argument(node->left(), false);
+      _functions_to_declare.insert("tensor_sub_scalar");
+      call("tensor_sub_scalar", { false, true });
+    }
+  } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    emit("subsd xmm0, ", direct_operands(node, true));
+  } else if (node->left()->is_typed(cdk::TYPE_POINTER) && node->right()->is_typed(cdk::TYPE_POINTER)) {
+    operands(node, false);
+    emit("sub rax, rcx");
+    if (cdk::reference_type::cast(node->left()->type())->referenced()->name() != cdk::TYPE_VOID) {
+      emit("mov rcx, ", referenced_size(node->left()->type()));
+      emit("cqo");
+      emit("idiv rcx");
+    }
+  } else if (node->left()->is_typed(cdk::TYPE_POINTER)) {
+    operands(node, false);
+    emit("movsxd rcx, ecx");
+    emit("imul rcx, rcx, ", referenced_size(node->left()->type()));
+    emit("sub rax, rcx");
+  } else {
+    emit("sub eax, ", direct_operands(node, false));
+  }
+}
+
+void udf::x64_writer::do_mul_node(cdk::mul_node * const node, int lvl) {
+  if (processConstant(node) || processInvariant(node) || processFusion(node)) return;
+  if (node->is_typed(cdk::TYPE_TENSOR)) {
+    if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+      argument(node->right(), false);
+      argument(node->left(), false);
+      _functions_to_declare.insert("tensor_mul");
+      call("tensor_mul", { false, false });
+    } else {
+      if (node->left()->is_typed(cdk::TYPE_TENSOR)) {
+        argument(node->right(), true);
+        argument(node->left(), false);
+      } else {
+        argument(node->left(), true);
+        argument(node->right(), false);
+      }
+      _functions_to_declare.insert("tensor_mul_scalar");
+      call("tensor_mul_scalar", { false, true });
+    }
+  } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    emit("mulsd xmm0, ", direct_operands(node, true));
+  } else if (!processProduct(node)) {
+    emit("imul eax, ", direct_operands(node, false));
+  }
+}
+
+void udf::x64_writer::do_div_node(cdk::div_node * const node, int lvl) {
+  if (processConstant(node) || processInvariant(node) || processFusion(node)) return;
+  if (node->is_typed(cdk::TYPE_TENSOR)) {
+    if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+      argument(node->left(), false);
+      argument(node->right(), false);
+      _functions_to_declare.insert("tensor_div");
+      call("tensor_div", { false, false });
+    } else if (node->left()->is_typed(cdk::TYPE_TENSOR)) {
+      argument(node->right(), true);
+      argument(node->left(), false);
+      _functions_to_declare.insert("tensor_div_scalar");
+      call("tensor_div_scalar", { false, true });
+    } else {
+      // scalar / tensor: divide a tensor of ones and scale the result
+      argument(node->left(), true);
+      argument(node->right(), false);
+      processTensorCreation(cdk::tensor_type::cast(node->right()->type())->dims(), "tensor_ones");
+      push(false);
+      _functions_to_declare.insert("tensor_div");
+      call("tensor_div", { false, false });
+      push(false);
+      _functions_to_declare.insert("tensor_mul_scalar");
+      call("tensor_mul_scalar", { false, true });
+    }
+  } else if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    emit("divsd xmm0, ", direct_operands(node, true));
+  } else if (!processDivision(node, false)) {
+    auto right = direct_operands(node, false, false);
+    emit("cdq");
+    emit("idiv ", right);
+  }
+}
+
+void udf::x64_writer::do_mod_node(cdk::mod_node * const node, int lvl) {
+  if (processConstant(node) || processInvariant(node) || processDivision(node, true)) return;
+  auto right = direct_operands(node, false, false);
+  emit("cdq");
+  emit("idiv ", right);
+  emit("mov eax, edx");
+}
+
+void udf::x64_writer::do_lt_node(cdk::lt_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  compare(node, "l", "b", "b");
+}
+void udf::x64_writer::do_le_node(cdk::le_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  compare(node, "le", "be", "be");
+}
+void udf::x64_writer::do_ge_node(cdk::ge_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  compare(node, "ge", "ae", "ae");
+}
+void udf::x64_writer::do_gt_node(cdk::gt_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  compare(node, "g", "a", "a");
+}
+void udf::x64_writer::do_ne_node(cdk::ne_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+    argument(node->left(), false);
+    argument(node->right(), false);
+    if (cdk::tensor_type::cast(node->left()->type())->dims() != cdk::tensor_type::cast(node->right()->type())->dims()) {
+      trash(2);
+      emit("mov eax, 1"); // if the dimensions are not equal, return true
+    } else {
+      _functions_to_declare.insert("tensor_equals");
+      call("tensor_equals", { false, false });
+      emit("cmp eax, 1");
+      emit("setne al");
+      emit("movzx eax, al");
+    }
+  } else
+    compare(node, "ne", "ne", "ne");
+}
+void udf::x64_writer::do_eq_node(cdk::eq_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  if (node->left()->is_typed(cdk::TYPE_TENSOR) && node->right()->is_typed(cdk::TYPE_TENSOR)) {
+    argument(node->right(), false);
+    argument(node->left(), false);
+    if (cdk::tensor_type::cast(node->left()->type())->dims() != cdk::tensor_type::cast(node->right()->type())->dims()) {
+      trash(2);
+      emit("xor eax, eax"); // if the dimensions are not equal, return false
+    } else {
+      _functions_to_declare.insert("tensor_equals");
+      call("tensor_equals", { false, false });
+      emit("cmp eax, 1");
+      emit("sete al");
+      emit("movzx eax, al");
+    }
+  } else
+    compare(node, "e", "e", "e");
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_variable_node(cdk::variable_node * const node, int lvl) {
+  auto symbol = _symtab.find(udf::name_of(node));
+  emit("lea rax, ", address(symbol));
+}
+
+void udf::x64_writer::do_rvalue_node(cdk::rvalue_node * const node, int lvl) {
+  if (processConstant(node)) return;
+  if (auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue())) {
+    load(_symtab.find(udf::name_of(variable)));
+    return;
+  }
+  node->lvalue()->accept(this, lvl);
+  load(node->type(), "[rax]");
+}
+
+void udf::x64_writer::do_assignment_node(cdk::assignment_node * const node, int lvl) {
+  const bool real = is_real(node->type());
+  evaluate(node->rvalue(), real); // determine the new value
+  if (_dead.dropped(node)) return; // nobody reads the variable
+
+  if (auto variable = dynamic_cast<cdk::variable_node*>(node->lvalue())) {
+    store(_symtab.find(udf::name_of(variable)));
+    return;
+  }
+
+  hold(real);
+  node->lvalue()->accept(this, lvl + 2);
+  emit("mov rcx, rax");
+  release(real, real ? "xmm0" : "rax");
+  store(node->type(), "[rcx]");
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_evaluation_node(udf::evaluation_node * const node, int lvl) {
+  statement(node);
+  node->argument()->accept(this, lvl); // the value stays in the accumulator
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_if_node(udf::if_node * const node, int lvl) {
+  statement(node);
+  if (auto condition = _constants.find(node->condition())) {
+    // known condition: only the live branch is generated
+    if (udf::is_true(*condition))
+      node->block()->accept(this, lvl + 2);
+    return;
+  }
+
+  const auto lbl = mklbl(++_lbl);
+  processCondition(node->condition(), lbl, false, lvl);
+  node->block()->accept(this, lvl + 2);
+  label(lbl);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_if_else_node(udf::if_else_node * const node, int lvl) {
+  statement(node);
+  if (auto condition = _constants.find(node->condition())) {
+    // known condition: only the live branch is generated
+    if (udf::is_true(*condition))
+      node->thenblock()->accept(this, lvl + 2);
+    else if (node->elseblock())
+      node->elseblock()->accept(this, lvl + 2);
+    return;
+  }
+
+  const auto lbl1 = mklbl(++_lbl), lbl2 = mklbl(++_lbl);
+  processCondition(node->condition(), lbl1, false, lvl);
+  node->thenblock()->accept(this, lvl + 2);
+  emit("jmp ", lbl2);
+  label(lbl1);
+  node->elseblock()->accept(this, lvl + 2);
+  label(lbl2);
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_break_node(udf::break_node * const node, int lvl) {
+  if (_forEnd.size() != 0)
+    emit("jmp ", mklbl(_forEnd.top())); // jump to for end
+  else
+    error(node->lineno(), "'break' outside 'for'");
+}
+
+void udf::x64_writer::do_continue_node(udf::continue_node * const node, int lvl) {
+  if (_forStep.size() != 0)
+    emit("jmp ", mklbl(_forStep.top())); // jump to next cycle
+  else
+    error(node->lineno(), "'continue' outside 'for'");
+}
+
+void udf::x64_writer::do_for_node(udf::for_node * const node, int lvl) {
+  const int ini = ++_lbl;
+  _forStep.push(++_lbl);
+  _forEnd.push(++_lbl);
+  const int test = ++_lbl;
+
+  _symtab.push();
+
+  statements(node->init(), lvl + 2);
+
+  // invariant expressions are computed once, before the cycle
+  for (auto expression : _invariants.hoisted(node)) {
+    expression->accept(this, lvl + 2);
+    std::ostringstream slot;
+    slot << "[rbp" << (_offset -= 8) << "]";
+    if (udf::invariants::address(expression))
+      emit("mov qword ", slot.str(), ", rax");
+    else
+      store(expression->type(), slot.str());
+    _hoisted[expression] = _offset;
+  }
+
+  // indexing that follows induction variables walks running pointers
+  for (auto &pointer : _inductions.pointers(node)) {
+    pointer.start->accept(this, lvl + 2);
+    emit("mov qword [rbp", (_offset -= 8), "], rax");
+    for (auto use : pointer.uses)
+      _running[use] = _offset;
+    _steps[pointer.step].emplace_back(_offset, pointer.cells * static_cast<int>(size_of(pointer.start->type())));
+  }
+
+  // the condition is tested at the bottom: one jump per cycle, taken while it holds
+  emit("jmp ", mklbl(test));
+
+  emit("align 16");
+  label(mklbl(ini));
+  node->instruction()->accept(this, lvl + 2);
+
+  label(mklbl(_forStep.top()));
+  for (auto n : node->increment()->nodes()) {
+    statement(n);
+    n->accept(this, lvl + 2);
+    for (auto [slot, bytes] : _steps[n])
+      emit("add qword [rbp", slot, "], ", bytes);
+  }
+
+  label(mklbl(test));
+  auto condition = node->condition();
+  for (size_t i = 0; i < condition->size(); i++) {
+    auto n = condition->node(i);
+    if (!dynamic_cast<udf::variable_declaration_node*>(n)) statement(n);
+    if (i + 1 < condition->size())
+      n->accept(this, lvl + 2);
+    else // the last condition decides
+      processCondition(dynamic_cast<cdk::expression_node*>(n), mklbl(ini), true, lvl + 2);
+  }
+  if (condition->size() == 0)
+    emit("jmp ", mklbl(ini));
+
+  label(mklbl(_forEnd.top()));
+
+  _symtab.pop();
+
+  _forStep.pop();
+  _forEnd.pop();
+}
+
+void udf::x64_writer::do_input_node(udf::input_node * const node, int lvl) {
+  if (node->is_typed(cdk::TYPE_DOUBLE)) {
+    _functions_to_declare.insert("readd");
+    call("readd", {});
+  } else if (node->is_typed(cdk::TYPE_INT)) {
+    _functions_to_declare.insert("readi");
+    call("readi", {});
+  } else
+    std::cerr << "FATAL: " << node->lineno() << ": cannot read type" << std::endl;
+}
+
+void udf::x64_writer::do_nullptr_node(udf::nullptr_node *const node, int lvl) {
+  if (_inFunctionBody)
+    emit("xor eax, eax");
+  else
+    emit("dq 0");
+}
+
+/**
+ * The block is taken from the stack, below the pending operands, which are
+ * moved down to the new top. The size is rounded to keep the alignment.
+ */
+void udf::x64_writer::do_stack_alloc_node(udf::stack_alloc_node * const node, int lvl) {
+  node->argument()->accept(this, lvl);
+
+  emit("movsxd rax, eax");
+  emit("imul rax, rax, ", referenced_size(node->type()));
+  emit("add rax, 15");
+  emit("and rax, -16");
+  emit("sub rsp, rax");
+  for (int k = 0; k < _depth; k++) {
+    emit("mov rcx, qword [rsp+rax+", 8 * k, "]");
+    emit("mov qword [rsp+", 8 * k, "], rcx");
+  }
+  emit("lea rax, [rsp+", 8 * _depth, "]");
+}
+
+void udf::x64_writer::do_return_node(udf::return_node * const node, int lvl) {
+  statement(node);
+  // should not reach here without returning a value (if not void)
+  if (_function->type()->name() != cdk::TYPE_VOID)
+    evaluate(node->retval(), is_real(_function->type()));
+
+  epilogue();
+}
+
+void udf::x64_writer::do_sizeof_node(udf::sizeof_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  if (node->expression()->is_typed(cdk::TYPE_TENSOR)) {
+    argument(node->expression(), false);
+    _functions_to_declare.insert("tensor_size");
+    call("tensor_size", { false });
+    emit("shl eax, 3");
+  } else
+    emit("mov eax, ", size_of(node->expression()->type()));
+}
+
+void udf::x64_writer::do_write_node(udf::write_node * const node, int lvl) {
+  statement(node);
+  for (size_t ix = 0; ix < node->args()->size(); ix++) {
+    auto child = dynamic_cast<cdk::expression_node*>(node->args()->node(ix));
+
+    std::string function;
+    if (child->is_typed(cdk::TYPE_INT))
+      function = "printi";
+    else if (child->is_typed(cdk::TYPE_DOUBLE))
+      function = "printd";
+    else if (child->is_typed(cdk::TYPE_STRING))
+      function = "prints";
+    else if (child->is_typed(cdk::TYPE_TENSOR))
+      function = "tensor_print";
+    else {
+      std::cerr << "cannot print expression of unknown type" << std::endl;
+      return;
+    }
+
+    argument(child, child->is_typed(cdk::TYPE_DOUBLE)); // expression to print
+    _functions_to_declare.insert(function);
+    call(function, { child->is_typed(cdk::TYPE_DOUBLE) });
+  }
+
+  if (node->newline()) {
+    _functions_to_declare.insert("println");
+    call("println", {});
+  }
+}
+
+void udf::x64_writer::do_function_declaration_node(udf::function_declaration_node * const node, int lvl) {
+  if (_inFunctionBody) {
+    error(node->lineno(), "cannot declare function in body or in arguments");
+    return;
+  }
+
+  // types were already checked: just make the function known here
+  auto function = udf::make_symbol(node->qualifier(), node->type(), udf::function_name(node->identifier()),
+                                   false, true, true);
+  std::vector<std::shared_ptr<cdk::basic_type>> argtypes;
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    argtypes.push_back(node->argument(ax)->type());
+  function->set_argument_types(argtypes);
+
+  if (!_symtab.find(function->name())) _symtab.insert(function->name(), function);
+  _functions_to_declare.insert(function->name());
+}
+
+void udf::x64_writer::do_variable_declaration_node(udf::variable_declaration_node * const node, int lvl) {
+  auto id = node->identifier();
+
+  // o typechecker ja deduziu o tipo (auto incluido)
+  auto symbol = udf::make_symbol(node->qualifier(), node->type(), id, (bool)node->initializer(), false);
+
+  if (_inFunctionBody && _dead.dropped(node)) {
+    // never read: no slot, and the initializer only matters for its side effects
+    statement(node);
+    if (node->initializer() && !_dead.skipped(node->initializer()))
+      evaluate(node->initializer(), is_real(node->type()));
+    return;
+  }
+
+  if (_inFunctionBody) {
+    // every local variable takes one 8-byte slot (unused if in a register)
+    statement(node);
+    symbol->set_offset(_offset -= 8);
+    allocate(node, symbol);
+    _symtab.insert(id, symbol);
+
+    if (node->initializer()) {
+      evaluate(node->initializer(), is_real(node->type()));
+      store(symbol);
+    } else if (node->is_typed(cdk::TYPE_TENSOR)) {
+      processTensorCreation(cdk::tensor_type::cast(node->type())->dims(), "tensor_create");
+      store(symbol);
+    }
+    return;
+  }
+
+  _symtab.insert(id, symbol);
+
+  if (node->initializer() == nullptr) { // sem valor inicial
+    emit("section .bss");
+    emit("align 8");
+    label(id);
+    emit("resb ", size_of(node->type()));
+  } else if (node->is_typed(cdk::TYPE_STRING)) {
+    // the string itself goes to .rodata: the variable holds its address
+    emit("section .data");
+    emit("align 8");
+    label(id);
+    node->initializer()->accept(this, lvl);
+  } else if (node->is_typed(cdk::TYPE_INT) || node->is_typed(cdk::TYPE_DOUBLE) || node->is_typed(cdk::TYPE_POINTER)) {
+    emit("section .data");
+    emit("align 8");
+    label(id);
+
+    auto value = _constants.find(node->initializer());
+    if (node->is_typed(cdk::TYPE_DOUBLE) && value != nullptr)
+      emit("dq ", bits(std::holds_alternative<int>(*value) ? std::get<int>(*value) : std::get<double>(*value)));
+    else if (node->is_typed(cdk::TYPE_INT) && value != nullptr)
+      emit("dd ", std::get<int>(*value));
+    else if (node->is_typed(cdk::TYPE_DOUBLE) && node->initializer()->is_typed(cdk::TYPE_INT)) {
+      auto integer = dynamic_cast<cdk::integer_node*>(node->initializer());
+      emit("dq ", bits(integer->value()));
+    } else
+      node->initializer()->accept(this, lvl);
+  } else
+    std::cerr << node->lineno() << ": '" << id << "' has unexpected initializer\n";
+}
+
+void udf::x64_writer::do_block_node(udf::block_node * const node, int lvl) {
+  _symtab.push();
+  if (node->declarations())
+    node->declarations()->accept(this, lvl + 2);
+  if (node->instructions())
+    node->instructions()->accept(this, lvl + 2);
+  _symtab.pop();
+}
+
+void udf::x64_writer::do_function_definition_node(udf::function_definition_node * const node, int lvl) {
+  if (_inFunctionBody) {
+    error(node->lineno(), "cannot define function in body or in arguments");
+    return;
+  }
+
+  // remember symbol so that args and body know
+  _function = udf::make_symbol(node->qualifier(), node->type(), udf::function_name(node->identifier()),
+                               true, true, false);
+  std::vector<std::shared_ptr<cdk::basic_type>> argtypes;
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    argtypes.push_back(node->argument(ax)->type());
+  _function->set_argument_types(argtypes);
+
+  if (!_symtab.replace(_function->name(), _function)) _symtab.insert(_function->name(), _function);
+  _functions_to_declare.erase(_function->name());  // just in case
+
+  _symtab.push(); // scope of args
+  _definition = node;
+  statement(node);
+
+  // callee-saved registers used by the function are kept at the top of the frame
+  static const std::vector<std::string> none;
+  const auto &saved = _allocator ? _allocator->saved(node) : none;
+
+  // compute stack size to be reserved for local variables: every local
+  // and every argument passed in a register get an 8-byte slot
+  frame_size_calculator lsc(_compiler, _symtab, _function, _dead, _invariants, _inductions, _fusions);
+  udf::time_report::timed(udf::time_report::FRAME_SIZE, [&] { node->accept(&lsc, lvl); });
+  size_t frame = 2 * lsc.localsize() + 8 * (node->arguments()->size() + saved.size());
+  frame = (frame + 15) / 16 * 16;
+
+  emit("section .text");
+  emit("align 16");
+  if (node->qualifier() == tPUBLIC) emit("global ", _function->name(), ":function");
+  label(_function->name());
+  emit("push rbp");
+  emit("mov rbp, rsp");
+  if (frame > 0) emit("sub rsp, ", frame);
+
+  _offset = 0;
+  for (auto &name : saved)
+    emit("mov qword [rbp", _offset -= 8, "], ", name);
+
+  // arguments in registers are kept in the frame (or in the register
+  // chosen for them); the others stay in the caller's frame, above the
+  // return address
+  size_t integers = 0, floats = 0, stacked = 0;
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++) {
+    auto arg = dynamic_cast<udf::variable_declaration_node*>(node->argument(ax));
+    auto symbol = udf::make_symbol(arg->qualifier(), arg->type(), arg->identifier(), false, false);
+    std::ostringstream incoming;
+    if (is_real(arg->type()) ? floats < real_arguments : integers < std::size(integer_arguments)) {
+      symbol->set_offset(_offset -= 8);
+      if (is_real(arg->type()))
+        incoming << "xmm" << floats++;
+      else
+        incoming << integer_arguments[integers++];
+    } else {
+      symbol->set_offset(16 + 8 * stacked++);
+      incoming << "qword " << address(symbol);
+    }
+
+    allocate(arg, symbol);
+    auto reg = _registers.find(symbol.get());
+    if (reg != _registers.end())
+      emit(is_real(arg->type()) ? "movsd " : "mov ", reg->second, ", ", incoming.str());
+    else if (symbol->offset() < 0)
+      emit(is_real(arg->type()) ? "movsd qword " : "mov qword ", address(symbol), ", ", incoming.str());
+    _symtab.insert(arg->identifier(), symbol);
+  }
+
+  _depth = 0;
+  _held.clear();
+  if (!_memInitialized && node->identifier() == "udf") {
+    _functions_to_declare.insert("mem_init");
+    call("mem_init", {});
+    _memInitialized = true;
+  }
+
+  _inFunctionBody = true;
+  node->block()->accept(this, lvl + 4); // block has its own scope
+  _inFunctionBody = false;
+
+  epilogue();
+
+  _symtab.pop(); // scope of arguments
+  _registers.clear(); // the symbols of later declarations, globals too, may reuse these addresses
+
+  if (node->identifier() == "udf") {
+    // declare external functions
+    for (std::string s : _functions_to_declare)
+      emit("extern ", s);
+  }
+}
+
+void udf::x64_writer::do_function_call_node(udf::function_call_node * const node, int lvl) {
+  auto symbol = _symtab.find(node->id());
+
+  std::vector<bool> reals;
+  for (int ax = node->arguments()->size() - 1; ax >= 0; ax--) {
+    auto arg = dynamic_cast<cdk::expression_node*>(node->arguments()->node(ax));
+    argument(arg, symbol->argument_is_typed(ax, cdk::TYPE_DOUBLE));
+  }
+  for (size_t ax = 0; ax < node->arguments()->size(); ax++)
+    reals.push_back(symbol->argument_is_typed(ax, cdk::TYPE_DOUBLE));
+
+  call(symbol->name(), reals); // the result is in rax or xmm0
+}
+
+//---------------------------------------------------------------------------
+
+void udf::x64_writer::do_tensor_capacity_node(udf::tensor_capacity_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  argument(node->tensor(), false);
+  _functions_to_declare.insert("tensor_size");
+  call("tensor_size", { false });
+}
+
+void udf::x64_writer::do_tensor_contraction_node(udf::tensor_contraction_node * const node, int lvl) {
+  argument(node->tensor2(), false);
+  argument(node->tensor1(), false);
+  _functions_to_declare.insert("tensor_matmul");
+  call("tensor_matmul", { false, false });
+}
+
+void udf::x64_writer::do_tensor_dims_node(udf::tensor_dims_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  argument(node->tensor(), false);
+  _functions_to_declare.insert("tensor_get_dims");
+  call("tensor_get_dims", { false });
+}
+
+void udf::x64_writer::do_tensor_dim_node(udf::tensor_dim_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  argument(node->index(), false);
+  argument(node->tensor(), false);
+  _functions_to_declare.insert("tensor_get_dim_size");
+  call("tensor_get_dim_size", { false, false });
+}
+
+void udf::x64_writer::do_tensor_index_node(udf::tensor_index_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  for (size_t i = 0; i < node->indices()->size(); i++)
+    argument(dynamic_cast<cdk::expression_node*>(node->indices()->node(i)), false);
+  argument(node->tensor(), false);
+
+  _functions_to_declare.insert("tensor_getptr");
+  call("tensor_getptr", std::vector<bool>(node->indices()->size() + 1, false));
+}
+
+void udf::x64_writer::do_tensor_rank_node(udf::tensor_rank_node * const node, int lvl) {
+  if (processInvariant(node)) return;
+  argument(node->tensor(), false);
+  _functions_to_declare.insert("tensor_get_n_dims");
+  call("tensor_get_n_dims", { false });
+}
+
+void udf::x64_writer::do_tensor_reshape_node(udf::tensor_reshape_node * const node, int lvl) {
+  for (ssize_t i = node->new_dims()->size() - 1; i >= 0; i--)
+    argument(dynamic_cast<cdk::expression_node*>(node->new_dims()->node(i)), false);
+  push_integer(node->new_dims()->size());
+  argument(node->tensor(), false);
+
+  _functions_to_declare.insert("tensor_reshape");
+  call("tensor_reshape", std::vector<bool>(node->new_dims()->size() + 2, false));
+}
+
+void udf::x64_writer::do_tensor_node(udf::tensor_node * const node, int lvl) {
+  if (processFusion(node)) return; // known cells: copied
+  processTensorCreation(node->dims(), "tensor_create");
+  push(false); // the new tensor stays below the arguments of each tensor_put
+
+  _functions_to_declare.insert("tensor_put");
+  for (size_t i = 0; i < node->cell_values()->nodes().size(); i++) {
+    emit("push qword [rsp]");
+    _depth++;
+    push_integer(i);
+    argument(dynamic_cast<cdk::expression_node*>(node->cell_values()->node(i)), true);
+    call("tensor_put", { true, false, false });
+  }
+  pop(false, "rax");
+}
+
+void udf::x64_writer::do_address_of_node(udf::address_of_node * const node, int lvl) {
+  node->lvalue()->accept(this, lvl + 2);
+}
+
+void udf::x64_writer::do_index_node(udf::index_node * const node, int lvl) {
+  if (processInvariant(node) || processInduction(node)) return;
+  node->base()->accept(this, lvl);
+  hold(false);
+  evaluate(node->index(), false);
+  emit("movsxd rcx, eax");
+  release(false, "rax");
+  size_t size = size_of(node->type());
+  if (size == 1 || size == 2 || size == 4 || size == 8)
+    emit("lea rax, [rax+rcx*", size, "]"); // scaled by the address itself
+  else {
+    emit("imul rcx, rcx, ", size);
+    emit("add rax, rcx");
+  }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "targets/basic_ast_visitor.h"
+#include "targets/constants.h"
+#include "targets/dead_code.h"
+#include "targets/invariants.h"
+#include "targets/inductions.h"
+#include "targets/fusions.h"
+#include "targets/register_allocator.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stack>
+#include <unordered_map>
+#include <vector>
+
+namespace udf {
+
+  //!
+  //! Traverse syntax tree and generate x86-64 assembly code (NASM syntax).
+  //!
+  //! Each expression leaves its value in rax (eax for integers) or, if
+  //! real, in xmm0; pending operands are kept on the machine stack, one
+  //! 8-byte slot each. Pointers, strings and tensors take 8 bytes. Calls
+  //! follow the System V convention.
+  //!
+  //! With a register allocator, the variables it chose live in registers
+  //! and pending operands are held in free caller-saved registers, which
+  //! are saved only around calls.
+  //!
+  class x64_writer: public basic_ast_visitor {
+    udf::symbol_table &_symtab;
+    const udf::constants &_constants;
+    const udf::dead_code &_dead;
+    const udf::invariants &_invariants;
+    const udf::inductions &_inductions;
+    const udf::fusions &_fusions;
+    const udf::register_allocator *_allocator; // nullptr: everything in memory
+    int _lbl;
+
+    bool _inFunctionBody = false;
+    std::stack<int> _forStep, _forEnd;
+    std::shared_ptr<udf::symbol> _function;
+    std::set<std::string> _functions_to_declare;
+    int _offset = 0;  // last frame slot used by the function
+    int _depth = 0;   // slots pushed since the frame was set up
+    bool _memInitialized = false;
+    std::unordered_map<const cdk::basic_node*, int> _hoisted; // frame slot of each invariant
+    std::unordered_map<const cdk::basic_node*, int> _running; // frame slot of each strength-reduced indexing
+    std::unordered_map<const cdk::basic_node*, std::vector<std::pair<int, int>>> _steps; // slots (and bytes) each increment moves
+    std::map<std::vector<std::uint64_t>, std::string> _literals; // label of each distinct set of known cells
+
+    udf::function_definition_node *_definition = nullptr;
+    int _position = -1; // of the current statement
+    std::unordered_map<const udf::symbol*, std::string> _registers;
+    std::vector<std::string> _held; // pending operands: register or "" (machine stack)
+
+  public:
+    x64_writer(std::shared_ptr<cdk::compiler> compiler, udf::symbol_table &symtab, const udf::constants &constants,
+               const udf::dead_code &dead, const udf::invariants &invariants, const udf::inductions &inductions,
+               const udf::fusions &fusions, const udf::register_allocator *allocator = nullptr) :
+        basic_ast_visitor(compiler), _symtab(symtab), _constants(constants), _dead(dead), _invariants(invariants),
+        _inductions(inductions), _fusions(fusions), _allocator(allocator), _lbl(0) {
+    }
+
+  public:
+    ~x64_writer() {
+      os().flush();
+    }
+
+  private:
+    /** Method used to generate sequential labels. */
+    inline std::string mklbl(int lbl) {
+      std::ostringstream oss;
+      if (lbl < 0)
+        oss << ".L" << -lbl;
+      else
+        oss << "_L" << lbl;
+      return oss.str();
+    }
+    void error(int lineno, std::string e) {
+      std::cerr << lineno << ": " << e << std::endl;
+    }
+
+    template<typename ... Parts>
+    void emit(const Parts &... parts) {
+      os() << '\t';
+      (os() << ... << parts);
+      os() << '\n';
+    }
+    void label(const std::string &name) {
+      os() << name << ":\n";
+    }
+
+    std::string address(const std::shared_ptr<udf::symbol> &symbol);
+    void load(std::shared_ptr<cdk::basic_type> type, const std::string &memory);
+    void store(std::shared_ptr<cdk::basic_type> type, const std::string &memory);
+    void load(const std::shared_ptr<udf::symbol> &symbol);
+    void store(const std::shared_ptr<udf::symbol> &symbol);
+    void allocate(udf::variable_declaration_node *const node, const std::shared_ptr<udf::symbol> &symbol);
+    void statement(cdk::basic_node *const node);
+    void statements(cdk::sequence_node *const node, int lvl);
+    void epilogue();
+    void load_real(double value);
+
+    void push(bool real);
+    void pop(bool real, const std::string &target);
+    void push_integer(int value);
+    void push_real(double value);
+    void trash(int slots);
+    void hold(bool real);
+    void release(bool real, const std::string &target);
+    void call(const std::string &name, const std::vector<bool> &reals);
+
+    void evaluate(cdk::expression_node *const node, bool real);
+    void argument(cdk::expression_node *const node, bool real);
+    void operands(cdk::binary_operation_node *const node, bool real);
+    std::string simple(cdk::expression_node *const node, bool real, bool immediate);
+    std::string direct_operands(cdk::binary_operation_node *const node, bool real, bool immediate = true);
+    std::string comparison(cdk::binary_operation_node *const node, const char *integer, const char *unsigned_,
+                           const char *real, bool &reals);
+    void compare(cdk::binary_operation_node *const node, const char *integer, const char *unsigned_, const char *real);
+    void branch(cdk::binary_operation_node *const node, const char *integer, const char *unsigned_, const char *real,
+                const std::string &lbl, bool when);
+    void processCondition(cdk::expression_node *const node, const std::string &lbl, bool when, int lvl);
+    void processLogical(cdk::expression_node *const node, int lvl);
+    bool processConstant(cdk::expression_node *const node);
+    bool processInvariant(cdk::typed_node *const node);
+    bool processInduction(cdk::typed_node *const node);
+    bool processProduct(cdk::binary_operation_node *const node);
+    bool processDivision(cdk::binary_operation_node *const node, bool remainder);
+    bool processFusion(cdk::expression_node *const node);
+    std::string literal(udf::tensor_node *const node);
+    void processTensorCreation(const std::vector<size_t> &dims, const std::string &function);
+
+  public:
+  // do not edit these lines
+#define __IN_VISITOR_HEADER__
+#include ".auto/visitor_decls.h"       // automatically generated
+#undef __IN_VISITOR_HEADER__
+  // do not edit these lines: end
+
+  };
+
+} // udf
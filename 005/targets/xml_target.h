@@ -3,6 +3,9 @@
 #include <cdk/targets/basic_target.h>
 #include <cdk/ast/basic_node.h>
 #include "targets/xml_writer.h"
+#include "targets/output_buffer.h"
+#include "arena.h"
+#include "time_report.h"
 
 namespace udf {
 
@@ -18,10 +21,20 @@ namespace udf {
     bool evaluate(std::shared_ptr<cdk::compiler> compiler) {
       // this symbol table will be used to check identifiers
       // an exception will be thrown if identifiers are used before declaration
-      cdk::symbol_table<udf::symbol> symtab;
+      udf::symbol_table symtab;
 
-      xml_writer writer(compiler, symtab);
-      compiler->ast()->accept(&writer, 0);
+      {
+        udf::time_report::scope phase(udf::time_report::XML_EMISSION);
+        udf::output_buffer buffer(*compiler->ostream());
+        xml_writer writer(compiler, symtab);
+        compiler->ast()->accept(&writer, 0);
+      }
+
+      // the syntax tree is not needed anymore: release it in one go
+      compiler->ast(nullptr);
+      udf::arena::close(compiler.get());
+
+      udf::time_report::finish();
       return true;
     }
 
@@ -9,10 +9,10 @@ namespace udf {
    * Print nodes as XML elements to the output stream.
    */
   class xml_writer: public basic_ast_visitor {
-    cdk::symbol_table<udf::symbol> &_symtab;
+    udf::symbol_table &_symtab;
 
   public:
-    xml_writer(std::shared_ptr<cdk::compiler> compiler, cdk::symbol_table<udf::symbol> &symtab) :
+    xml_writer(std::shared_ptr<cdk::compiler> compiler, udf::symbol_table &symtab) :
         basic_ast_visitor(compiler), _symtab(symtab) {
     }
 
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sys/resource.h>
+#include "time_report.h"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  struct totals {
+    double seconds = 0;
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+    long peak_rss = 0; // KB
+    bool seen = false;
+  };
+
+  const char *names[] = {
+    "", "scanning", "parsing", "type checking", "variable usage", "constant folding", "dead code", "loop invariants", "induction variables", "tensor fusion", "register allocation", "frame size", "code generation", "xml emission"
+  };
+
+  totals phases[udf::time_report::PHASES];
+  udf::time_report::phase current = udf::time_report::NONE;
+  clock::time_point since;
+  std::size_t allocations_since = 0, bytes_since = 0;
+
+  const char *format() {
+    const char *value = std::getenv("UDF_TIME_REPORT");
+    return value != nullptr && *value != '\0' ? value : nullptr;
+  }
+
+  long peak_rss() {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+  }
+}
+
+const bool udf::time_report::_enabled = format() != nullptr;
+std::size_t udf::time_report::_allocations = 0;
+std::size_t udf::time_report::_bytes = 0;
+
+//---------------------------------------------------------------------------
+
+udf::time_report::phase udf::time_report::enter(phase p) {
+  if (!enabled()) return NONE;
+
+  auto now = clock::now();
+  auto &t = phases[current];
+  t.seconds += std::chrono::duration<double>(now - since).count();
+  t.allocations += _allocations - allocations_since;
+  t.bytes += _bytes - bytes_since;
+  t.seen = true;
+
+  // scanning alternates with parsing once per token: the (costly) RSS
+  // sample is taken when parsing ends, and both phases share it
+  if (current != SCANNING && p != SCANNING) {
+    t.peak_rss = peak_rss();
+    if (current == PARSING) phases[SCANNING].peak_rss = t.peak_rss;
+  }
+
+  phase previous = current;
+  current = p;
+  since = now;
+  allocations_since = _allocations;
+  bytes_since = _bytes;
+  return previous;
+}
+
+void udf::time_report::finish() {
+  if (!enabled()) return;
+  enter(NONE);
+
+  bool json = std::strcmp(format(), "json") == 0;
+  std::ostream &os = std::cerr;
+  if (json) {
+    os << "{\"phases\":[";
+    const char *separator = "";
+    for (int p = SCANNING; p < PHASES; p++) {
+      if (!phases[p].seen) continue;
+      os << separator << "{\"name\":\"" << names[p] << "\",\"wall_ms\":" << phases[p].seconds * 1000
+         << ",\"allocations\":" << phases[p].allocations << ",\"bytes\":" << phases[p].bytes
+         << ",\"peak_rss_kb\":" << phases[p].peak_rss << "}";
+      separator = ",";
+    }
+    os << "]}" << std::endl;
+  } else {
+    os << std::left << std::setw(18) << "phase" << std::right << std::setw(12) << "wall (ms)" << std::setw(14)
+       << "allocations" << std::setw(16) << "bytes" << std::setw(16) << "peak RSS (KB)" << '\n';
+    for (int p = SCANNING; p < PHASES; p++) {
+      if (!phases[p].seen) continue;
+      os << std::left << std::setw(18) << names[p] << std::right << std::setw(12) << std::fixed
+         << std::setprecision(3) << phases[p].seconds * 1000 << std::setw(14) << phases[p].allocations
+         << std::setw(16) << phases[p].bytes << std::setw(16) << phases[p].peak_rss << '\n';
+    }
+    os.flush();
+  }
+}
+
+//---------------------------------------------------------------------------
+// allocation counting
+
+void *operator new(std::size_t size) {
+  udf::time_report::allocated(size);
+  for (;;) {
+    if (void *p = std::malloc(size == 0 ? 1 : size)) return p;
+    auto handler = std::get_new_handler();
+    if (handler == nullptr) throw std::bad_alloc();
+    handler();
+  }
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
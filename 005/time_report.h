@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+
+namespace udf {
+
+  /**
+   * Per-phase statistics for one compilation: wall time, allocations
+   * (count and bytes) and peak RSS. Enabled by setting UDF_TIME_REPORT in
+   * the environment ("json" selects JSON output); the report is written to
+   * std::cerr when the target finishes.
+   *
+   * Accounting is exclusive: while a phase runs inside another (e.g.,
+   * scanning inside parsing), only the inner one is charged.
+   */
+  class time_report {
+  public:
+    enum phase {
+      NONE, SCANNING, PARSING, TYPE_CHECKING, VARIABLE_USAGE, CONSTANT_FOLDING, DEAD_CODE, INVARIANTS, INDUCTIONS, FUSION, REGISTER_ALLOCATION, FRAME_SIZE, CODE_GENERATION, XML_EMISSION, PHASES
+    };
+
+    /** Charge the current phase until the scope ends. */
+    class scope {
+      phase _previous;
+    public:
+      explicit scope(phase p) :
+          _previous(enter(p)) {
+      }
+      ~scope() {
+        enter(_previous);
+      }
+      scope(const scope&) = delete;
+      scope &operator=(const scope&) = delete;
+    };
+
+  public:
+    static bool enabled() {
+      return _enabled;
+    }
+
+    /** Charge everything so far to the current phase and switch: returns the previous phase. */
+    static phase enter(phase p);
+
+    /** Run the function as part of the given phase. */
+    template<typename F>
+    static auto timed(phase p, F &&f) {
+      scope s(p);
+      return f();
+    }
+
+    /** Close the current phase and print the report. */
+    static void finish();
+
+    /** Called for each allocation (see operator new). */
+    static void allocated(std::size_t bytes) {
+      _allocations++;
+      _bytes += bytes;
+    }
+
+  private:
+    static const bool _enabled;
+    static std::size_t _allocations;
+    static std::size_t _bytes;
+  };
+
+} // udf
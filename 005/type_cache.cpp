@@ -0,0 +1,30 @@
+#include <map>
+#include <utility>
+#include "type_cache.h"
+
+namespace {
+  // types are never released: a program only uses a handful of them
+  std::map<std::pair<size_t, cdk::typename_type>, std::shared_ptr<cdk::basic_type>> primitives;
+  std::map<std::pair<size_t, cdk::basic_type*>, std::shared_ptr<cdk::basic_type>> references;
+  std::map<std::vector<size_t>, std::shared_ptr<cdk::basic_type>> tensors;
+}
+
+const std::shared_ptr<cdk::basic_type> &udf::types::primitive(size_t size, cdk::typename_type name) {
+  auto &type = primitives[{ size, name }];
+  if (!type) type = cdk::primitive_type::create(size, name);
+  return type;
+}
+
+const std::shared_ptr<cdk::basic_type> &udf::types::reference(size_t size,
+                                                              const std::shared_ptr<cdk::basic_type> &referenced) {
+  // the referenced type is kept alive by the reference, so its address is a stable key
+  auto &type = references[{ size, referenced.get() }];
+  if (!type) type = cdk::reference_type::create(size, referenced);
+  return type;
+}
+
+const std::shared_ptr<cdk::basic_type> &udf::types::tensor(const std::vector<size_t> &dims) {
+  auto &type = tensors[dims];
+  if (!type) type = cdk::tensor_type::create(dims);
+  return type;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cdk/types/types.h>
+
+namespace udf {
+
+  /**
+   * Hash-consed types: each distinct type is created once and shared by
+   * every node that has it, so types can be compared as pointers.
+   */
+  namespace types {
+
+    const std::shared_ptr<cdk::basic_type> &primitive(size_t size, cdk::typename_type name);
+    const std::shared_ptr<cdk::basic_type> &reference(size_t size, const std::shared_ptr<cdk::basic_type> &referenced);
+    const std::shared_ptr<cdk::basic_type> &tensor(const std::vector<size_t> &dims);
+
+  } // types
+
+} // udf
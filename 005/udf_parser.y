@@ -12,11 +12,28 @@
 #define yylex()                      compiler->scanner()->scan()
 #define yyerror(compiler, s)         compiler->scanner()->error(s)
 //-- don't change *any* of these --- END!
-#define NIL (new cdk::nil_node(LINE))
+#include "arena.h"
+#include "identifier.h"
+#include "type_cache.h"
+#include "mapped_source.h"
+#include "time_report.h"
+#undef yylex
+#define yylex()                      udf::time_report::timed(udf::time_report::SCANNING, [&] { return compiler->scanner()->scan(); })
+#define MAKE(type, ...)              (udf::arena::current().make<type>(__VA_ARGS__))
+#define NIL MAKE(cdk::nil_node, LINE)
+#define VARIABLE(name)               (udf::arena::current().variable(LINE, name))
 %}
 
 %parse-param {std::shared_ptr<cdk::compiler> compiler}
 
+// nodes and temporaries live in the compilation unit's arena;
+// the source file, when it can be mapped, is scanned in place
+%initial-action {
+  udf::time_report::enter(udf::time_report::PARSING);
+  udf::arena::open(compiler.get());
+  udf::mapped_source::scan(compiler);
+}
+
 %union {
   //--- don't change *any* of these: if you do, you'll break the compiler.
   YYSTYPE() : type(cdk::primitive_type::create(0, cdk::TYPE_VOID)) {}
@@ -29,7 +46,8 @@
 
   int                  i;           /* integer value */
   double               d;           /* real value */
-  std::string          *s;          /* symbol name or string literal */
+  const std::string    *s;          /* interned symbol name or string literal */
+  std::string          *text;       /* string literal being concatenated */
   std::size_t           s_t;        /* size_t value */
   std::vector<std::size_t> *dims;   /* dimensions for tensors */
   cdk::basic_node      *node;       /* node pointer */
@@ -61,7 +79,7 @@
 %type <lvalue> lval
 %type <type> data_type void_type
 %type <block> block
-%type<s> string
+%type<text> string
 
 %nonassoc tIFX
 %nonassoc tELIF tELSE
@@ -86,14 +104,14 @@
 %}
 %%
 
-// file
-file : /* empty */  { compiler->ast($$ = new cdk::sequence_node(LINE)); }
-     | declarations { compiler->ast($$ = $1); }
+// file (the last reduction: parsing ends here, whatever the target does next is its own phase)
+file : /* empty */  { compiler->ast($$ = MAKE(cdk::sequence_node, LINE)); udf::time_report::enter(udf::time_report::NONE); }
+     | declarations { compiler->ast($$ = $1); udf::time_report::enter(udf::time_report::NONE); }
      ;
 
 // declarations
-declarations :              declaration { $$ = new cdk::sequence_node(LINE, $1);     }
-             | declarations declaration { $$ = new cdk::sequence_node(LINE, $2, $1); }
+declarations :              declaration { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+             | declarations declaration { $$ = $1; $$->nodes().push_back($2);        }
              ;
 
 declaration  : vardec ';' { $$ = $1; }
@@ -102,17 +120,17 @@ declaration  : vardec ';' { $$ = $1; }
              ;
 
 // variables
-vardec : tPUBLIC  data_type tID '=' expression       { $$ = new udf::variable_declaration_node(LINE, tPUBLIC, $2, *$3, $5); delete $3; }
-       | tPUBLIC  data_type tID                      { $$ = new udf::variable_declaration_node(LINE, tPUBLIC, $2, *$3, nullptr); delete $3; }
-       | tFORWARD data_type tID                      { $$ = new udf::variable_declaration_node(LINE, tPUBLIC, $2, *$3, nullptr); delete $3; }
-       | tPUBLIC tTYPE_AUTO tID '=' expression       { $$ = new udf::variable_declaration_node(LINE, tPUBLIC, nullptr, *$3, $5); delete $3; }
-       |          data_type tID '=' expression       { $$ = new udf::variable_declaration_node(LINE, tPRIVATE, $1, *$2, $4); delete $2; }
-       |          data_type tID                      { $$ = new udf::variable_declaration_node(LINE, tPRIVATE, $1, *$2, nullptr); delete $2; }
-       |          tTYPE_AUTO tID '=' expression      { $$ = new udf::variable_declaration_node(LINE, tPRIVATE, nullptr, *$2, $4); delete $2; }
+vardec : tPUBLIC  data_type tID '=' expression       { $$ = MAKE(udf::variable_declaration_node, LINE, tPUBLIC, $2, *$3, $5); }
+       | tPUBLIC  data_type tID                      { $$ = MAKE(udf::variable_declaration_node, LINE, tPUBLIC, $2, *$3, nullptr); }
+       | tFORWARD data_type tID                      { $$ = MAKE(udf::variable_declaration_node, LINE, tPUBLIC, $2, *$3, nullptr); }
+       | tPUBLIC tTYPE_AUTO tID '=' expression       { $$ = MAKE(udf::variable_declaration_node, LINE, tPUBLIC, nullptr, *$3, $5); }
+       |          data_type tID '=' expression       { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE, $1, *$2, $4); }
+       |          data_type tID                      { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE, $1, *$2, nullptr); }
+       |          tTYPE_AUTO tID '=' expression      { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE, nullptr, *$2, $4); }
        ;
 
-vardecs      : vardec ';'          { $$ = new cdk::sequence_node(LINE, $1);     }
-             | vardecs vardec ';'  { $$ = new cdk::sequence_node(LINE, $2, $1); }
+vardecs      : vardec ';'          { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+             | vardecs vardec ';'  { $$ = $1; $$->nodes().push_back($2);        }
              ;
              
 opt_vardecs  : /* empty */ { $$ = NULL; }
@@ -120,148 +138,148 @@ opt_vardecs  : /* empty */ { $$ = NULL; }
              ;
 
 // functions
-fundec   :          data_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPRIVATE, $1, *$2, $4); }
-         | tFORWARD data_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  $2, *$3, $5); }
-         | tPUBLIC  data_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  $2, *$3, $5); }
-         |          tTYPE_AUTO tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPRIVATE, nullptr, *$2, $4); }
-         | tFORWARD tTYPE_AUTO tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  nullptr, *$3, $5); }
-         | tPUBLIC  tTYPE_AUTO tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  nullptr, *$3, $5); }
-         |          void_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPRIVATE, $1, *$2, $4); }
-         | tFORWARD void_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  $2, *$3, $5); }
-         | tPUBLIC  void_type  tID '(' argdecs ')' { $$ = new udf::function_declaration_node(LINE, tPUBLIC,  $2, *$3, $5); }
+fundec   :          data_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPRIVATE, $1, *$2, $4); }
+         | tFORWARD data_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  $2, *$3, $5); }
+         | tPUBLIC  data_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  $2, *$3, $5); }
+         |          tTYPE_AUTO tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPRIVATE, nullptr, *$2, $4); }
+         | tFORWARD tTYPE_AUTO tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  nullptr, *$3, $5); }
+         | tPUBLIC  tTYPE_AUTO tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  nullptr, *$3, $5); }
+         |          void_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPRIVATE, $1, *$2, $4); }
+         | tFORWARD void_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  $2, *$3, $5); }
+         | tPUBLIC  void_type  tID '(' argdecs ')' { $$ = MAKE(udf::function_declaration_node, LINE, tPUBLIC,  $2, *$3, $5); }
          ;
 
-fundef   :         data_type  tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPRIVATE, $1, *$2, $4, $6); }
-         | tPUBLIC data_type  tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPUBLIC,  $2, *$3, $5, $7); }
-         |         tTYPE_AUTO tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPRIVATE, nullptr, *$2, $4, $6); }
-         | tPUBLIC tTYPE_AUTO tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPUBLIC,  nullptr, *$3, $5, $7); }
-         |         void_type  tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPRIVATE, $1, *$2, $4, $6); }
-         | tPUBLIC void_type  tID '(' argdecs ')' block { $$ = new udf::function_definition_node(LINE, tPUBLIC,  $2, *$3, $5, $7); }
+fundef   :         data_type  tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPRIVATE, $1, *$2, $4, $6); }
+         | tPUBLIC data_type  tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPUBLIC,  $2, *$3, $5, $7); }
+         |         tTYPE_AUTO tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPRIVATE, nullptr, *$2, $4, $6); }
+         | tPUBLIC tTYPE_AUTO tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPUBLIC,  nullptr, *$3, $5, $7); }
+         |         void_type  tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPRIVATE, $1, *$2, $4, $6); }
+         | tPUBLIC void_type  tID '(' argdecs ')' block { $$ = MAKE(udf::function_definition_node, LINE, tPUBLIC,  $2, *$3, $5, $7); }
          ;
 
 // types
-data_type    : tTYPE_STRING                     { $$ = cdk::primitive_type::create(4, cdk::TYPE_STRING);  }
-             | tTYPE_INT                        { $$ = cdk::primitive_type::create(4, cdk::TYPE_INT);     }
-             | tTYPE_REAL                       { $$ = cdk::primitive_type::create(8, cdk::TYPE_DOUBLE);  }
-             | tTYPE_POINTER '<' data_type '>'  { $$ = cdk::reference_type::create(4, $3); }
-             | tTYPE_POINTER '<' tTYPE_AUTO '>' { $$ = cdk::reference_type::create(4, nullptr); }
-             | tTYPE_TENSOR '<' dims '>'        { $$ = cdk::tensor_type::create(*$3); }
+data_type    : tTYPE_STRING                     { $$ = udf::types::primitive(4, cdk::TYPE_STRING);  }
+             | tTYPE_INT                        { $$ = udf::types::primitive(4, cdk::TYPE_INT);     }
+             | tTYPE_REAL                       { $$ = udf::types::primitive(8, cdk::TYPE_DOUBLE);  }
+             | tTYPE_POINTER '<' data_type '>'  { $$ = udf::types::reference(4, $3); }
+             | tTYPE_POINTER '<' tTYPE_AUTO '>' { $$ = udf::types::reference(4, nullptr); }
+             | tTYPE_TENSOR '<' dims '>'        { $$ = udf::types::tensor(*$3); }
              ;
 
-dims : tINTEGER { $$ = new std::vector<size_t>(); $$->push_back($1); }
+dims : tINTEGER { $$ = MAKE(std::vector<size_t>); $$->push_back($1); }
      | dims ',' tINTEGER         { $$ = $1; $1->push_back($3); }
      ;
 
-void_type : tTYPE_VOID { $$ = cdk::primitive_type::create(LINE, cdk::TYPE_VOID); }
+void_type : tTYPE_VOID { $$ = udf::types::primitive(0, cdk::TYPE_VOID); }
           ;
 
 // block
-block    : '{' opt_vardecs opt_instructions '}' { $$ = new udf::block_node(LINE, $2, $3); }
+block    : '{' opt_vardecs opt_instructions '}' { $$ = MAKE(udf::block_node, LINE, $2, $3); }
          ;
 
 // block - arguments
-argdecs  : /* empty */         { $$ = new cdk::sequence_node(LINE);  }
-         |             argdec  { $$ = new cdk::sequence_node(LINE, $1);     }
-         | argdecs ',' argdec  { $$ = new cdk::sequence_node(LINE, $3, $1); }
+argdecs  : /* empty */         { $$ = MAKE(cdk::sequence_node, LINE);  }
+         |             argdec  { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+         | argdecs ',' argdec  { $$ = $1; $$->nodes().push_back($3);        }
          ;
 
-argdec   : data_type tID { $$ = new udf::variable_declaration_node(LINE, tPRIVATE, $1, *$2, nullptr); }
+argdec   : data_type tID { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE, $1, *$2, nullptr); }
          ;
 
 // block - instructions
-instructions    : instruction                { $$ = new cdk::sequence_node(LINE, $1);     }
-                | instructions instruction   { $$ = new cdk::sequence_node(LINE, $2, $1); }
+instructions    : instruction                { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+                | instructions instruction   { $$ = $1; $$->nodes().push_back($2);        }
                 ;
 
-opt_instructions: /* empty */  { $$ = new cdk::sequence_node(LINE); }
+opt_instructions: /* empty */  { $$ = MAKE(cdk::sequence_node, LINE); }
                 | instructions { $$ = $1; }
                 ;
 
 instruction     : conditional_instruction                                                       { $$ = $1; }
-                | tFOR '(' opt_forinit ';' opt_expressions ';' opt_expressions ')' instruction  { $$ = new udf::for_node(LINE, $3, $5, $7, $9); }
-                | expression ';'                                                                { $$ = new udf::evaluation_node(LINE, $1); }
-                | tWRITE   expressions ';'                                                      { $$ = new udf::write_node(LINE, $2, false); }
-                | tWRITELN expressions ';'                                                      { $$ = new udf::write_node(LINE, $2, true); }
-                | tBREAK                                                                        { $$ = new udf::break_node(LINE);  }
-                | tCONTINUE                                                                     { $$ = new udf::continue_node(LINE); }
+                | tFOR '(' opt_forinit ';' opt_expressions ';' opt_expressions ')' instruction  { $$ = MAKE(udf::for_node, LINE, $3, $5, $7, $9); }
+                | expression ';'                                                                { $$ = MAKE(udf::evaluation_node, LINE, $1); }
+                | tWRITE   expressions ';'                                                      { $$ = MAKE(udf::write_node, LINE, $2, false); }
+                | tWRITELN expressions ';'                                                      { $$ = MAKE(udf::write_node, LINE, $2, true); }
+                | tBREAK                                                                        { $$ = MAKE(udf::break_node, LINE);  }
+                | tCONTINUE                                                                     { $$ = MAKE(udf::continue_node, LINE); }
                 | return                                                                        { $$ = $1; }
                 | block                                                                         { $$ = $1; }
                 ;
 
 // instructions - return
-return          : tRETURN             ';' { $$ = new udf::return_node(LINE, nullptr); }
-                | tRETURN expression  ';' { $$ = new udf::return_node(LINE, $2); }
+return          : tRETURN             ';' { $$ = MAKE(udf::return_node, LINE, nullptr); }
+                | tRETURN expression  ';' { $$ = MAKE(udf::return_node, LINE, $2); }
                 ;
 
 // instructions - conditional
-conditional_instruction : tIF '(' expression ')' instruction %prec tIFX         { $$ = new udf::if_node(LINE, $3, $5); }
-                        | tIF '(' expression ')' instruction else               { $$ = new udf::if_else_node(LINE, $3, $5, $6); }
+conditional_instruction : tIF '(' expression ')' instruction %prec tIFX         { $$ = MAKE(udf::if_node, LINE, $3, $5); }
+                        | tIF '(' expression ')' instruction else               { $$ = MAKE(udf::if_else_node, LINE, $3, $5, $6); }
                         ;
 
 else : tELSE instruction                                                        { $$ = $2; }
-     | tELIF '(' expression ')' instruction  %prec tIFX                         { $$ = new udf::if_node(LINE, $3, $5); }
-     | tELIF '(' expression ')' instruction else                                { $$ = new udf::if_else_node(LINE, $3, $5, $6); }
+     | tELIF '(' expression ')' instruction  %prec tIFX                         { $$ = MAKE(udf::if_node, LINE, $3, $5); }
+     | tELIF '(' expression ')' instruction else                                { $$ = MAKE(udf::if_else_node, LINE, $3, $5, $6); }
      ;
 
 // instructions - iteration
-fordec          : data_type tID '=' expression    { $$ = new udf::variable_declaration_node(LINE, tPRIVATE,  $1, *$2, $4); }
-                | tID '=' expression              { $$ = new udf::variable_declaration_node(LINE, tPRIVATE, nullptr, *$1, $3); delete $1; }
-                | tID                             { $$ = new cdk::variable_node(LINE, $1); }
+fordec          : data_type tID '=' expression    { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE,  $1, *$2, $4); }
+                | tID '=' expression              { $$ = MAKE(udf::variable_declaration_node, LINE, tPRIVATE, nullptr, *$1, $3); }
+                | tID                             { $$ = VARIABLE($1); }
                 ;
               
-fordecs         :             fordec { $$ = new cdk::sequence_node(LINE, $1);     }
-                | fordecs ',' fordec { $$ = new cdk::sequence_node(LINE, $3, $1); }
+fordecs         :             fordec { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+                | fordecs ',' fordec { $$ = $1; $$->nodes().push_back($3);        }
                 ;
 
-opt_forinit     : /**/     { $$ = new cdk::sequence_node(LINE, NIL); }
+opt_forinit     : /**/     { $$ = MAKE(cdk::sequence_node, LINE, NIL); }
                 | fordecs  { $$ = $1; }
                 ;
 
 // expressions
-expr_no_tensor : tINTEGER              { $$ = new cdk::integer_node(LINE, $1); }
-           | tREAL                 { $$ = new cdk::double_node(LINE, $1); };
-           | string                { $$ = new cdk::string_node(LINE, $1); }
-           | tNULLPTR              { $$ = new udf::nullptr_node(LINE); }
+expr_no_tensor : tINTEGER              { $$ = MAKE(cdk::integer_node, LINE, $1); }
+           | tREAL                 { $$ = MAKE(cdk::double_node, LINE, $1); };
+           | string                { $$ = MAKE(cdk::string_node, LINE, *udf::intern(*$1)); }
+           | tNULLPTR              { $$ = MAKE(udf::nullptr_node, LINE); }
            /* LEFT VALUES */
-           | lval                  { $$ = new cdk::rvalue_node(LINE, $1); }
+           | lval                  { $$ = MAKE(cdk::rvalue_node, LINE, $1); }
            /* ASSIGNMENTS */
-           | lval '=' expression         { $$ = new cdk::assignment_node(LINE, $1, $3); }
+           | lval '=' expression         { $$ = MAKE(cdk::assignment_node, LINE, $1, $3); }
            /* ARITHMETIC EXPRESSIONS */
-           | expression '+' expression         { $$ = new cdk::add_node(LINE, $1, $3); }
-           | expression '-' expression         { $$ = new cdk::sub_node(LINE, $1, $3); }
-           | expression '*' expression         { $$ = new cdk::mul_node(LINE, $1, $3); }
-           | expression '/' expression         { $$ = new cdk::div_node(LINE, $1, $3); }
-           | expression '%' expression         { $$ = new cdk::mod_node(LINE, $1, $3); }
+           | expression '+' expression         { $$ = MAKE(cdk::add_node, LINE, $1, $3); }
+           | expression '-' expression         { $$ = MAKE(cdk::sub_node, LINE, $1, $3); }
+           | expression '*' expression         { $$ = MAKE(cdk::mul_node, LINE, $1, $3); }
+           | expression '/' expression         { $$ = MAKE(cdk::div_node, LINE, $1, $3); }
+           | expression '%' expression         { $$ = MAKE(cdk::mod_node, LINE, $1, $3); }
            /* LOGICAL EXPRESSIONS */
-           | expression '<' expression         { $$ = new cdk::lt_node(LINE, $1, $3); }
-           | expression '>' expression         { $$ = new cdk::gt_node(LINE, $1, $3); }
-           | expression tGE expression         { $$ = new cdk::ge_node(LINE, $1, $3); }
-           | expression tLE expression         { $$ = new cdk::le_node(LINE, $1, $3); }
-           | expression tNE expression         { $$ = new cdk::ne_node(LINE, $1, $3); }
-           | expression tEQ expression         { $$ = new cdk::eq_node(LINE, $1, $3); }
-           | expression tAND  expression       { $$ = new cdk::and_node(LINE, $1, $3); }
-           | expression tOR   expression       { $$ = new cdk::or_node (LINE, $1, $3); }
+           | expression '<' expression         { $$ = MAKE(cdk::lt_node, LINE, $1, $3); }
+           | expression '>' expression         { $$ = MAKE(cdk::gt_node, LINE, $1, $3); }
+           | expression tGE expression         { $$ = MAKE(cdk::ge_node, LINE, $1, $3); }
+           | expression tLE expression         { $$ = MAKE(cdk::le_node, LINE, $1, $3); }
+           | expression tNE expression         { $$ = MAKE(cdk::ne_node, LINE, $1, $3); }
+           | expression tEQ expression         { $$ = MAKE(cdk::eq_node, LINE, $1, $3); }
+           | expression tAND  expression       { $$ = MAKE(cdk::and_node, LINE, $1, $3); }
+           | expression tOR   expression       { $$ = MAKE(cdk::or_node, LINE, $1, $3); }
             /* UNARY EXPRESSION */
-           | '-' expression %prec tUNARY     { $$ = new cdk::unary_minus_node(LINE, $2); }
-           | '+' expression %prec tUNARY     { $$ = new cdk::unary_plus_node(LINE, $2); }
-           | '~' expression                  { $$ = new cdk::not_node(LINE, $2); }
+           | '-' expression %prec tUNARY     { $$ = MAKE(cdk::unary_minus_node, LINE, $2); }
+           | '+' expression %prec tUNARY     { $$ = MAKE(cdk::unary_plus_node, LINE, $2); }
+           | '~' expression                  { $$ = MAKE(cdk::not_node, LINE, $2); }
            /* OTHER EXPRESSIONS */
            | '(' expression ')'              { $$ = $2; }
-           | tID '(' opt_expressions ')'     { $$ = new udf::function_call_node(LINE, *$1, $3); delete $1; }
-           | tSIZEOF '(' expression ')'      { $$ = new udf::sizeof_node(LINE, $3); }
-           | tINPUT                          { $$ = new udf::input_node(LINE); }
-           | tOBJECTS '(' expression ')'     { $$ = new udf::stack_alloc_node(LINE, $3); }
-           | lval '?'                        { $$ = new udf::address_of_node(LINE, $1); }
+           | tID '(' opt_expressions ')'     { $$ = MAKE(udf::function_call_node, LINE, *$1, $3); }
+           | tSIZEOF '(' expression ')'      { $$ = MAKE(udf::sizeof_node, LINE, $3); }
+           | tINPUT                          { $$ = MAKE(udf::input_node, LINE); }
+           | tOBJECTS '(' expression ')'     { $$ = MAKE(udf::stack_alloc_node, LINE, $3); }
+           | lval '?'                        { $$ = MAKE(udf::address_of_node, LINE, $1); }
            /* TENSOR EXPRESSIONS */
-           | expression '.' tRANK                        { $$ = new udf::tensor_rank_node(LINE, $1); }
-           | expression '.' tCAPACITY                    { $$ = new udf::tensor_capacity_node(LINE, $1); }
-           | expression '.' tDIMS                        { $$ = new udf::tensor_dims_node(LINE, $1); }
-           | expression '.' tDIM '(' expression ')'      { $$ = new udf::tensor_dim_node(LINE, $1, $5); } 
+           | expression '.' tRANK                        { $$ = MAKE(udf::tensor_rank_node, LINE, $1); }
+           | expression '.' tCAPACITY                    { $$ = MAKE(udf::tensor_capacity_node, LINE, $1); }
+           | expression '.' tDIMS                        { $$ = MAKE(udf::tensor_dims_node, LINE, $1); }
+           | expression '.' tDIM '(' expression ')'      { $$ = MAKE(udf::tensor_dim_node, LINE, $1, $5); } 
            ;
 
 
-exprs_no_tensor : expr_no_tensor                         { $$ = new cdk::sequence_node(LINE, $1);     }      
-                | exprs_no_tensor ',' expr_no_tensor      { $$ = new cdk::sequence_node(LINE, $3, $1); }
+exprs_no_tensor : expr_no_tensor                         { $$ = MAKE(cdk::sequence_node, LINE, $1);   }      
+                | exprs_no_tensor ',' expr_no_tensor      { $$ = $1; $$->nodes().push_back($3);        }
                 ;
 
 tensor_item : '[' exprs_no_tensor ']'                { $$ = $2; }
@@ -269,34 +287,35 @@ tensor_item : '[' exprs_no_tensor ']'                { $$ = $2; }
             ;
 
 
-tensor_items   : tensor_item                          { $$ = new cdk::sequence_node(LINE, $1);     }                     
-               | tensor_items ',' tensor_item         { $$ = new cdk::sequence_node(LINE, $3, $1); }
+tensor_items   : tensor_item                          { $$ = MAKE(cdk::sequence_node, LINE, $1);   }                     
+               | tensor_items ',' tensor_item         { $$ = $1; $$->nodes().push_back($3);        }
                ;
                
-tensor    :  tensor_item                                 {  $$ = new udf::tensor_node(LINE, $1); }
-          |  expression '.' tRESHAPE '(' expressions ')' { $$ = new udf::tensor_reshape_node(LINE, $1, $5); }
-          |  expression tCONTRACTION expression          { $$ = new udf::tensor_contraction_node(LINE, $1, $3); }
+tensor    :  tensor_item                                 {  $$ = MAKE(udf::tensor_node, LINE, $1); }
+          |  expression '.' tRESHAPE '(' expressions ')' { $$ = MAKE(udf::tensor_reshape_node, LINE, $1, $5); }
+          |  expression tCONTRACTION expression          { $$ = MAKE(udf::tensor_contraction_node, LINE, $1, $3); }
           ;
 
 expression : expr_no_tensor                           { $$ = $1; } 
            | tensor                                   { $$ = $1; } 
            ;
 
-expressions     : expression                     { $$ = new cdk::sequence_node(LINE, $1);     }
-                | expressions ',' expression     { $$ = new cdk::sequence_node(LINE, $3, $1); }
+expressions     : expression                     { $$ = MAKE(cdk::sequence_node, LINE, $1);   }
+                | expressions ',' expression     { $$ = $1; $$->nodes().push_back($3);        }
                 ;
 
-opt_expressions : /* empty */         { $$ = new cdk::sequence_node(LINE); }
+opt_expressions : /* empty */         { $$ = MAKE(cdk::sequence_node, LINE); }
                 | expressions         { $$ = $1; }
                 ;
 
-lval : tID                                { $$ = new cdk::variable_node(LINE, $1); }
-     | expression '[' expression ']'      { $$ = new udf::index_node(LINE, $1, $3); }
-     | expression '@' '(' expressions ')' { $$ = new udf::tensor_index_node(LINE, $1, $4); }
+lval : tID                                { $$ = VARIABLE($1); }
+     | expression '[' expression ']'      { $$ = MAKE(udf::index_node, LINE, $1, $3); }
+     | expression '@' '(' expressions ')' { $$ = MAKE(udf::tensor_index_node, LINE, $1, $4); }
      ;
      
-string          : tSTRING                       { $$ = $1; }
-                | string tSTRING                { $$ = $1; $$->append(*$2); delete $2; }
+// adjacent literals are joined in the arena: only the whole one is interned
+string          : tSTRING                       { $$ = MAKE(std::string, *$1); }
+                | string tSTRING                { $$ = $1; $$->append(*$2); }
                 ;
 
 %%
\ No newline at end of file